@@ -0,0 +1,91 @@
+// Скорость расчета расстояний по прямой (сегментов в секунду) и отклонение от geo::ComputeDistance:
+// - scalar - geo::ComputeDistance(Coordinates, Coordinates), шесть тригонометрических функций на пару;
+// - trig - geo::ComputeDistance(TrigCoordinates, TrigCoordinates), как в Catalogue::GetBusInfo;
+// - batch - geo::ComputeDistances от одной точки до массива, как в StopsSpatialIndex.
+// Сборка и запуск описаны в README
+#include "../geo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t POINT_COUNT = 1'000'000;
+constexpr int REPEAT_COUNT = 5;
+
+// лучшее время из REPEAT_COUNT запусков, сегментов в секунду
+template <typename Function>
+double MeasureRate(size_t segments, Function function) {
+	double best = 0.;
+	for (int i = 0; i < REPEAT_COUNT; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::max(best, static_cast<double>(segments) / elapsed.count());
+	}
+	return best;
+}
+
+double MaxDeviation(const std::vector<double>& expected, const std::vector<double>& actual) {
+	double deviation = 0.;
+	for (size_t i = 0; i < expected.size(); ++i) {
+		deviation = std::max(deviation, std::abs(expected[i] - actual[i]));
+	}
+	return deviation;
+}
+
+void PrintResult(const char* name, double rate, double deviation) {
+	std::cout << name << ": " << rate / 1e6 << " M segments/s, max deviation " << deviation << " m" << std::endl;
+}
+
+} // namespace
+
+int main() {
+	// точки в пределах города, как остановки справочника
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> lat_distribution(55.5, 56.0);
+	std::uniform_real_distribution<double> lng_distribution(37.3, 37.9);
+	std::vector<geo::Coordinates> points(POINT_COUNT);
+	std::vector<double> lats(POINT_COUNT);
+	std::vector<double> lngs(POINT_COUNT);
+	for (size_t i = 0; i < POINT_COUNT; ++i) {
+		points[i] = { lat_distribution(generator), lng_distribution(generator) };
+		lats[i] = points[i].lat;
+		lngs[i] = points[i].lng;
+	}
+	const geo::Coordinates from = points.front();
+
+	// последовательные сегменты маршрута
+	std::vector<double> expected(POINT_COUNT - 1);
+	const double scalar_rate = MeasureRate(expected.size(), [&] {
+		for (size_t i = 0; i + 1 < POINT_COUNT; ++i) {
+			expected[i] = geo::ComputeDistance(points[i], points[i + 1]);
+		}
+	});
+	PrintResult("scalar", scalar_rate, 0.);
+
+	std::vector<geo::TrigCoordinates> trig(POINT_COUNT);
+	std::transform(points.begin(), points.end(), trig.begin(), geo::PrecomputeTrig);
+	std::vector<double> actual(POINT_COUNT - 1);
+	const double trig_rate = MeasureRate(actual.size(), [&] {
+		for (size_t i = 0; i + 1 < POINT_COUNT; ++i) {
+			actual[i] = geo::ComputeDistance(trig[i], trig[i + 1]);
+		}
+	});
+	PrintResult("trig", trig_rate, MaxDeviation(expected, actual));
+
+	// расстояния от одной точки до всех остальных
+	expected.resize(POINT_COUNT);
+	actual.resize(POINT_COUNT);
+	for (size_t i = 0; i < POINT_COUNT; ++i) {
+		expected[i] = geo::ComputeDistance(from, points[i]);
+	}
+	const double batch_rate = MeasureRate(actual.size(), [&] {
+		geo::ComputeDistances(from, lats.data(), lngs.data(), POINT_COUNT, actual.data());
+	});
+	PrintResult("batch", batch_rate, MaxDeviation(expected, actual));
+}
\ No newline at end of file
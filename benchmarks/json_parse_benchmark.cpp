@@ -0,0 +1,134 @@
+// Разбор JSON-документов вида base_requests размером около 20 МБ с разной длиной названий
+// в трех режимах индекса кавычек: auto (по умолчанию), never (без индекса) и always.
+// На коротких названиях auto не должен уступать never, на длинных - always.
+// Лучшее время из REPEAT_COUNT запусков, режимы чередуются, чтобы шум машины делился между ними поровну:
+// - sax - json::Parse с обработчиком, который только считает строки;
+// - dom - json::Load, дерево документа в арене.
+// Документы:
+// - short_names - названия из нескольких символов, строк много и они короткие;
+// - long_names - названия длиной в несколько десятков символов;
+// - mixed - короткие названия, в начале документа длинные.
+// Сборка и запуск описаны в README
+#include "../json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t DOCUMENT_SIZE = 20'000'000;
+constexpr int REPEAT_COUNT = 7;
+
+// считает строки и ничего не сохраняет
+class CountingHandler final : public json::Handler {
+public:
+	size_t strings = 0;
+
+	void StartDict() override {}
+	void Key(std::string_view) override {
+		++strings;
+	}
+	void EndDict() override {}
+	void StartArray() override {}
+	void EndArray() override {}
+	void Null() override {}
+	void Bool(bool) override {}
+	void Int(int) override {}
+	void Double(double) override {}
+	void String(std::string_view) override {
+		++strings;
+	}
+};
+
+std::string MakeName(std::mt19937& generator, size_t length) {
+	static constexpr std::string_view letters = "abcdefghijklmnopqrstuvwxyz"sv;
+	std::uniform_int_distribution<size_t> letter(0, letters.size() - 1);
+	std::string name;
+	for (size_t i = 0; i < length; ++i) {
+		name += (i % 8 == 7) ? ' ' : letters[letter(generator)];
+	}
+	return name;
+}
+
+// остановки с расстояниями до соседей и маршруты по ним; первые long_prefix байт документа
+// занимают остановки с названиями длины long_length, остальные - с названиями длины short_length
+std::string MakeDocument(size_t short_length, size_t long_length, size_t long_prefix) {
+	std::mt19937 generator(17);
+	std::uniform_real_distribution<double> coordinate(0., 1.);
+	std::string text = R"({"base_requests": [)"s;
+	std::string previous = MakeName(generator, short_length);
+	for (int i = 0; text.size() < DOCUMENT_SIZE; ++i) {
+		const std::string name = MakeName(generator, text.size() < long_prefix ? long_length : short_length) + std::to_string(i);
+		text += R"({"type": "Stop", "name": ")"s + name + R"(", "latitude": )"s + std::to_string(55. + coordinate(generator))
+			+ R"(, "longitude": )"s + std::to_string(37. + coordinate(generator)) + R"(, "road_distances": {")"s
+			+ previous + R"(": )"s + std::to_string(100 + i % 1000) + "}}, "s;
+		if (i % 10 == 9) {
+			text += R"({"type": "Bus", "name": ")"s + name + R"(", "stops": [")"s + previous + R"(", ")"s + name
+				+ R"("], "is_roundtrip": false}, )"s;
+		}
+		previous = name;
+	}
+	text.resize(text.size() - 2);
+	return text + "]}"s;
+}
+
+// лучшее время разбора в одном режиме индекса, миллисекунд
+struct Timing {
+	std::string_view mode;
+	json::QuoteIndexMode value;
+	double sax = 0.;
+	double dom = 0.;
+};
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+	const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void Measure(std::string_view title, const std::string& text) {
+	Timing timings[] = {
+		{ "auto"sv, json::QuoteIndexMode::AUTO },
+		{ "never"sv, json::QuoteIndexMode::NEVER },
+		{ "always"sv, json::QuoteIndexMode::ALWAYS },
+	};
+	size_t strings = 0;
+	size_t requests = 0;
+	for (int i = 0; i < REPEAT_COUNT; ++i) {
+		for (auto& timing : timings) {
+			json::SetQuoteIndexMode(timing.value);
+			CountingHandler handler;
+			auto start = std::chrono::steady_clock::now();
+			json::Parse(text, handler);
+			const double sax = ElapsedMs(start);
+			start = std::chrono::steady_clock::now();
+			{
+				const json::Document document = json::Load(text);
+				requests = document.GetRoot().AsMap().at("base_requests"s).AsArray().size();
+			}
+			const double dom = ElapsedMs(start);
+			timing.sax = i == 0 ? sax : std::min(timing.sax, sax);
+			timing.dom = i == 0 ? dom : std::min(timing.dom, dom);
+			strings = handler.strings;
+		}
+	}
+	json::SetQuoteIndexMode(json::QuoteIndexMode::AUTO);
+
+	std::cout << title << " (" << text.size() << " bytes, " << strings << " strings, " << requests << " requests):" << std::endl;
+	for (const auto& timing : timings) {
+		std::cout << "  " << timing.mode << ": sax " << timing.sax << " ms, dom " << timing.dom << " ms" << std::endl;
+	}
+}
+
+} // namespace
+
+int main() {
+	Measure("short_names"sv, MakeDocument(6, 6, 0));
+	Measure("long_names"sv, MakeDocument(6, 60, DOCUMENT_SIZE));
+	Measure("mixed"sv, MakeDocument(6, 60, DOCUMENT_SIZE / 10));
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+// Отрисовка карты на сети, где остановки общие для многих маршрутов: STOP_COUNT остановок,
+// BUS_COUNT маршрутов по ROUTE_LENGTH остановок. Лучшее время из REPEAT_COUNT запусков:
+// - per_occurrence - проектор по всем вхождениям остановок и проекция каждого вхождения,
+//   как до появления ProjectedStops;
+// - projected_stops - ProjectedStops: каждая остановка собирается и проецируется один раз;
+// - full_map - карта целиком в строку SVG, с размером и хешем вывода для сверки между сборками.
+// Сборка и запуск описаны в README
+#include "../map_renderer.h"
+#include "../transport_catalogue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+using namespace transport_ctg;
+using namespace renderer;
+
+namespace {
+
+constexpr int STOP_COUNT = 2000;
+constexpr int BUS_COUNT = 4000;
+constexpr int ROUTE_LENGTH = 60;
+constexpr int REPEAT_COUNT = 7;
+
+RenderSettings MakeSettings() {
+	RenderSettings settings;
+	settings.width = 1200.;
+	settings.height = 1200.;
+	settings.padding = 50.;
+	settings.line_width = 14.;
+	settings.stop_radius = 5.;
+	settings.bus_label_font_size = 20;
+	settings.bus_label_offset = { 7., 15. };
+	settings.stop_label_font_size = 20;
+	settings.stop_label_offset = { 7., -3. };
+	settings.underlayer_color = svg::Rgba{ 255, 255, 255, 0.85 };
+	settings.underlayer_width = 3.;
+	settings.color_palette = { "green"s, svg::Rgb{ 255, 160, 0 }, "red"s };
+	return settings;
+}
+
+void FillCatalogue(Catalogue& catalogue) {
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<double> lat(55.5, 56.0);
+	std::uniform_real_distribution<double> lng(37.3, 37.9);
+	std::uniform_int_distribution<int> stop_number(0, STOP_COUNT - 1);
+	CatalogueBuilder builder(catalogue, STOP_COUNT, BUS_COUNT, 0);
+	std::vector<const Stop*> stops;
+	for (int i = 0; i < STOP_COUNT; ++i) {
+		stops.push_back(builder.AddStop({ "Stop "s + std::to_string(i), { lat(generator), lng(generator) } }));
+	}
+	for (int i = 0; i < BUS_COUNT; ++i) {
+		const std::string name = "Bus "s + std::to_string(i);
+		Bus bus{ name, {}, true };
+		for (int j = 0; j < ROUTE_LENGTH; ++j) {
+			bus.stops_ptr.push_back(stops[stop_number(generator)]);
+		}
+		bus.stops_ptr.push_back(bus.stops_ptr.front());
+		builder.AddBus(std::move(bus));
+	}
+	builder.Build();
+}
+
+// лучшее время из REPEAT_COUNT запусков, миллисекунд
+template <typename Function>
+double MeasureMs(Function function) {
+	double best = 0.;
+	for (int i = 0; i < REPEAT_COUNT; ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+// FNV-1a
+uint64_t Hash(const std::string& text) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : text) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+} // namespace
+
+int main() {
+	Catalogue catalogue;
+	FillCatalogue(catalogue);
+	const auto buses = catalogue.GetSortedBuses();
+	const RenderSettings settings = MakeSettings();
+
+	double checksum = 0.;
+	const double per_occurrence = MeasureMs([&] {
+		std::vector<geo::Coordinates> coordinates;
+		for (const auto& [name, bus] : buses) {
+			for (const Stop* stop : bus->stops_ptr) {
+				coordinates.push_back(stop->coordinates);
+			}
+		}
+		const SphereProjector projector(coordinates.begin(), coordinates.end(), settings.width, settings.height, settings.padding);
+		std::vector<svg::Point> points;
+		points.reserve(coordinates.size());
+		for (const auto& point : coordinates) {
+			points.push_back(projector(point));
+		}
+		checksum += points.back().x;
+	});
+	std::cout << "per_occurrence: " << per_occurrence << " ms" << std::endl;
+
+	const double projected_stops = MeasureMs([&] {
+		const ProjectedStops projected(buses, settings);
+		checksum += projected.GetPoint(uint32_t{ 0 }).x;
+	});
+	std::cout << "projected_stops: " << projected_stops << " ms" << std::endl;
+
+	const MapRenderer renderer(settings);
+	std::string map;
+	const double full_map = MeasureMs([&] {
+		map.clear();
+		renderer.GetRenderedMap(buses).Render(map);
+	});
+	std::cout << "full_map: " << full_map << " ms, " << map.size() << " bytes, hash " << std::hex << Hash(map) << std::dec
+		<< " (checksum " << checksum << ")" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "catalogue_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace transport_ctg {
+namespace snapshot {
+
+using namespace std::literals;
+
+namespace {
+
+static_assert(std::numeric_limits<double>::is_iec559, "snapshot stores doubles as IEEE-754");
+
+constexpr std::size_t ALIGNMENT = 8;
+constexpr uint32_t ROUNDTRIP_FLAG = 1;
+
+void AppendU32(std::string& buffer, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+}
+
+void AppendU64(std::string& buffer, uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+}
+
+void AppendF64(std::string& buffer, double value) {
+	uint64_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	AppendU64(buffer, bits);
+}
+
+void WriteU64(std::string& buffer, std::size_t pos, uint64_t value) {
+	for (int i = 0; i < 8; ++i) {
+		buffer[pos + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+	}
+}
+
+void Align(std::string& buffer) {
+	buffer.resize((buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+}
+
+uint32_t ReadU32(const char* data) {
+	const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+	return static_cast<uint32_t>(bytes[0])
+		| static_cast<uint32_t>(bytes[1]) << 8
+		| static_cast<uint32_t>(bytes[2]) << 16
+		| static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+uint64_t ReadU64(const char* data) {
+	return static_cast<uint64_t>(ReadU32(data)) | static_cast<uint64_t>(ReadU32(data + 4)) << 32;
+}
+
+double ReadF64(const char* data) {
+	const uint64_t bits = ReadU64(data);
+	double value = 0.;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint32_t ToU32(std::size_t value) {
+	if (value > std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("catalogue is too large for snapshot"s);
+	}
+	return static_cast<uint32_t>(value);
+}
+
+// проверяет, что секция из count записей размера record_size помещается в данные
+const char* GetSection(std::string_view data, uint64_t offset, uint64_t count, std::size_t record_size) {
+	if (offset > data.size() || count > (data.size() - offset) / record_size) {
+		throw std::runtime_error("snapshot section is out of bounds"s);
+	}
+	return data.data() + offset;
+}
+
+} // namespace
+
+// ------ SnapshotView ------
+SnapshotView::SnapshotView(std::string_view data)
+	: data_(data) {
+	if (data_.size() < HEADER_SIZE || data_.substr(0, MAGIC.size()) != MAGIC) {
+		throw std::runtime_error("not a catalogue snapshot"s);
+	}
+	const char* header = data_.data();
+	if (ReadU32(header + 8) != FORMAT_VERSION) {
+		throw std::runtime_error("unsupported snapshot version"s);
+	}
+	if (ReadU64(header + 80) != data_.size()) {
+		throw std::runtime_error("snapshot is truncated"s);
+	}
+	stop_count_ = ReadU32(header + 12);
+	bus_count_ = ReadU32(header + 16);
+	route_size_ = ReadU32(header + 20);
+	distance_count_ = ReadU64(header + 24);
+	const uint64_t names_size = ReadU64(header + 32);
+
+	stops_ = GetSection(data_, ReadU64(header + 40), stop_count_, STOP_SIZE);
+	buses_ = GetSection(data_, ReadU64(header + 48), bus_count_, BUS_SIZE);
+	route_ = GetSection(data_, ReadU64(header + 56), route_size_, sizeof(uint32_t));
+	distances_ = GetSection(data_, ReadU64(header + 64), distance_count_, DISTANCE_SIZE);
+	names_ = std::string_view(GetSection(data_, ReadU64(header + 72), names_size, 1), names_size);
+}
+
+uint32_t SnapshotView::GetStopCount() const {
+	return stop_count_;
+}
+
+uint32_t SnapshotView::GetBusCount() const {
+	return bus_count_;
+}
+
+uint64_t SnapshotView::GetDistanceCount() const {
+	return distance_count_;
+}
+
+std::string_view SnapshotView::GetName(const char* record) const {
+	const uint32_t offset = ReadU32(record);
+	const uint32_t size = ReadU32(record + 4);
+	if (offset > names_.size() || size > names_.size() - offset) {
+		throw std::runtime_error("snapshot name is out of bounds"s);
+	}
+	return names_.substr(offset, size);
+}
+
+std::string_view SnapshotView::GetStopName(uint32_t stop_id) const {
+	return GetName(stops_ + std::size_t{ stop_id } * STOP_SIZE);
+}
+
+geo::Coordinates SnapshotView::GetStopCoordinates(uint32_t stop_id) const {
+	const char* record = stops_ + std::size_t{ stop_id } * STOP_SIZE;
+	return { ReadF64(record + 8), ReadF64(record + 16) };
+}
+
+std::optional<uint32_t> SnapshotView::FindStop(std::string_view stop_name) const {
+	uint32_t first = 0;
+	uint32_t last = stop_count_;
+	while (first < last) {
+		const uint32_t middle = first + (last - first) / 2;
+		if (GetStopName(middle) < stop_name) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	if (first < stop_count_ && GetStopName(first) == stop_name) {
+		return first;
+	}
+	return std::nullopt;
+}
+
+std::string_view SnapshotView::GetBusName(uint32_t bus_id) const {
+	return GetName(buses_ + std::size_t{ bus_id } * BUS_SIZE);
+}
+
+bool SnapshotView::IsRoundtrip(uint32_t bus_id) const {
+	return ReadU32(buses_ + std::size_t{ bus_id } * BUS_SIZE + 16) & ROUNDTRIP_FLAG;
+}
+
+uint32_t SnapshotView::GetBusStopCount(uint32_t bus_id) const {
+	return ReadU32(buses_ + std::size_t{ bus_id } * BUS_SIZE + 12);
+}
+
+uint32_t SnapshotView::GetBusStop(uint32_t bus_id, uint32_t index) const {
+	const uint64_t position = uint64_t{ ReadU32(buses_ + std::size_t{ bus_id } * BUS_SIZE + 8) } + index;
+	if (position >= route_size_) {
+		throw std::runtime_error("snapshot route is out of bounds"s);
+	}
+	return ReadU32(route_ + position * sizeof(uint32_t));
+}
+
+std::optional<uint32_t> SnapshotView::FindBus(std::string_view bus_name) const {
+	uint32_t first = 0;
+	uint32_t last = bus_count_;
+	while (first < last) {
+		const uint32_t middle = first + (last - first) / 2;
+		if (GetBusName(middle) < bus_name) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	if (first < bus_count_ && GetBusName(first) == bus_name) {
+		return first;
+	}
+	return std::nullopt;
+}
+
+SnapshotView::Distance SnapshotView::GetDistance(uint64_t index) const {
+	const char* record = distances_ + index * DISTANCE_SIZE;
+	return { ReadU32(record), ReadU32(record + 4), ReadU32(record + 8) };
+}
+
+std::optional<uint64_t> SnapshotView::FindDistance(uint32_t from, uint32_t to) const {
+	uint64_t first = 0;
+	uint64_t last = distance_count_;
+	while (first < last) {
+		const uint64_t middle = first + (last - first) / 2;
+		const Distance record = GetDistance(middle);
+		if (std::tie(record.from, record.to) < std::tie(from, to)) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	if (first < distance_count_) {
+		const Distance record = GetDistance(first);
+		if (record.from == from && record.to == to) {
+			return first;
+		}
+	}
+	return std::nullopt;
+}
+
+uint32_t SnapshotView::GetDistanceBetweenStops(uint32_t from, uint32_t to) const {
+	if (const auto index = FindDistance(from, to)) {
+		return GetDistance(*index).distance;
+	}
+	if (const auto index = FindDistance(to, from)) {
+		return GetDistance(*index).distance;
+	}
+	return 0;
+}
+
+// ------ Сохранение и загрузка ------
+void SaveCatalogue(const Catalogue& catalogue, std::ostream& output) {
+	const auto sorted_stops = catalogue.GetSortedStops();
+	const auto sorted_buses = catalogue.GetSortedBuses();
+
+	std::string names;
+	std::unordered_map<const Stop*, uint32_t> stop_ids;
+	stop_ids.reserve(sorted_stops.size());
+
+	std::string stops;
+	stops.reserve(sorted_stops.size() * STOP_SIZE);
+	for (const auto& [name, stop_ptr] : sorted_stops) {
+		stop_ids.emplace(stop_ptr, ToU32(stop_ids.size()));
+		AppendU32(stops, ToU32(names.size()));
+		AppendU32(stops, ToU32(name.size()));
+		AppendF64(stops, stop_ptr->coordinates.lat);
+		AppendF64(stops, stop_ptr->coordinates.lng);
+		names += name;
+	}
+
+	std::string buses;
+	std::string route;
+	buses.reserve(sorted_buses.size() * BUS_SIZE);
+	for (const auto& [name, bus_ptr] : sorted_buses) {
+		AppendU32(buses, ToU32(names.size()));
+		AppendU32(buses, ToU32(name.size()));
+		AppendU32(buses, ToU32(route.size() / sizeof(uint32_t)));
+		AppendU32(buses, ToU32(bus_ptr->stops_ptr.size()));
+		AppendU32(buses, bus_ptr->is_roundtrip ? ROUNDTRIP_FLAG : 0);
+		names += name;
+		for (const Stop* stop_ptr : bus_ptr->stops_ptr) {
+			AppendU32(route, stop_ids.at(stop_ptr));
+		}
+	}
+
+	std::vector<SnapshotView::Distance> distance_table;
+	distance_table.reserve(catalogue.GetDistanceTable().size());
+	for (const auto& [stops_pair, distance] : catalogue.GetDistanceTable()) {
+		distance_table.push_back({ stop_ids.at(stops_pair.first), stop_ids.at(stops_pair.second), distance });
+	}
+	std::sort(distance_table.begin(), distance_table.end(), [](const auto& lhs, const auto& rhs) {
+		return std::tie(lhs.from, lhs.to) < std::tie(rhs.from, rhs.to);
+	});
+
+	std::string buffer;
+	buffer.reserve(HEADER_SIZE + stops.size() + buses.size() + route.size()
+		+ distance_table.size() * DISTANCE_SIZE + names.size() + 4 * ALIGNMENT);
+	buffer += MAGIC;
+	AppendU32(buffer, FORMAT_VERSION);
+	AppendU32(buffer, ToU32(sorted_stops.size()));
+	AppendU32(buffer, ToU32(sorted_buses.size()));
+	AppendU32(buffer, ToU32(route.size() / sizeof(uint32_t)));
+	AppendU64(buffer, distance_table.size());
+	AppendU64(buffer, names.size());
+	// смещения секций и размер файла заполняются по мере записи
+	buffer.resize(HEADER_SIZE, '\0');
+
+	WriteU64(buffer, 40, buffer.size());
+	buffer += stops;
+	Align(buffer);
+	WriteU64(buffer, 48, buffer.size());
+	buffer += buses;
+	Align(buffer);
+	WriteU64(buffer, 56, buffer.size());
+	buffer += route;
+	Align(buffer);
+	WriteU64(buffer, 64, buffer.size());
+	for (const auto& record : distance_table) {
+		AppendU32(buffer, record.from);
+		AppendU32(buffer, record.to);
+		AppendU32(buffer, record.distance);
+	}
+	Align(buffer);
+	WriteU64(buffer, 72, buffer.size());
+	buffer += names;
+	WriteU64(buffer, 80, buffer.size());
+
+	output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+void SaveCatalogue(const Catalogue& catalogue, const std::string& path) {
+	std::ofstream output(path, std::ios::binary);
+	if (!output) {
+		throw std::runtime_error("can't open snapshot file "s + path);
+	}
+	SaveCatalogue(catalogue, output);
+	if (!output) {
+		throw std::runtime_error("can't write snapshot file "s + path);
+	}
+}
+
+void LoadCatalogue(const SnapshotView& snapshot, Catalogue& catalogue) {
+	const uint32_t stop_count = snapshot.GetStopCount();
+	CatalogueBuilder builder(catalogue, stop_count, snapshot.GetBusCount(), snapshot.GetDistanceCount());
+
+	std::vector<const Stop*> stops;
+	stops.reserve(stop_count);
+	for (uint32_t id = 0; id < stop_count; ++id) {
+		Stop stop;
+		stop.name = snapshot.GetStopName(id);
+		stop.coordinates = snapshot.GetStopCoordinates(id);
+		stops.push_back(builder.AddStop(stop));
+	}
+
+	const auto get_stop = [&stops](uint32_t id) {
+		if (id >= stops.size()) {
+			throw std::runtime_error("snapshot stop index is out of bounds"s);
+		}
+		return stops[id];
+	};
+
+	for (uint64_t i = 0; i < snapshot.GetDistanceCount(); ++i) {
+		const auto record = snapshot.GetDistance(i);
+		builder.AddDistanceBetweenStops({ get_stop(record.from), get_stop(record.to) }, record.distance);
+	}
+
+	for (uint32_t id = 0; id < snapshot.GetBusCount(); ++id) {
+		Bus bus;
+		bus.name = snapshot.GetBusName(id);
+		bus.is_roundtrip = snapshot.IsRoundtrip(id);
+		const uint32_t bus_stop_count = snapshot.GetBusStopCount(id);
+		bus.stops_ptr.reserve(bus_stop_count);
+		for (uint32_t i = 0; i < bus_stop_count; ++i) {
+			bus.stops_ptr.push_back(get_stop(snapshot.GetBusStop(id, i)));
+		}
+		builder.AddBus(std::move(bus));
+	}
+	builder.Build();
+}
+
+void LoadCatalogue(const std::string& path, Catalogue& catalogue) {
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("can't open snapshot file "s + path);
+	}
+	const std::string data{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+	LoadCatalogue(SnapshotView(data), catalogue);
+}
+
+} // end of namespace "transport_ctg::snapshot"
+} // end of namespace "transport_ctg"
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include "geo.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace transport_ctg {
+namespace snapshot {
+
+// Двоичный снимок справочника. Все числа записаны в порядке little-endian, вещественные -
+// как 64-битные значения IEEE-754. Вместо указателей хранятся индексы записей, а записи имеют
+// фиксированный размер, поэтому файл можно отобразить в память и читать без разбора (SnapshotView).
+//
+// Заголовок (HEADER_SIZE байт):
+//   0  char[8] MAGIC
+//   8  u32 версия формата
+//   12 u32 количество остановок       16 u32 количество маршрутов
+//   20 u32 длина массива остановок маршрутов
+//   24 u64 количество расстояний      32 u64 размер таблицы строк
+//   40 u64 смещение остановок         48 u64 смещение маршрутов
+//   56 u64 смещение остановок маршрутов
+//   64 u64 смещение расстояний        72 u64 смещение таблицы строк
+//   80 u64 размер файла
+// Остановка (STOP_SIZE): u32 смещение имени, u32 длина имени, f64 широта, f64 долгота.
+//   Остановки упорядочены по имени, индекс остановки - ее номер в этом порядке.
+// Маршрут (BUS_SIZE): u32 смещение имени, u32 длина имени, u32 первая остановка в массиве
+//   остановок маршрутов, u32 количество остановок, u32 флаги (бит 0 - кольцевой). Упорядочены по имени.
+// Остановка маршрута: u32 индекс остановки (маршрут записан полностью, как в Bus::stops_ptr).
+// Расстояние (DISTANCE_SIZE): u32 откуда, u32 куда, u32 метры. Упорядочены по паре (откуда, куда).
+// Таблица строк: имена подряд без разделителей.
+// Секции выровнены по 8 байтам.
+inline constexpr std::string_view MAGIC = "TCATSNAP";
+inline constexpr uint32_t FORMAT_VERSION = 1;
+inline constexpr std::size_t HEADER_SIZE = 88;
+inline constexpr std::size_t STOP_SIZE = 24;
+inline constexpr std::size_t BUS_SIZE = 20;
+inline constexpr std::size_t DISTANCE_SIZE = 12;
+
+// Чтение снимка напрямую из буфера (прочитанного файла или отображенной в память области).
+// Буфер должен жить дольше объекта. Конструктор проверяет заголовок и границы секций,
+// при повреждении данных бросается std::runtime_error.
+class SnapshotView {
+public:
+	explicit SnapshotView(std::string_view data);
+
+	uint32_t GetStopCount() const;
+	uint32_t GetBusCount() const;
+	uint64_t GetDistanceCount() const;
+
+	std::string_view GetStopName(uint32_t stop_id) const;
+	geo::Coordinates GetStopCoordinates(uint32_t stop_id) const;
+	// двоичный поиск по упорядоченным именам
+	std::optional<uint32_t> FindStop(std::string_view stop_name) const;
+
+	std::string_view GetBusName(uint32_t bus_id) const;
+	bool IsRoundtrip(uint32_t bus_id) const;
+	uint32_t GetBusStopCount(uint32_t bus_id) const;
+	// индекс index-й остановки маршрута
+	uint32_t GetBusStop(uint32_t bus_id, uint32_t index) const;
+	std::optional<uint32_t> FindBus(std::string_view bus_name) const;
+
+	// i-я запись таблицы расстояний: откуда, куда, метры
+	struct Distance {
+		uint32_t from = 0;
+		uint32_t to = 0;
+		uint32_t distance = 0;
+	};
+	Distance GetDistance(uint64_t index) const;
+	// как Catalogue::GetDistanceBetweenStops: прямое расстояние, иначе обратное, иначе 0
+	uint32_t GetDistanceBetweenStops(uint32_t from, uint32_t to) const;
+
+private:
+	std::string_view data_;
+	uint32_t stop_count_ = 0;
+	uint32_t bus_count_ = 0;
+	uint32_t route_size_ = 0;
+	uint64_t distance_count_ = 0;
+	const char* stops_ = nullptr;
+	const char* buses_ = nullptr;
+	const char* route_ = nullptr;
+	const char* distances_ = nullptr;
+	std::string_view names_;
+
+	std::string_view GetName(const char* record) const;
+	std::optional<uint64_t> FindDistance(uint32_t from, uint32_t to) const;
+};
+
+// записывает снимок справочника
+void SaveCatalogue(const Catalogue& catalogue, std::ostream& output);
+void SaveCatalogue(const Catalogue& catalogue, const std::string& path);
+
+// добавляет в справочник данные снимка; имена копируются в хранилище справочника,
+// поэтому буфер после загрузки можно освободить
+void LoadCatalogue(const SnapshotView& snapshot, Catalogue& catalogue);
+void LoadCatalogue(const std::string& path, Catalogue& catalogue);
+
+} // end of namespace "transport_ctg::snapshot"
+} // end of namespace "transport_ctg"
\ No newline at end of file
@@ -12,6 +12,7 @@
  */
 #include "geo.h"
 
+#include <cstdint>
 #include <set>
 #include <string>
 #include <string_view>
@@ -19,24 +20,35 @@
 #include <unordered_map>
 
 namespace transport_ctg {
-	
+
+// порядковый номер остановки в справочнике
+using StopId = uint32_t;
+
 struct Stop {
 	std::string_view name;
 	geo::Coordinates coordinates {0.0, 0.0};
+	// назначается справочником при добавлении остановки
+	StopId id = 0;
 };
 
 struct Bus {
 	std::string_view name;
-	std::vector<Stop*> stops_ptr;
+	std::vector<const Stop*> stops_ptr;
 	bool is_roundtrip = false;
 };
 
 struct BusInfo {
-	Bus* bus_ptr = nullptr;
+	const Bus* bus_ptr = nullptr;
 	int stops_on_route = 0;
 	int unique_stops = 0;
 	double route_length = 0.;
 	double coordinate_length = 0.;
 };
 
+// остановка и расстояние до нее от заданной точки в метрах
+struct StopDistance {
+	const Stop* stop_ptr = nullptr;
+	double distance = 0.;
+};
+
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "geo.h"
 
 #include <cmath>
+#include <vector>
 
 namespace geo{
 
@@ -10,12 +11,49 @@ double ComputeDistance(Coordinates from, Coordinates to) {
 	if (from == to) {
 		return 0;
 	}
-	static const double dr = M_PI / 180.;
-	static const int earth_radius = 6'371'000;
+	constexpr double dr = M_PI / 180.;
 	
 	return acos(sin(from.lat * dr) * sin(to.lat * dr)
 		+ cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-		* earth_radius;
+		* EARTH_RADIUS;
+}
+
+namespace {
+const double DEG_TO_RAD = M_PI / 180.;
+} // namespace
+
+TrigCoordinates PrecomputeTrig(Coordinates point) {
+	return { point, std::sin(point.lat * DEG_TO_RAD), std::cos(point.lat * DEG_TO_RAD) };
+}
+
+double ComputeDistance(const TrigCoordinates& from, const TrigCoordinates& to) {
+	if (from.coordinates == to.coordinates) {
+		return 0;
+	}
+	return std::acos(from.sin_lat * to.sin_lat
+		+ from.cos_lat * to.cos_lat * std::cos(std::abs(from.coordinates.lng - to.coordinates.lng) * DEG_TO_RAD))
+		* EARTH_RADIUS;
+}
+
+void ComputeDistances(Coordinates from, const double* lats, const double* lngs, size_t count, double* distances) {
+	if (count == 0) {
+		return;
+	}
+	const double from_sin_lat = std::sin(from.lat * DEG_TO_RAD);
+	const double from_cos_lat = std::cos(from.lat * DEG_TO_RAD);
+	std::vector<double> sin_lat(count);
+	for (size_t i = 0; i < count; ++i) {
+		sin_lat[i] = std::sin(lats[i] * DEG_TO_RAD);
+		distances[i] = std::cos(lats[i] * DEG_TO_RAD);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		distances[i] = from_sin_lat * sin_lat[i] + from_cos_lat * distances[i] * std::cos(std::abs(from.lng - lngs[i]) * DEG_TO_RAD);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		distances[i] = from.lat == lats[i] && from.lng == lngs[i]
+			? 0.
+			: std::acos(distances[i]) * EARTH_RADIUS;
+	}
 }
 
 } // namespace geo
\ No newline at end of file
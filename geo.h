@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+
 namespace geo {
 
+    // средний радиус Земли в метрах
+    inline constexpr double EARTH_RADIUS = 6'371'000.;
+
     struct Coordinates {
         double lat; // Широта
         double lng; // Долгота
@@ -15,4 +20,23 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // координаты с заранее посчитанными синусом и косинусом широты
+    struct TrigCoordinates {
+        Coordinates coordinates;
+        double sin_lat;
+        double cos_lat;
+    };
+
+    TrigCoordinates PrecomputeTrig(Coordinates point);
+    // то же, что ComputeDistance, но вместо шести тригонометрических функций вычисляются две
+    double ComputeDistance(const TrigCoordinates& from, const TrigCoordinates& to);
+
+    // Пакетный расчет расстояний от точки from до точек из массивов широт и долгот (в градусах),
+    // distances[i] - расстояние от from до точки i.
+    // Синус и косинус широты считаются один раз на точку, арифметика идет по непрерывным
+    // массивам и векторизуется компилятором. Формула и порядок операций те же, что в ComputeDistance,
+    // поэтому результат совпадает с ним до последнего бита (допуск 0 м; при сборке с FMA
+    // возможны расхождения в последнем разряде). Скорость - benchmarks/geo_distance_benchmark.cpp
+    void ComputeDistances(Coordinates from, const double* lats, const double* lngs, size_t count, double* distances);
+
 }  // namespace geo
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #pragma once
 
+#include "memory_report.h"
 #include "ranges.h"
 
 #include <string>
@@ -37,6 +38,10 @@ namespace graph {
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        // память, занятая ребрами (вместе с их названиями) и списками смежности
+        size_t GetEdgesMemoryUsage() const;
+        size_t GetIncidenceListsMemoryUsage() const;
+
     private:
         std::vector<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_;
@@ -75,4 +80,18 @@ namespace graph {
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetEdgesMemoryUsage() const {
+        size_t bytes = memory::Bytes(edges_);
+        for (const auto& edge : edges_) {
+            bytes += memory::Bytes(edge.name);
+        }
+        return bytes;
+    }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetIncidenceListsMemoryUsage() const {
+        return memory::DeepBytes(incidence_lists_);
+    }
 }  // namespace graph
\ No newline at end of file
@@ -84,29 +84,40 @@ Catalogue& Reader::GetCatalogue() {
 void Reader::SetCatalogue(std::istream& in) {
 
 	queries_ = std::move(detail::SetQueryBase(in));
+	query_count_ = static_cast<int>(queries_.size());
+
+	// считаем остановки, чтобы зарезервировать память справочника
+	std::size_t stop_count = 0;
+	for (const auto& query : queries_) {
+		if (query.type == "Stop"sv) {
+			++stop_count;
+		}
+	}
+	CatalogueBuilder builder(catalogue_, stop_count, queries_.size() - stop_count);
 
 	// добавляем остановки в базу
 	for (const auto& query : queries_) {
 		if (query.type == "Stop"sv) {
-			CreateStopBase(query.text);
+			CreateStopBase(query.text, builder);
 		}
 	}
 	// добавляем расстояния между остановками
 	for (const auto& query : queries_) {
 		if (query.type == "Stop"sv) {
-			AddDistance(query.text);
+			AddDistance(query.text, builder);
 		}
 	}
 	// Обработка запроса маршрута
 	for (const auto& query : queries_) {
 		if (query.type == "Bus") {
-			CreateBusBase(query.text);
+			CreateBusBase(query.text, builder);
 		}
 	}
+	builder.Build();
 } // end InputReader::SetCatalogue()
 
 // Добавляем расстояния между остановками
-void Reader::AddDistance(const std::string_view& query_text) {
+void Reader::AddDistance(const std::string_view& query_text, CatalogueBuilder& catalogue) {
 	std::string_view text(query_text);
 	std::string_view from_stop = detail::CreateName(text);
 	std::string_view to_stop;
@@ -152,14 +163,14 @@ void Reader::AddDistance(const std::string_view& query_text) {
 			text.remove_prefix(std::min(text.size(), text.find_first_not_of(' ', pos + 1u)));
 		}
 		// Остановки уже должны иметься в базе
-		auto stopFromPtr = catalogue_.FindStop(from_stop);
-		auto stopToPtr = catalogue_.FindStop(to_stop);
-		catalogue_.AddDistanceBetweenStops({ stopFromPtr, stopToPtr }, distance);
+		auto stopFromPtr = catalogue.FindStop(from_stop);
+		auto stopToPtr = catalogue.FindStop(to_stop);
+		catalogue.AddDistanceBetweenStops({ stopFromPtr, stopToPtr }, static_cast<uint32_t>(distance));
 	}
 }
 
 // Обрабатываем стоп-запрос и вносим его в базу
-Stop Reader::CreateStopBase(const std::string_view query_text) {
+Stop Reader::CreateStopBase(const std::string_view query_text, CatalogueBuilder& catalogue) {
 	std::string_view text(query_text);
 	std::string lat_str, lng_str;
 	Stop stop;
@@ -170,7 +181,7 @@ Stop Reader::CreateStopBase(const std::string_view query_text) {
 	auto pos = text.find(',');
 	// Записываем первую координату
 	lat_str = text.substr(0u, pos);
-	stop.latitude = std::stod(std::move(lat_str));
+	stop.coordinates.lat = std::stod(std::move(lat_str));
 
 	// Удаляем первую координату и знак ","
 	text.remove_prefix(pos + 1u);
@@ -182,17 +193,17 @@ Stop Reader::CreateStopBase(const std::string_view query_text) {
 	}
 	// Записываем вторую координату
 	lng_str = text.substr(0u, text.find_first_of(' '));
-	stop.longitude = std::stod(std::move(lng_str));
+	stop.coordinates.lng = std::stod(std::move(lng_str));
 
 	// Подумать как улучшить и не захватывать лишнее в конце
 	// или обрбатывать остаток дальше (расстояние до др остановки)
-	catalogue_.AddStop(stop);
+	catalogue.AddStop(stop);
 
 	return stop;
 }
 
 // Обрабатываем Bus-запрос и вносим маршрут в базу
-Bus Reader::CreateBusBase(const std::string_view query_text) {
+Bus Reader::CreateBusBase(const std::string_view query_text, CatalogueBuilder& catalogue) {
 	Bus bus;
 	std::string_view text(query_text);
 	
@@ -216,7 +227,7 @@ Bus Reader::CreateBusBase(const std::string_view query_text) {
 		}
 
 		if (separator == text.npos) {
-			Stop* stop_ptr = catalogue_.FindStop(text);
+			const Stop* stop_ptr = catalogue.FindStop(text);
 			bus.stops_ptr.push_back(std::move(stop_ptr));
 			stop_ptr = nullptr;
 			break;
@@ -231,7 +242,7 @@ Bus Reader::CreateBusBase(const std::string_view query_text) {
 			}
 		}
 		// Ищем указатель на остановку
-		Stop* stop_ptr = catalogue_.FindStop(stop_to_bus);
+		const Stop* stop_ptr = catalogue.FindStop(stop_to_bus);
 		bus.stops_ptr.push_back(stop_ptr);
 
 		// Определяем позицию первого непробельного символа после разделителя
@@ -240,13 +251,14 @@ Bus Reader::CreateBusBase(const std::string_view query_text) {
 	}
 	// Добавляем остановки, если маршрут некольцевой
 	if (!is_ring_route) {
-		std::vector<Stop*> temp = bus.stops_ptr;
+		std::vector<const Stop*> temp = bus.stops_ptr;
 
 		for (auto it = rbegin(temp) + 1; it != rend(temp); ++it) {
 			bus.stops_ptr.push_back(*it);
 		}
 	}
-	catalogue_.AddBus(bus.name, bus.stops_ptr);
+	bus.is_roundtrip = is_ring_route;
+	catalogue.AddBus(bus);
 	return bus;
 }// конец обрабатки маршрута
 
@@ -47,11 +47,11 @@ private:
 	Catalogue catalogue_;
 
 	// создание базы остановок
-	Stop CreateStopBase(const std::string_view text);
+	Stop CreateStopBase(const std::string_view text, CatalogueBuilder& catalogue);
 	// создание базы маршрутов
-	Bus CreateBusBase(const std::string_view text);
+	Bus CreateBusBase(const std::string_view text, CatalogueBuilder& catalogue);
 	// добавление расстояния между остановками
-	void AddDistance(const std::string_view& text);
+	void AddDistance(const std::string_view& text, CatalogueBuilder& catalogue);
 };
 } // end of namespace "transport_ctg::input"
 } // end of namespace "transport_ctg"
\ No newline at end of file
@@ -1,6 +1,26 @@
 #include "json.h"
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 
 using namespace std::literals;
 
@@ -8,59 +28,414 @@ namespace json {
 
     namespace {
 
-        Node LoadNode(std::istream& input);
+        // ----- Этап 1: индекс кавычек -----
+        //
+        // Документ просматривается блоками по 64 байта. Для блока строятся битовые маски
+        // (бит i - байт i блока) кавычек, обратных косых черт и переводов строки. По ним без
+        // ветвлений вычисляются экранированные символы и области строк, а позиции
+        // неэкранированных кавычек выписываются в индекс. Второй этап (функции Load* ниже)
+        // по индексу сразу находит конец строки и не просматривает ее посимвольно.
+        // Структурные символы второй этап находит сам: перед ними обычно не больше одного
+        // пробела, и выписывать их в индекс дороже, чем прочитать.
+        // Маски строятся инструкциями AVX2 (если процессор их поддерживает) или SSE2, неполный
+        // последний блок - побайтово. Без векторных инструкций индекс не строится.
+
+        constexpr size_t BLOCK_SIZE = 64;
+
+        struct BlockMasks {
+            uint64_t quotes = 0;
+            uint64_t backslashes = 0;
+            // \n и \r: внутри строки это ошибка, ее сообщит LoadString
+            uint64_t line_breaks = 0;
+        };
+
+        BlockMasks ScanBlockScalar(const char* block) {
+            BlockMasks masks;
+            for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+                const uint64_t bit = uint64_t{ 1 } << i;
+                switch (block[i]) {
+                case '"':
+                    masks.quotes |= bit;
+                    break;
+                case '\\':
+                    masks.backslashes |= bit;
+                    break;
+                case '\n': case '\r':
+                    masks.line_breaks |= bit;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return masks;
+        }
 
-        Node LoadNull(std::istream& input) {
-            const std::string null_str = "null"s;
-            for (size_t i = 0; i < null_str.size(); i++) {
-                if (null_str.at(i) == input.get()) {
+#if defined(__SSE2__) || defined(_M_X64)
+#define JSON_SSE2_SCANNER
+        inline uint64_t MatchSse2(__m128i bytes, char c, size_t shift) {
+            const __m128i matches = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c));
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(matches))) << shift;
+        }
+
+        inline BlockMasks ScanBlockSse2(const char* block) {
+            BlockMasks masks;
+            for (size_t i = 0; i < BLOCK_SIZE; i += 16) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+                masks.quotes |= MatchSse2(bytes, '"', i);
+                masks.backslashes |= MatchSse2(bytes, '\\', i);
+                masks.line_breaks |= MatchSse2(bytes, '\n', i) | MatchSse2(bytes, '\r', i);
+            }
+            return masks;
+        }
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_AVX2_SCANNER
+        __attribute__((target("avx2"), always_inline)) inline uint64_t MatchAvx2(__m256i bytes, char c, size_t shift) {
+            const __m256i matches = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c));
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(matches))) << shift;
+        }
+
+        __attribute__((target("avx2"), always_inline)) inline BlockMasks ScanBlockAvx2(const char* block) {
+            BlockMasks masks;
+            for (size_t i = 0; i < BLOCK_SIZE; i += 32) {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+                masks.quotes |= MatchAvx2(bytes, '"', i);
+                masks.backslashes |= MatchAvx2(bytes, '\\', i);
+                masks.line_breaks |= MatchAvx2(bytes, '\n', i) | MatchAvx2(bytes, '\r', i);
+            }
+            return masks;
+        }
+#endif
+
+        inline int CountTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__)
+            return __builtin_ctzll(bits);
+#else
+            int count = 0;
+            while ((bits & 1) == 0) {
+                bits >>= 1;
+                ++count;
+            }
+            return count;
+#endif
+        }
+
+        // бит i результата - xor битов 0..i: единицы от открывающей кавычки до закрывающей
+        inline uint64_t PrefixXor(uint64_t bits) {
+            bits ^= bits << 1;
+            bits ^= bits << 2;
+            bits ^= bits << 4;
+            bits ^= bits << 8;
+            bits ^= bits << 16;
+            bits ^= bits << 32;
+            return bits;
+        }
+
+        // бит элемента индекса: закрывающая кавычка строки с escape-последовательностями
+        // или переводами строки
+        constexpr uint64_t ESCAPED_STRING = uint64_t{ 1 } << 63;
+
+        // Выписанные элементы индекса и состояние на границе блоков: следующий символ
+        // экранирован, блок начинается внутри строки, в текущей строке была escape-последовательность
+        struct IndexState {
+            const char* document;
+            uint64_t* filled;
+            uint64_t prev_escaped = 0;
+            uint64_t prev_in_string = 0;
+            bool pending_escape = false;
+        };
+
+        // дописывает в индекс элементы блока, который находится в документе по адресу position
+#if defined(__GNUC__)
+        __attribute__((always_inline))
+#endif
+        inline void AddBlock(IndexState& state, const BlockMasks& masks, const char* position) {
+            const uint64_t offset = static_cast<uint64_t>(position - state.document);
+
+            // экранирован символ после нечетного количества обратных косых черт подряд
+            constexpr uint64_t even_bits = 0x5555555555555555ULL;
+            const uint64_t backslashes = masks.backslashes & ~state.prev_escaped;
+            const uint64_t follows_escape = backslashes << 1 | state.prev_escaped;
+            const uint64_t odd_starts = backslashes & ~even_bits & ~follows_escape;
+            const uint64_t even_starts = odd_starts + backslashes;
+            state.prev_escaped = even_starts < odd_starts ? 1 : 0;
+            const uint64_t escaped = (even_bits ^ (even_starts << 1)) & follows_escape;
+
+            const uint64_t quotes = masks.quotes & ~escaped;
+            const uint64_t in_string = PrefixXor(quotes) ^ state.prev_in_string;
+            state.prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+            const uint64_t special = (masks.backslashes | masks.line_breaks) & in_string;
+
+            if (special == 0 && !state.pending_escape) {
+                for (uint64_t bits = quotes; bits != 0; bits &= bits - 1) {
+                    *state.filled++ = offset + CountTrailingZeros(bits);
+                }
+                return;
+            }
+            const uint64_t closing_quotes = quotes & ~in_string;
+            for (uint64_t bits = quotes | special; bits != 0; bits &= bits - 1) {
+                const int i = CountTrailingZeros(bits);
+                const uint64_t bit = uint64_t{ 1 } << i;
+                if ((special & bit) != 0) {
+                    state.pending_escape = true;
                     continue;
-                } else {
-                    throw ParsingError("LoadNull parsing error"s);
                 }
+                uint64_t entry = offset + i;
+                if ((closing_quotes & bit) != 0 && state.pending_escape) {
+                    entry |= ESCAPED_STRING;
+                    state.pending_escape = false;
+                }
+                *state.filled++ = entry;
+            }
+        }
+
+        // Индексирует целые блоки [begin, end). Для каждого набора инструкций своя функция,
+        // чтобы построение масок и AddBlock встраивались в один цикл
+        using IndexBlocksFunction = void (*)(IndexState&, const char*, const char*);
+
+#ifdef JSON_SSE2_SCANNER
+        void IndexBlocksSse2(IndexState& state, const char* begin, const char* end) {
+            for (; begin != end; begin += BLOCK_SIZE) {
+                AddBlock(state, ScanBlockSse2(begin), begin);
             }
-            return {};
         }
+#endif
 
-        Node LoadArray(std::istream& input) {
-            Array result;
-            if (input.peek() == -1) {
-                throw ParsingError("Array parsing error");
+#ifdef JSON_AVX2_SCANNER
+        __attribute__((target("avx2"))) void IndexBlocksAvx2(IndexState& state, const char* begin, const char* end) {
+            for (; begin != end; begin += BLOCK_SIZE) {
+                AddBlock(state, ScanBlockAvx2(begin), begin);
             }
-            for (char c; input >> c && c != ']';) {
+        }
+#endif
+
+        // Выбирает реализацию по возможностям процессора, на котором запущена программа.
+        // Без векторных инструкций индекс не строится: побайтовые маски обходятся дороже,
+        // чем однопроходный поиск конца строки в FindStringEnd
+        IndexBlocksFunction SelectIndexBlocks() {
+#ifdef JSON_AVX2_SCANNER
+            if (__builtin_cpu_supports("avx2")) {
+                return IndexBlocksAvx2;
+            }
+#endif
+#ifdef JSON_SSE2_SCANNER
+            return IndexBlocksSse2;
+#else
+            return nullptr;
+#endif
+        }
+
+        std::atomic<QuoteIndexMode> quote_index_mode = QuoteIndexMode::AUTO;
+
+        // Индекс строится порциями по мере чтения, поэтому занимает память порции, а не документа.
+        // Элемент индекса - смещение символа от начала документа, возможно, с битом ESCAPED_STRING.
+        // На коротких строках индекс медленнее побайтового поиска конца строки: каждая строка
+        // стоит двух элементов, а просматривать почти нечего. Поэтому, если средняя длина строк
+        // порции меньше MIN_AVERAGE_LENGTH, индекс выключается до конца документа (режим AUTO)
+        class QuoteIndex {
+        public:
+            static constexpr uint64_t END = ~uint64_t{ 0 };
+
+            explicit QuoteIndex(std::string_view text)
+                : mode_(quote_index_mode.load(std::memory_order_relaxed))
+                , index_blocks_(mode_ != QuoteIndexMode::NEVER ? GetIndexBlocks() : nullptr)
+                , next_(text.data())
+                , end_(text.data() + text.size())
+                , entries_(index_blocks_ != nullptr ? std::make_unique<uint64_t[]>(CHUNK_SIZE) : nullptr)
+                , current_(entries_.get())
+                , state_{ text.data(), entries_.get() } {
+            }
+
+            // индекс не строится, если процессор не поддерживает нужных инструкций,
+            // и выключается на документе с короткими строками (проверять после Peek)
+            bool IsEnabled() const {
+                return index_blocks_ != nullptr;
+            }
+
+            // текущий элемент индекса или END, если документ закончился
+            uint64_t Peek() {
+                if (current_ == state_.filled && !Refill()) {
+                    return END;
+                }
+                return *current_;
+            }
+
+            void Pop() {
+                ++current_;
+            }
+
+        private:
+            static constexpr size_t CHUNK_SIZE = 64 * BLOCK_SIZE;
+            static constexpr uint64_t MIN_AVERAGE_LENGTH = 16;
+
+            QuoteIndexMode mode_;
+            IndexBlocksFunction index_blocks_;
+            const char* next_;
+            const char* end_;
+            // в порции не больше CHUNK_SIZE символов, значит, и элементов индекса
+            std::unique_ptr<uint64_t[]> entries_;
+            uint64_t* current_;
+            IndexState state_;
+            // текущая порция начинается внутри строки
+            bool starts_in_string_ = false;
+
+            static IndexBlocksFunction GetIndexBlocks() {
+                static const IndexBlocksFunction index_blocks = SelectIndexBlocks();
+                return index_blocks;
+            }
+
+            // Средняя длина строк порции меньше MIN_AVERAGE_LENGTH. Порция должна заканчиваться
+            // вне строки: тогда все ее строки уже прочитаны, и следующую можно искать без индекса
+            bool HasShortStrings(bool starts_in_string) const {
+                if (state_.prev_in_string != 0) {
+                    return false;
+                }
+                // элементы порции, которая начинается вне строки, - пары кавычек
+                const uint64_t* entry = entries_.get() + (starts_in_string ? 1 : 0);
+                uint64_t length = 0;
+                uint64_t count = 0;
+                for (; entry + 1 < state_.filled; entry += 2, ++count) {
+                    length += (entry[1] & ~ESCAPED_STRING) - (entry[0] & ~ESCAPED_STRING);
+                }
+                return length < count * MIN_AVERAGE_LENGTH;
+            }
+
+            bool Refill() {
+                if (index_blocks_ == nullptr) {
+                    return false;
+                }
+                if (mode_ == QuoteIndexMode::AUTO && current_ != entries_.get() && HasShortStrings(starts_in_string_)) {
+                    index_blocks_ = nullptr;
+                    return false;
+                }
+                starts_in_string_ = state_.prev_in_string != 0;
+                current_ = state_.filled = entries_.get();
+                while (state_.filled == current_ && next_ != end_) {
+                    const size_t size = std::min(CHUNK_SIZE, static_cast<size_t>(end_ - next_));
+                    const char* const blocks_end = next_ + size / BLOCK_SIZE * BLOCK_SIZE;
+                    index_blocks_(state_, next_, blocks_end);
+                    next_ = blocks_end;
+                    if (size % BLOCK_SIZE != 0) {
+                        // хвост документа дополняется пробелами до целого блока
+                        char block[BLOCK_SIZE];
+                        std::fill(std::copy(next_, end_, block), block + BLOCK_SIZE, ' ');
+                        AddBlock(state_, ScanBlockScalar(block), next_);
+                        next_ = end_;
+                    }
+                }
+                return state_.filled != current_;
+            }
+        };
+
+        // ----- Этап 2: разбор по индексу -----
+
+        // JSON-документ в непрерывном буфере, текущая позиция разбора и индекс
+        struct Input {
+            const char* begin;
+            const char* pos;
+            const char* end;
+            QuoteIndex index;
+            // память для массивов и словарей дерева
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+            // элементы массивов и словарей, которые еще читаются (вложенные лежат после внешних)
+            std::vector<Node> array_items = {};
+            std::vector<Dict::value_type> dict_items = {};
+            // есть строки, которые хранят символы в куче, а не внутри объекта
+            bool heap_strings = false;
+
+            explicit Input(std::string_view text)
+                : begin(text.data())
+                , pos(text.data())
+                , end(text.data() + text.size())
+                , index(text) {
+            }
+
+            bool IsEnd() const {
+                return pos == end;
+            }
+
+            // пропускает пробельные символы (те же, что пропускает operator>> у потока)
+            void SkipSpaces() {
+                while (pos != end && (*pos == ' ' || (*pos >= '\t' && *pos <= '\r'))) {
+                    ++pos;
+                }
+            }
+
+            // пропускает пробелы и возвращает следующий символ
+            char NextChar(const char* error_message) {
+                SkipSpaces();
+                if (pos == end) {
+                    throw ParsingError(error_message);
+                }
+                return *pos++;
+            }
+        };
+
+        Node LoadNode(Input& input);
+
+        // проверяет, что в буфере записано слово word
+        void ReadWord(Input& input, std::string_view word, const char* error_message) {
+            if (static_cast<size_t>(input.end - input.pos) < word.size()
+                || std::string_view(input.pos, word.size()) != word) {
+                throw ParsingError(error_message);
+            }
+            input.pos += word.size();
+        }
+
+        Node LoadNull(Input& input) {
+            ReadWord(input, "null"sv, "LoadNull parsing error");
+            return {};
+        }
+
+        Node LoadArray(Input& input) {
+            const size_t first_item = input.array_items.size();
+            while (true) {
+                const char c = input.NextChar("Array parsing error");
+                if (c == ']') {
+                    break;
+                }
                 if (c != ',') {
-                    input.putback(c);
+                    --input.pos;
                 }
-                result.push_back(LoadNode(input));
+                input.array_items.push_back(LoadNode(input));
             }
+            // массив размещается в арене один раз, точно под количество элементов
+            const auto first = input.array_items.begin() + first_item;
+            Array result(std::make_move_iterator(first), std::make_move_iterator(input.array_items.end()), input.resource);
+            input.array_items.erase(first, input.array_items.end());
             return Node(std::move(result));
         }
 
         // Считывает содержимое строкового литерала JSON-документа
-        // Функцию следует использовать после считывания     открывающего символа ":
-        std::string LoadString(std::istream& input) {
-
-            auto it = std::istreambuf_iterator<char>(input);
-            auto end = std::istreambuf_iterator<char>();
+        // Функцию следует использовать после считывания открывающего символа ":
+        // участки без escape-последовательностей копируются в строку целиком
+        std::string LoadString(Input& input) {
             std::string s;
             while (true) {
-                if (it == end) {
+                const char* chunk_end = input.pos;
+                while (chunk_end != input.end && *chunk_end != '"' && *chunk_end != '\\'
+                    && *chunk_end != '\n' && *chunk_end != '\r') {
+                    ++chunk_end;
+                }
+                if (chunk_end == input.end) {
                     // Поток закончился до того, как встретили закрывающую кавычку?
                     throw ParsingError("String parsing error");
                 }
-                const char ch = *it;
+                s.append(input.pos, chunk_end);
+                input.pos = chunk_end + 1;
+
+                const char ch = *chunk_end;
                 if (ch == '"') {
                     // Встретили закрывающую кавычку
-                    ++it;
                     break;
                 } else if (ch == '\\') {
                     // Встретили начало escape-последовательности
-                    ++it;
-                    if (it == end) {
+                    if (input.IsEnd()) {
                         // Поток завершился сразу после символа обратной косой черты
                         throw ParsingError("String parsing error");
                     }
-                    const char escaped_char = *(it);
+                    const char escaped_char = *input.pos++;
                     // Обрабатываем одну из последовательностей: \\, \n, \t, \r, \"
                     switch (escaped_char) {
                     case 'n':
@@ -82,46 +457,41 @@ namespace json {
                         // Встретили неизвестную escape-последовательность
                         throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
                     }
-                } else if (ch == '\n' || ch == '\r') {
+                } else {
                     // Строковый литерал внутри- JSON не может прерываться символами \r или \n
                     throw ParsingError("Unexpected end of line"s);
-                } else {
-                    // Просто считываем очередной символ и помещаем его в результирующую строку
-                    s.push_back(ch);
                 }
-                ++it;
             }
             return s;
         }
 
-        Node LoadNumber(std::istream& input) {
+        Node LoadNumber(Input& input) {
+            const char* const begin = input.pos;
 
-            std::string parsed_num;
-
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
-                }
+            auto is_digit = [&input] {
+                return !input.IsEnd() && *input.pos >= '0' && *input.pos <= '9';
             };
 
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
+            // Пропускает одну или более цифр
+            auto read_digits = [&input, &is_digit] {
+                if (!is_digit()) {
                     throw ParsingError("A digit is expected"s);
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (is_digit()) {
+                    ++input.pos;
                 }
             };
 
-            if (input.peek() == '-') {
-                read_char();
+            auto next_is = [&input](char c) {
+                return !input.IsEnd() && *input.pos == c;
+            };
+
+            if (next_is('-')) {
+                ++input.pos;
             }
             // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
+            if (next_is('0')) {
+                ++input.pos;
                 // После 0 в JSON не могут идти другие цифры
             } else {
                 read_digits();
@@ -129,87 +499,145 @@ namespace json {
 
             bool is_int = true;
             // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
+            if (next_is('.')) {
+                ++input.pos;
                 read_digits();
                 is_int = false;
             }
 
             // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            if (next_is('e') || next_is('E')) {
+                ++input.pos;
+                if (next_is('+') || next_is('-')) {
+                    ++input.pos;
                 }
                 read_digits();
                 is_int = false;
             }
 
-            try {
-                if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return std::stoi(parsed_num);
-                    } catch (...) {
-                        // В случае неудачи, например, при переполнении,
-                        // код ниже попробует преобразовать строку в double
-                    }
+            if (is_int) {
+                // Сначала пробуем преобразовать строку в int,
+                // при переполнении код ниже преобразует ее в double
+                int value = 0;
+                if (const auto [ptr, ec] = std::from_chars(begin, input.pos, value); ec == std::errc() && ptr == input.pos) {
+                    return value;
                 }
-                return std::stod(parsed_num);
-            } catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
             }
+            double value = 0.;
+            if (const auto [ptr, ec] = std::from_chars(begin, input.pos, value); ec == std::errc() && ptr == input.pos) {
+                return value;
+            }
+            throw ParsingError("Failed to convert "s + std::string(begin, input.pos) + " to number"s);
         }
 
-        Node LoadBool(std::istream& input) {
-            const std::string false_str = "false"s;
-            const std::string true_str = "true"s;
-            char c = input.get();
-            bool value = (c == 't');
-            std::string const* res = value ? &true_str : &false_str;
-            for (size_t i = 1; i < res->size(); i++) {
-                if (res->at(i) == input.get()) {
-                    continue;
-                } else {
-                    throw ParsingError("Bool parsing error");
+        Node LoadBool(Input& input) {
+            if (!input.IsEnd() && *input.pos == 't') {
+                ReadWord(input, "true"sv, "Bool parsing error");
+                return Node(true);
+            }
+            ReadWord(input, "false"sv, "Bool parsing error");
+            return Node(false);
+        }
+
+        // Находит закрывающую кавычку строки, открывающая уже прочитана. Возвращает nullptr,
+        // если в строке есть escape-последовательности и ее нужно разбирать посимвольно (LoadString)
+        const char* FindStringEnd(Input& input) {
+            // все предыдущие строки уже прочитаны, так что первая кавычка в индексе - открывающая
+            const uint64_t open = input.index.IsEnabled() ? input.index.Peek() : QuoteIndex::END;
+            if (!input.index.IsEnabled()) {
+                // без индекса строка просматривается до первого особого символа
+                const char* string_end = input.pos;
+                while (string_end != input.end && *string_end != '"' && *string_end != '\\'
+                    && *string_end != '\n' && *string_end != '\r') {
+                    ++string_end;
                 }
+                return string_end != input.end && *string_end == '"' ? string_end : nullptr;
+            }
+            if (open != static_cast<uint64_t>(input.pos - 1 - input.begin)) {
+                throw ParsingError("String parsing error");
+            }
+            input.index.Pop();
+            const uint64_t close = input.index.Peek();
+            if (close == QuoteIndex::END) {
+                // Поток закончился до того, как встретили закрывающую кавычку
+                throw ParsingError("String parsing error");
+            }
+            input.index.Pop();
+            if ((close & ESCAPED_STRING) != 0) {
+                return nullptr;
             }
-            return Node(value);
+            return input.begin + close;
         }
 
-        Node LoadDict(std::istream& input) {
-            Dict result;
-            if (input.peek() == -1) {
-                throw ParsingError("Dictionary parsing error");
+        // Считывает строку после открывающей кавычки
+        std::string LoadStringValue(Input& input) {
+            if (const char* string_end = FindStringEnd(input)) {
+                std::string s(input.pos, string_end);
+                input.pos = string_end + 1;
+                return s;
             }
-            for (char c; input >> c && c != '}';) {
+            return LoadString(input);
+        }
+
+        // Считывает строку (ключ словаря или значение). Если в ней нет escape-последовательностей,
+        // возвращается ссылка прямо на буфер документа, иначе строка собирается в storage
+        std::string_view LoadStringView(Input& input, std::string& storage) {
+            if (const char* key_end = FindStringEnd(input)) {
+                const std::string_view key(input.pos, key_end - input.pos);
+                input.pos = key_end + 1;
+                return key;
+            }
+            storage = LoadString(input);
+            return storage;
+        }
+
+        Node LoadDict(Input& input) {
+            const size_t first_item = input.dict_items.size();
+            std::string key_storage;
+            while (true) {
+                char c = input.NextChar("Dictionary parsing error");
+                if (c == '}') {
+                    break;
+                }
                 if (c == ',') {
-                    input >> c;
+                    c = input.NextChar("Dictionary parsing error");
                 }
-
-                std::string key = LoadString(input);
-                input >> c;
-                result.insert({ std::move(key), LoadNode(input) });
+                if (c != '"') {
+                    throw ParsingError("Dictionary parsing error");
+                }
+                const std::string_view key = Dict::StoreKey(LoadStringView(input, key_storage), input.resource);
+                if (input.NextChar("Dictionary parsing error") != ':') {
+                    throw ParsingError("Dictionary parsing error");
+                }
+                Node value = LoadNode(input);
+                input.dict_items.emplace_back(key, std::move(value));
             }
-            return Node(std::move(result));
+            // в словарь переносятся только его элементы, память выделяется точно под их количество
+            const auto first = input.dict_items.begin() + first_item;
+            Dict::Items items(std::make_move_iterator(first), std::make_move_iterator(input.dict_items.end()), input.resource);
+            input.dict_items.erase(first, input.dict_items.end());
+            return Node(Dict::FromUnsortedStored(std::move(items)));
         }
 
-        Node LoadNode(std::istream& input) {
-            char c;
-            input >> c;
+        Node LoadNode(Input& input) {
+            const char c = input.NextChar("Unexpected end of document");
 
             switch (c) {
             case 'n': {
-                input.putback(c);
+                --input.pos;
                 return LoadNull(input);
             }
             case '"': {
-                return LoadString(input);
+                std::string value = LoadStringValue(input);
+                if (value.capacity() > std::string().capacity()) {
+                    input.heap_strings = true;
+                }
+                return Node(std::move(value));
             }
             case 't': {
             }
             case 'f': {
-                input.putback(c);
+                --input.pos;
                 return LoadBool(input);
             }
             case '[': {
@@ -220,15 +648,378 @@ namespace json {
             }
             default:
             {
-                input.putback(c);
+                --input.pos;
                 return LoadNumber(input);
             }
             }
 
         }
 
+        // storage - буфер для строк с escape-последовательностями, общий для всего разбора
+        void ParseNode(Input& input, Handler& handler, std::string& storage) {
+            const char c = input.NextChar("Unexpected end of document");
+
+            switch (c) {
+            case 'n': {
+                --input.pos;
+                LoadNull(input);
+                handler.Null();
+                break;
+            }
+            case '"': {
+                handler.String(LoadStringView(input, storage));
+                break;
+            }
+            case 't': {
+            }
+            case 'f': {
+                --input.pos;
+                handler.Bool(LoadBool(input).AsBool());
+                break;
+            }
+            case '[': {
+                handler.StartArray();
+                while (true) {
+                    const char next = input.NextChar("Array parsing error");
+                    if (next == ']') {
+                        break;
+                    }
+                    if (next != ',') {
+                        --input.pos;
+                    }
+                    ParseNode(input, handler, storage);
+                }
+                handler.EndArray();
+                break;
+            }
+            case '{': {
+                handler.StartDict();
+                while (true) {
+                    char next = input.NextChar("Dictionary parsing error");
+                    if (next == '}') {
+                        break;
+                    }
+                    if (next == ',') {
+                        next = input.NextChar("Dictionary parsing error");
+                    }
+                    if (next != '"') {
+                        throw ParsingError("Dictionary parsing error");
+                    }
+                    handler.Key(LoadStringView(input, storage));
+                    if (input.NextChar("Dictionary parsing error") != ':') {
+                        throw ParsingError("Dictionary parsing error");
+                    }
+                    ParseNode(input, handler, storage);
+                }
+                handler.EndDict();
+                break;
+            }
+            default:
+            {
+                --input.pos;
+                const Node number = LoadNumber(input);
+                if (number.IsInt()) {
+                    handler.Int(number.AsInt());
+                } else {
+                    handler.Double(number.AsDouble());
+                }
+            }
+            }
+        }
+
     }  // namespace
 
+    namespace {
+
+        // Общее хранилище ключей схемы: открытая адресация с линейным пробированием.
+        // Слот хранит хеш рядом с ключом, поэтому промах по слоту почти никогда не требует
+        // чтения самой строки. Размер хранилища фиксирован (не больше MAX_KEYS ключей
+        // и CHARS_SIZE байт символов), и в него попадают только короткие ключи-идентификаторы,
+        // поэтому ключи-данные (например, названия остановок в road_distances) его не заполняют
+        // и хранятся в своих словарях.
+        class SchemaKeyPool {
+        public:
+            static constexpr size_t MAX_KEY_SIZE = 32;
+
+            // ключ из хранилища; пустой string_view с data() == nullptr, если ключа нет и места для него не осталось
+            std::string_view Find(std::string_view key, uint64_t hash) {
+                std::lock_guard guard(mutex_);
+                const size_t mask = SLOT_COUNT - 1;
+                for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                    Slot& slot = slots_[i];
+                    if (slot.key.data() == nullptr) {
+                        if (size_ == MAX_KEYS || chars_used_ + key.size() > CHARS_SIZE) {
+                            return {};
+                        }
+                        char* data = chars_ + chars_used_;
+                        std::copy(key.begin(), key.end(), data);
+                        chars_used_ += key.size();
+                        slot = { hash, { data, key.size() } };
+                        ++size_;
+                        return slot.key;
+                    }
+                    if (slot.hash == hash && slot.key == key) {
+                        return slot.key;
+                    }
+                }
+            }
+
+            // лежат ли символы в хранилище (адрес не меняется, поэтому блокировка не нужна)
+            bool Contains(const char* data) const {
+                const std::less<const char*> less;
+                return !less(data, chars_) && less(data, chars_ + CHARS_SIZE);
+            }
+
+        private:
+            static constexpr size_t MAX_KEYS = 1024;
+            // заполнено не больше половины слотов
+            static constexpr size_t SLOT_COUNT = 2 * MAX_KEYS;
+            static constexpr size_t CHARS_SIZE = 16 * 1024;
+
+            struct Slot {
+                uint64_t hash = 0;
+                std::string_view key;
+            };
+
+            std::mutex mutex_;
+            Slot slots_[SLOT_COUNT] = {};
+            size_t size_ = 0;
+            char chars_[CHARS_SIZE] = {};
+            size_t chars_used_ = 0;
+        };
+
+        SchemaKeyPool& GetSchemaKeyPool() {
+            static SchemaKeyPool pool;
+            return pool;
+        }
+
+        // ключ схемы - непустой короткий идентификатор из латинских букв, цифр, '_' и '-'
+        bool IsSchemaKey(std::string_view key) {
+            if (key.empty() || key.size() > SchemaKeyPool::MAX_KEY_SIZE) {
+                return false;
+            }
+            return std::all_of(key.begin(), key.end(), [](char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+            });
+        }
+
+        // ключ из общего хранилища; пустой string_view с data() == nullptr, если ключ туда не попадает
+        std::string_view FindSchemaKey(std::string_view key) {
+            if (!IsSchemaKey(key)) {
+                return {};
+            }
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for (const char c : key) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+            // кеш потока без блокировки: ключи вроде "type" и "name" повторяются постоянно
+            constexpr size_t cache_size = 256;
+            thread_local std::string_view cache[cache_size];
+            std::string_view& cached = cache[(hash >> 32) % cache_size];
+            if (cached.data() != nullptr && cached == key) {
+                return cached;
+            }
+            const std::string_view stored = GetSchemaKeyPool().Find(key, hash);
+            if (stored.data() != nullptr) {
+                cached = stored;
+            }
+            return stored;
+        }
+
+    }  // namespace
+
+    // ----- Dict -----
+
+    Dict::Dict(std::initializer_list<std::pair<std::string_view, Node>> items) {
+        items_.reserve(items.size());
+        for (const auto& [key, value] : items) {
+            emplace(key, value);
+        }
+    }
+
+    Dict::Dict(Items items)
+        : items_(std::move(items)) {
+    }
+
+    Dict::Dict(const Dict& other)
+        : items_(other.items_) {
+        StoreKeys();
+    }
+
+    // перемещающий конструктор pmr-вектора забирает буфер вместе с распределителем,
+    // поэтому ключи остаются в той же памяти
+    Dict::Dict(Dict&& other) noexcept
+        : items_(std::move(other.items_)) {
+    }
+
+    Dict& Dict::operator=(const Dict& other) {
+        if (this != &other) {
+            ReleaseKeys();
+            items_ = other.items_;
+            StoreKeys();
+        }
+        return *this;
+    }
+
+    Dict& Dict::operator=(Dict&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        ReleaseKeys();
+        if (items_.get_allocator() == other.items_.get_allocator()) {
+            items_ = std::move(other.items_);
+        } else {
+            // элементы перемещаются по одному в память этого словаря, ключи копируются;
+            // перемещающее присваивание вектора очистило бы other до освобождения его ключей
+            items_.assign(std::make_move_iterator(other.items_.begin()), std::make_move_iterator(other.items_.end()));
+            StoreKeys();
+            other.ReleaseKeys();
+        }
+        other.items_.clear();
+        return *this;
+    }
+
+    Dict::~Dict() {
+        ReleaseKeys();
+    }
+
+    std::string_view Dict::StoreKey(std::string_view key, std::pmr::memory_resource* resource) {
+        if (key.empty()) {
+            return ""sv;
+        }
+        if (const std::string_view schema_key = FindSchemaKey(key); schema_key.data() != nullptr) {
+            return schema_key;
+        }
+        char* data = static_cast<char*>(resource->allocate(key.size(), alignof(char)));
+        std::copy(key.begin(), key.end(), data);
+        return { data, key.size() };
+    }
+
+    std::pmr::memory_resource* Dict::GetResource() const {
+        return items_.get_allocator().resource();
+    }
+
+    void Dict::StoreKeys() {
+        std::pmr::memory_resource* resource = GetResource();
+        for (auto& item : items_) {
+            item.first = StoreKey(item.first, resource);
+        }
+    }
+
+    void Dict::ReleaseKey(std::string_view key, std::pmr::memory_resource* resource) {
+        if (!key.empty() && !GetSchemaKeyPool().Contains(key.data())) {
+            resource->deallocate(const_cast<char*>(key.data()), key.size(), alignof(char));
+        }
+    }
+
+    void Dict::ReleaseKeys() {
+        std::pmr::memory_resource* resource = GetResource();
+        for (const auto& item : items_) {
+            ReleaseKey(item.first, resource);
+        }
+    }
+
+    Dict Dict::FromUnsorted(Items items) {
+        std::pmr::memory_resource* resource = items.get_allocator().resource();
+        for (auto& item : items) {
+            item.first = StoreKey(item.first, resource);
+        }
+        return FromUnsortedStored(std::move(items));
+    }
+
+    Dict Dict::FromUnsortedStored(Items items) {
+        const auto key_less = [](const value_type& lhs, const value_type& rhs) {
+            return lhs.first < rhs.first;
+        };
+        // сортировки должны быть устойчивыми, чтобы из повторяющихся ключей первым остался первый;
+        // словари документов обычно маленькие, для них сортировка вставками не выделяет память
+        constexpr size_t insertion_sort_size = 16;
+        if (items.size() <= insertion_sort_size) {
+            for (size_t i = 1; i < items.size(); ++i) {
+                for (size_t j = i; j > 0 && key_less(items[j], items[j - 1]); --j) {
+                    std::swap(items[j], items[j - 1]);
+                }
+            }
+        } else {
+            std::stable_sort(items.begin(), items.end(), key_less);
+        }
+        // как std::unique, но ключи отброшенных повторов освобождаются
+        std::pmr::memory_resource* resource = items.get_allocator().resource();
+        auto unique_end = items.begin();
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (unique_end != items.begin() && std::prev(unique_end)->first == it->first) {
+                ReleaseKey(it->first, resource);
+                continue;
+            }
+            if (unique_end != it) {
+                *unique_end = std::move(*it);
+            }
+            ++unique_end;
+        }
+        items.erase(unique_end, items.end());
+
+        // перемещающее присваивание pmr-вектора с другим распределителем скопировало бы элементы
+        return Dict(std::move(items));
+    }
+
+    void Dict::reserve(size_t size) {
+        items_.reserve(size);
+    }
+
+    Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+        // в маленьких словарях линейный поиск быстрее двоичного
+        constexpr size_t linear_search_size = 8;
+        if (items_.size() <= linear_search_size) {
+            auto it = items_.begin();
+            while (it != items_.end() && it->first < key) {
+                ++it;
+            }
+            return it;
+        }
+        return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view key) {
+            return item.first < key;
+        });
+    }
+
+    Node& Dict::at(std::string_view key) {
+        return const_cast<Node&>(static_cast<const Dict&>(*this).at(key));
+    }
+
+    const Node& Dict::at(std::string_view key) const {
+        const auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Dict has no key "s + std::string(key));
+        }
+        return it->second;
+    }
+
+    Node& Dict::operator[](std::string_view key) {
+        return emplace(key, Node{}).first->second;
+    }
+
+    std::pair<Dict::iterator, bool> Dict::emplace(std::string_view key, Node value) {
+        const auto position = LowerBound(key) - items_.cbegin();
+        if (position != static_cast<std::ptrdiff_t>(items_.size()) && items_[position].first == key) {
+            return { iterator(items_.begin() + position), false };
+        }
+        return { iterator(items_.emplace(items_.begin() + position, StoreKey(key, GetResource()), std::move(value))), true };
+    }
+
+    std::pair<Dict::iterator, bool> Dict::insert(value_type item) {
+        return emplace(item.first, std::move(item.second));
+    }
+
+    bool Dict::operator==(const Dict& other) const {
+        return items_ == other.items_;
+    }
+
+    bool Dict::operator!=(const Dict& other) const {
+        return !(*this == other);
+    }
+
+    // ----- Node -----
+
     Node::Node(std::nullptr_t null)
         : value_(null) {
     }
@@ -350,98 +1141,315 @@ namespace json {
     Node::Value& Node::GetValue() { return value_; }
 
     Document::Document(Node root)
+        : root_(std::make_shared<const Node>(std::move(root))) {
+    }
+
+    Document::Document(std::shared_ptr<const Node> root)
         : root_(std::move(root)) {
     }
 
     bool Document::operator==(const Document& other) const {
-        return root_ == other.root_;
+        return *root_ == *other.root_;
     }
 
     bool Document::operator!=(const Document& other) const {
-        return !(root_ == other.root_);
+        return !(*root_ == *other.root_);
     }
 
 
     const Node& Document::GetRoot() const {
-        return root_;
+        return *root_;
+    }
+
+    void SetQuoteIndexMode(QuoteIndexMode mode) {
+        quote_index_mode.store(mode, std::memory_order_relaxed);
+    }
+
+    void Parse(std::string_view input, Handler& handler) {
+        Input buffer(input);
+        std::string storage;
+        ParseNode(buffer, handler, storage);
+    }
+
+    void Parse(std::istream& input, Handler& handler) {
+        const std::string buffer{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+        Parse(std::string_view(buffer), handler);
+    }
+
+    namespace {
+
+        // Арена разобранного документа вместе с его корнем
+        struct Arena {
+            std::pmr::monotonic_buffer_resource resource;
+            Node* root = nullptr;
+            // дерево владеет памятью вне арены, его нужно разрушить поузлово
+            bool owns_heap_memory = true;
+
+            explicit Arena(size_t initial_size)
+                : resource(initial_size) {
+            }
+
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            ~Arena() {
+                if (root != nullptr && owns_heap_memory) {
+                    std::destroy_at(root);
+                }
+                // остальная память освобождается вместе с resource целыми блоками
+            }
+        };
+
+    }  // namespace
+
+    Document Load(std::string_view input) {
+        // дерево обычно в несколько раз больше текста документа, начальный блок - размером с текст
+        constexpr size_t min_arena_size = 4096;
+        auto arena = std::make_shared<Arena>(std::max(input.size(), min_arena_size));
+        {
+            Input buffer(input);
+            buffer.resource = &arena->resource;
+            Node root = LoadNode(buffer);
+            void* place = arena->resource.allocate(sizeof(Node), alignof(Node));
+            arena->root = new (place) Node(std::move(root));
+            arena->owns_heap_memory = buffer.heap_strings;
+        }
+        const Node* root = arena->root;
+        return Document(std::shared_ptr<const Node>(std::move(arena), root));
     }
 
     Document Load(std::istream& input) {
-        return Document{ LoadNode(input) };
+        const std::string buffer{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+        return Load(std::string_view(buffer));
+    }
+
+    Document LoadFile(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Can't open file "s + path);
+        }
+        // размер файла известен заранее, поэтому он читается одним блоком
+        input.seekg(0, std::ios::end);
+        std::string buffer(static_cast<size_t>(input.tellg()), '\0');
+        input.seekg(0, std::ios::beg);
+        input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        return Load(std::string_view(buffer));
     }
 
     // -----------------------------------
 
+    void AppendEscapedChars(std::string& out, std::string_view value) {
+        // участки без служебных символов копируются целиком
+        size_t run_begin = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            const char c = value[i];
+            if (c != '"' && c != '\\' && c != '\n' && c != '\r') {
+                continue;
+            }
+            out.append(value.data() + run_begin, i - run_begin);
+            switch (c) {
+            case '\n':
+                out.append("\\n"sv);
+                break;
+            case '\r':
+                out.append("\\r"sv);
+                break;
+            default:
+                out.push_back('\\');
+                out.push_back(c);
+            }
+            run_begin = i + 1;
+        }
+        out.append(value.data() + run_begin, value.size() - run_begin);
+    }
+
+    namespace {
+
+        // дописывает к out строку в кавычках с экранированными служебными символами
+        void AppendEscaped(std::string& out, std::string_view value) {
+            out.push_back('"');
+            AppendEscapedChars(out, value);
+            out.push_back('"');
+        }
+
+    }  // namespace
+
+    std::string EscapeString(std::string_view value) {
+        std::string result;
+        result.reserve(value.size() + value.size() / 8 + 2);
+        AppendEscaped(result, value);
+        return result;
+    }
+
+    Writer::Writer(std::ostream& out)
+        : out_(out) {
+        buffer_.reserve(FLUSH_THRESHOLD + FLUSH_THRESHOLD / 4);
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    void Writer::Write(std::string_view text) {
+        if (text.size() >= FLUSH_THRESHOLD) {
+            Flush();
+            out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+            return;
+        }
+        buffer_.append(text);
+        FlushIfFull();
+    }
+
+    void Writer::Write(char c) {
+        buffer_.push_back(c);
+    }
+
+    void Writer::WriteIndent(int indent) {
+        buffer_.append(static_cast<size_t>(indent), ' ');
+    }
+
+    void Writer::WriteNull() {
+        buffer_.append("null"sv);
+    }
+
+    void Writer::WriteBool(bool value) {
+        buffer_.append(value ? "true"sv : "false"sv);
+    }
+
+    void Writer::WriteInt(int value) {
+        char chars[16];
+        const auto result = std::to_chars(chars, chars + sizeof(chars), value);
+        buffer_.append(chars, result.ptr);
+        FlushIfFull();
+    }
+
+    void Writer::WriteDouble(double value) {
+        // общий формат с 6 значащими цифрами совпадает с выводом потока по умолчанию
+        char chars[32];
+        const auto result = std::to_chars(chars, chars + sizeof(chars), value, std::chars_format::general, 6);
+        buffer_.append(chars, result.ptr);
+        FlushIfFull();
+    }
+
+    void Writer::WriteString(std::string_view value) {
+        AppendEscaped(buffer_, value);
+        FlushIfFull();
+    }
+
+    void Writer::WriteEscapedChars(std::string_view value) {
+        AppendEscapedChars(buffer_, value);
+        FlushIfFull();
+    }
+
+    void Writer::Flush() {
+        if (!buffer_.empty()) {
+            out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+    }
+
+    void Writer::FlushIfFull() {
+        if (buffer_.size() >= FLUSH_THRESHOLD) {
+            Flush();
+        }
+    }
+
+    ArrayWriter::ArrayWriter(std::ostream& out)
+        : out_(out)
+        , writer_(out) {
+        writer_.Write("[\n"sv);
+    }
+
+    ArrayWriter::~ArrayWriter() {
+        Close();
+    }
+
+    void ArrayWriter::Add(const Node& node) {
+        PrintNode(node, PrintContext{ NextItem(), 4, ITEM_INDENT });
+    }
+
+    Writer& ArrayWriter::NextItem() {
+        if (count_ != 0) {
+            if (count_ % FLUSH_PERIOD == 0) {
+                writer_.Flush();
+                out_.flush();
+            }
+            writer_.Write(",\n"sv);
+        }
+        ++count_;
+        writer_.WriteIndent(ITEM_INDENT);
+        return writer_;
+    }
+
+    void ArrayWriter::Close() {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        writer_.Write("\n]\n"sv);
+        writer_.Flush();
+    }
+
     void PrintValue(std::nullptr_t, const PrintContext& ctx) {
-        ctx.out << "null"sv;
+        ctx.out.WriteNull();
     }
 
-    void PrintValue(Array array, const PrintContext& ctx) {
-        ctx.out << "[\n"sv;
+    void PrintValue(const Array& array, const PrintContext& ctx) {
+        ctx.out.Write("[\n"sv);
         bool is_first = true;
         auto inner_ctx = ctx.Indented();
         for (const auto& elem : array) {
             if (is_first) {
                 is_first = false;
             } else {
-                ctx.out << ",\n"sv;
+                ctx.out.Write(",\n"sv);
             }
             inner_ctx.PrintIndent();
             PrintNode(elem, inner_ctx);
         }
-        ctx.out << "\n"sv;
+        ctx.out.Write('\n');
         ctx.PrintIndent();
-        ctx.out << "]"sv;
+        ctx.out.Write(']');
     }
 
-    void PrintValue(Dict map, const PrintContext& ctx) {
-        ctx.out << "{\n"sv;
+    void PrintValue(const Dict& map, const PrintContext& ctx) {
+        ctx.out.Write("{\n"sv);
         bool is_first = true;
         auto inner_ctx = ctx.Indented();
         for (const auto& [key, value] : map) {
             if (is_first) {
                 is_first = false;
             } else {
-                ctx.out << ",\n"sv;
+                ctx.out.Write(",\n"sv);
             }
             inner_ctx.PrintIndent();
-            PrintValue(key, ctx);
-            ctx.out << ": "sv;
+            ctx.out.WriteString(key);
+            ctx.out.Write(": "sv);
             PrintNode(value, inner_ctx);
         }
-        ctx.out << "\n"sv;
+        ctx.out.Write('\n');
         ctx.PrintIndent();
-        ctx.out << "}"sv;
+        ctx.out.Write('}');
     }
 
     void PrintValue(bool value, const PrintContext& ctx) {
-        ctx.out << std::boolalpha << value;
+        ctx.out.WriteBool(value);
     }
 
-    void PrintValue(std::string value, const PrintContext& ctx) {
-        ctx.out << "\""sv;
-        for (const char& c : value) {
-            if (c == '\n') {
-                ctx.out << "\\n"sv;
-                continue;
-            }
-            if (c == '\r') {
-                ctx.out << "\\r"sv;
-                continue;
-            }
-            if (c == '\"') {
-                ctx.out << "\\"sv;
-            }
-            if (c == '\t') {
-                ctx.out << "\t"sv;
-                continue;
-            }
-            if (c == '\\') {
-                ctx.out << "\\"sv;
-            }
-            ctx.out << c;
-        }
-        ctx.out << "\""sv;
+    void PrintValue(int value, const PrintContext& ctx) {
+        ctx.out.WriteInt(value);
+    }
+
+    void PrintValue(double value, const PrintContext& ctx) {
+        ctx.out.WriteDouble(value);
+    }
+
+    void PrintValue(const std::string& value, const PrintContext& ctx) {
+        ctx.out.WriteString(value);
+    }
+
+    void PrintValue(std::string_view value, const PrintContext& ctx) {
+        ctx.out.WriteString(value);
     }
 
     void PrintNode(const Node& node, const PrintContext& ctx) {
@@ -450,9 +1458,10 @@ namespace json {
     }
 
     void Print(const Document& doc, std::ostream& output) {
-        PrintContext ctx{ output };
+        Writer writer(output);
+        PrintContext ctx{ writer };
         PrintNode(doc.GetRoot(), ctx);
-        ctx.out << "\n"sv;
+        writer.Write('\n');
     }
 
 }  // namespace json
\ No newline at end of file
@@ -1,17 +1,136 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
 #include <map>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace json {
 
     class Node;
-    // Сохраните объявления Dict и Array без изменения
-    using Dict = std::map<std::string, Node>;
-    using Array = std::vector<Node>;
+    // Массивы и словари разобранного документа размещаются в его арене (см. Load),
+    // созданные в программе - в обычной куче
+    using Array = std::pmr::vector<Node>;
+
+    // Словарь JSON: упорядоченный по ключу массив пар.
+    // Повторяет нужную часть интерфейса std::map<std::string, Node> (поиск, вставка,
+    // обход в порядке возрастания ключей), но хранит элементы подряд, без узла дерева
+    // и отдельной строки на каждый ключ. Поиск в словарях до 8 элементов линейный, в больших -
+    // двоичный; вставка в середину - линейная, поэтому большие словари лучше собирать через FromUnsorted.
+    // Символы ключей размещаются тем же распределителем памяти, что и элементы (у разобранного
+    // документа - в его арене), и освобождаются вместе со словарем. Исключение - короткие ключи
+    // схемы вроде "type" и "name": они хранятся один раз в общем для процесса хранилище
+    // ограниченного размера и разделяются всеми словарями (см. StoreKey).
+    class Dict {
+    public:
+        using key_type = std::string_view;
+        using mapped_type = Node;
+        using value_type = std::pair<std::string_view, Node>;
+        using Items = std::pmr::vector<value_type>;
+        using const_iterator = Items::const_iterator;
+
+        // Итератор, через который можно менять значения, но не ключи, как у std::map:
+        // измененный ключ нарушил бы упорядоченность. Разыменование дает пару ссылок
+        class iterator {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = Dict::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::pair<const std::string_view&, Node&>;
+            // пара ссылок для it->second, живет до конца выражения
+            struct pointer {
+                reference item;
+                const reference* operator->() const {
+                    return &item;
+                }
+            };
+
+            iterator() = default;
+
+            reference operator*() const;
+            pointer operator->() const;
+            iterator& operator++();
+            iterator operator++(int);
+            iterator& operator--();
+            iterator operator--(int);
+            bool operator==(const iterator& other) const;
+            bool operator!=(const iterator& other) const;
+            operator const_iterator() const;
+
+        private:
+            friend class Dict;
+
+            explicit iterator(Items::iterator it);
+
+            Items::iterator it_;
+        };
+
+        Dict() = default;
+        Dict(std::initializer_list<std::pair<std::string_view, Node>> items);
+        // копия размещается в обычной куче вместе с ключами
+        Dict(const Dict& other);
+        Dict(Dict&& other) noexcept;
+        Dict& operator=(const Dict& other);
+        Dict& operator=(Dict&& other);
+        ~Dict();
+
+        // строит словарь из пар в произвольном порядке; из повторяющихся ключей остается первый
+        // (словарь использует распределитель памяти items)
+        static Dict FromUnsorted(Items items);
+        // то же, но ключи уже размещены через StoreKey с распределителем памяти items
+        static Dict FromUnsortedStored(Items items);
+
+        // Возвращает ключ, который может хранить словарь с распределителем памяти resource:
+        // ключ схемы из общего хранилища или копию, размещенную в resource.
+        // Копию освобождает словарь, в который ключ передан
+        static std::string_view StoreKey(std::string_view key, std::pmr::memory_resource* resource);
+
+        size_t size() const;
+        bool empty() const;
+        void reserve(size_t size);
+
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        iterator find(std::string_view key);
+        const_iterator find(std::string_view key) const;
+        size_t count(std::string_view key) const;
+        // бросает std::out_of_range, если ключа нет
+        Node& at(std::string_view key);
+        const Node& at(std::string_view key) const;
+        Node& operator[](std::string_view key);
+
+        // как у std::map: если ключ уже есть, значение не меняется
+        std::pair<iterator, bool> emplace(std::string_view key, Node value);
+        std::pair<iterator, bool> insert(value_type item);
+
+        bool operator==(const Dict& other) const;
+        bool operator!=(const Dict& other) const;
+
+    private:
+        Items items_;
+
+        explicit Dict(Items items);
+
+        std::pmr::memory_resource* GetResource() const;
+        // заменяет ключи элементов копиями из распределителя памяти словаря
+        void StoreKeys();
+        // освобождает ключ, полученный из StoreKey с тем же распределителем памяти
+        static void ReleaseKey(std::string_view key, std::pmr::memory_resource* resource);
+        // освобождает ключи элементов, размещенные в распределителе памяти словаря
+        void ReleaseKeys();
+
+        const_iterator LowerBound(std::string_view key) const;
+    };
 
     // Эта ошибка должна выбрасываться при ошибках парсинга JSON
     class ParsingError : public std::runtime_error {
@@ -59,30 +178,165 @@ namespace json {
         Value value_;
     };
 
+    // Документ неизменяем, поэтому копии разделяют одно дерево
     class Document {
     public:
         explicit Document(Node root);
+        // дерево, размещенное в арене, живет, пока жива хотя бы одна копия документа
+        Document(std::shared_ptr<const Node> root);
 
         const Node& GetRoot() const;
 
         bool operator==(const Document& other) const;
         bool operator!=(const Document& other) const;
     private:
-        Node root_;
+        std::shared_ptr<const Node> root_;
     };
 
+    // Обработчик потокового (SAX) разбора: получает события по мере чтения документа,
+    // не дожидаясь построения дерева Node. Ключи и строки передаются ссылками на буфер
+    // документа (или на временную строку, если в них были escape-последовательности),
+    // поэтому они действительны только до возврата из обработчика
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void StartDict() = 0;
+        virtual void Key(std::string_view key) = 0;
+        virtual void EndDict() = 0;
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+
+        virtual void Null() = 0;
+        virtual void Bool(bool value) = 0;
+        virtual void Int(int value) = 0;
+        virtual void Double(double value) = 0;
+        virtual void String(std::string_view value) = 0;
+    };
+
+    // Индекс кавычек, по которому разбор находит концы строк. По умолчанию (AUTO) он строится,
+    // если процессор поддерживает векторные инструкции, и выключается на документах с короткими
+    // строками. ALWAYS и NEVER нужны для замеров; менять режим во время разбора нельзя
+    enum class QuoteIndexMode {
+        AUTO,
+        ALWAYS,
+        NEVER,
+    };
+
+    void SetQuoteIndexMode(QuoteIndexMode mode);
+
+    // разбирает документ из буфера, передавая события обработчику
+    void Parse(std::string_view input, Handler& handler);
+    void Parse(std::istream& input, Handler& handler);
+
+    // Разбирает документ, записанный в непрерывном буфере. Массивы и словари дерева
+    // размещаются в монотонной арене документа и освобождаются вместе с ней, а не поузлово.
+    // Если ни одна строка документа не вышла за пределы встроенного буфера std::string,
+    // дерево не владеет памятью вне арены и при уничтожении документа не обходится вовсе.
+    // Копии узлов, сделанные из дерева, размещаются в обычной куче.
+    Document Load(std::string_view input);
+    // читает поток до конца и разбирает его как буфер
     Document Load(std::istream& input);
+    // читает файл целиком и разбирает его
+    Document LoadFile(const std::string& path);
+
+    // Готовый фрагмент JSON (например, заранее экранированная строка), выводится как есть
+    struct RawJson {
+        std::string_view text;
+    };
+
+    // возвращает строку в кавычках с экранированными служебными символами - в том виде,
+    // в каком ее выводит Print
+    std::string EscapeString(std::string_view value);
+    // дописывает к out символы value, экранированные так же, но без кавычек:
+    // длинную строку можно экранировать по частям
+    void AppendEscapedChars(std::string& out, std::string_view value);
+
+    class Writer;
+
+    // Строковое значение, содержимое которого выводится по частям прямо в буфер вывода:
+    // write передает части через Writer::WriteEscapedChars, кавычки выводит StreamBuilder.
+    // Строка целиком в памяти не собирается
+    struct StringProducer {
+        std::function<void(Writer&)> write;
+    };
+
+    // Буферизованный вывод JSON: текст накапливается в растущем буфере и сбрасывается
+    // в поток крупными блоками. Числа форматируются через std::to_chars в том же виде,
+    // что и оператор << потока с настройками по умолчанию
+    class Writer {
+    public:
+        explicit Writer(std::ostream& out);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        // сбрасывает в поток остаток буфера
+        ~Writer();
+
+        // большие фрагменты передаются в поток напрямую, минуя буфер
+        void Write(std::string_view text);
+        void Write(char c);
+        void WriteIndent(int indent);
+        void WriteNull();
+        void WriteBool(bool value);
+        void WriteInt(int value);
+        void WriteDouble(double value);
+        // выводит строку в кавычках, экранируя служебные символы
+        void WriteString(std::string_view value);
+        // выводит часть содержимого строки, экранируя служебные символы, без кавычек
+        void WriteEscapedChars(std::string_view value);
+
+        // передает накопленный текст в поток
+        void Flush();
+
+    private:
+        // порог, после которого буфер сбрасывается в поток
+        static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+        void FlushIfFull();
+
+        std::ostream& out_;
+        std::string buffer_;
+    };
+
+    // Потоковый вывод массива верхнего уровня: элементы выводятся по мере поступления,
+    // не накапливаясь в памяти. Результат совпадает с выводом Print для документа
+    // с тем же массивом
+    class ArrayWriter {
+    public:
+        explicit ArrayWriter(std::ostream& out);
+        ArrayWriter(const ArrayWriter&) = delete;
+        ArrayWriter& operator=(const ArrayWriter&) = delete;
+        // закрывает массив, если Close не был вызван
+        ~ArrayWriter();
+
+        // отступ, с которым выводятся элементы массива
+        static constexpr int ITEM_INDENT = 4;
+
+        void Add(const Node& node);
+        // начинает следующий элемент и возвращает буфер, в который его нужно вывести
+        // с отступом ITEM_INDENT (например, через StreamBuilder)
+        Writer& NextItem();
+        // закрывает массив и передает остаток вывода в поток
+        void Close();
+
+    private:
+        // через сколько элементов вывод принудительно сбрасывается в поток
+        static constexpr size_t FLUSH_PERIOD = 64;
+
+        std::ostream& out_;
+        Writer writer_;
+        size_t count_ = 0;
+        bool closed_ = false;
+    };
 
-    // Контекст вывода, хранит ссылку на поток вывода и текущий отсуп
+    // Контекст вывода, хранит ссылку на буфер вывода и текущий отсуп
     struct PrintContext {
-        std::ostream& out;
+        Writer& out;
         int indent_step = 4;
         int indent = 0;
 
         void PrintIndent() const {
-            for (int i = 0; i < indent; ++i) {
-                out.put(' ');
-            }
+            out.WriteIndent(indent);
         }
 
         // Возвращает новый контекст вывода с увеличенным смещением
@@ -92,18 +346,97 @@ namespace json {
     };
 
     void PrintValue(std::nullptr_t, const PrintContext& ctx);
-    void PrintValue(Array array, const PrintContext& ctx);
-    void PrintValue(Dict map, const PrintContext& ctx);
+    void PrintValue(const Array& array, const PrintContext& ctx);
+    void PrintValue(const Dict& map, const PrintContext& ctx);
     void PrintValue(bool value, const PrintContext& ctx);
-    void PrintValue(std::string value, const PrintContext& ctx);
+    void PrintValue(int value, const PrintContext& ctx);
+    void PrintValue(double value, const PrintContext& ctx);
+    void PrintValue(const std::string& value, const PrintContext& ctx);
+    void PrintValue(std::string_view value, const PrintContext& ctx);
+
+    void PrintNode(const Node& node, const PrintContext& ctx);
 
-    // Шаблон, подходящий для вывода double и int
-    template <typename Value>
-    void PrintValue(const Value value, const PrintContext& ctx) {
-        ctx.out << value;
+    // ----- Dict -----
+
+    inline size_t Dict::size() const {
+        return items_.size();
+    }
+
+    inline bool Dict::empty() const {
+        return items_.empty();
+    }
+
+    inline Dict::iterator::iterator(Items::iterator it)
+        : it_(it) {
+    }
+
+    inline Dict::iterator::reference Dict::iterator::operator*() const {
+        return { it_->first, it_->second };
+    }
+
+    inline Dict::iterator::pointer Dict::iterator::operator->() const {
+        return { **this };
+    }
+
+    inline Dict::iterator& Dict::iterator::operator++() {
+        ++it_;
+        return *this;
+    }
+
+    inline Dict::iterator Dict::iterator::operator++(int) {
+        return iterator(it_++);
+    }
+
+    inline Dict::iterator& Dict::iterator::operator--() {
+        --it_;
+        return *this;
+    }
+
+    inline Dict::iterator Dict::iterator::operator--(int) {
+        return iterator(it_--);
+    }
+
+    inline bool Dict::iterator::operator==(const iterator& other) const {
+        return it_ == other.it_;
+    }
+
+    inline bool Dict::iterator::operator!=(const iterator& other) const {
+        return it_ != other.it_;
+    }
+
+    inline Dict::iterator::operator const_iterator() const {
+        return it_;
+    }
+
+    inline Dict::iterator Dict::begin() {
+        return iterator(items_.begin());
+    }
+
+    inline Dict::iterator Dict::end() {
+        return iterator(items_.end());
+    }
+
+    inline Dict::const_iterator Dict::begin() const {
+        return items_.begin();
+    }
+
+    inline Dict::const_iterator Dict::end() const {
+        return items_.end();
+    }
+
+    inline Dict::const_iterator Dict::find(std::string_view key) const {
+        const auto it = LowerBound(key);
+        return it != items_.end() && it->first == key ? it : items_.end();
+    }
+
+    inline Dict::iterator Dict::find(std::string_view key) {
+        return iterator(items_.begin() + (static_cast<const Dict&>(*this).find(key) - items_.cbegin()));
+    }
+
+    inline size_t Dict::count(std::string_view key) const {
+        return find(key) == end() ? 0 : 1;
     }
 
-    void PrintNode(const Node& node, const PrintContext& ctx);
     void Print(const Document& doc, std::ostream& out);
 
 }  // namespace json
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "json_builder.h"
 
+#include <stdexcept>
+
+using namespace std::literals;
+
 namespace json {
 
     Builder::Builder() {
@@ -7,11 +11,11 @@ namespace json {
         nodes_stack_.emplace_back(root_ptr);
     }
 
-    DictKeyContext Builder::Key(std::string key) {
+    DictKeyContext Builder::Key(std::string_view key) {
         auto* top_node = nodes_stack_.back();
 
-        if (top_node->IsMap() && !key_) key_ = std::move(key);
-        else throw std::logic_error("Wrong map key: " + key);
+        if (top_node->IsMap() && !key_) key_ = std::string(key);
+        else throw std::logic_error("Wrong map key: " + std::string(key));
 
         return *this;
     }
@@ -111,52 +115,201 @@ namespace json {
         return {};
     }
 
-    DictItemContext::DictItemContext(Builder& builder)
-        : builder_(builder)
-    {}
+    StreamBuilder::StreamBuilder(Writer& out, int indent)
+        : out_(out)
+        , indent_(indent) {
+    }
+
+    StreamDictKeyContext StreamBuilder::Key(std::string_view key) {
+        if (depth_ == 0) {
+            throw std::logic_error("Wrong map key: "s + std::string(key));
+        }
+        auto& frame = frames_[depth_ - 1];
+        Check(frame.is_dict && !frame.has_key, "Wrong map key");
+#ifndef NDEBUG
+        Check(frame.is_first || frame.last_key < key, "Map keys must go in ascending order");
+        frame.last_key = std::string(key);
+#endif
+        if (!frame.is_first) {
+            out_.Write(",\n"sv);
+        }
+        frame.is_first = false;
+        frame.has_key = true;
+        out_.WriteIndent(Indent());
+        out_.WriteString(key);
+        out_.Write(": "sv);
+
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(std::nullptr_t) {
+        BeginValue();
+        out_.WriteNull();
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(bool value) {
+        BeginValue();
+        out_.WriteBool(value);
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(int value) {
+        BeginValue();
+        out_.WriteInt(value);
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(double value) {
+        BeginValue();
+        out_.WriteDouble(value);
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(std::string_view value) {
+        BeginValue();
+        out_.WriteString(value);
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(const std::string& value) {
+        return Value(std::string_view(value));
+    }
+
+    StreamBuilder& StreamBuilder::Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    StreamBuilder& StreamBuilder::Value(RawJson value) {
+        BeginValue();
+        out_.Write(value.text);
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(const StringProducer& value) {
+        BeginValue();
+        out_.Write('"');
+        value.write(out_);
+        out_.Write('"');
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(const Node& value) {
+        BeginValue();
+        PrintNode(value, PrintContext{ out_, 4, Indent() });
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(const Array& value) {
+        BeginValue();
+        PrintValue(value, PrintContext{ out_, 4, Indent() });
+        EndValue();
+        return *this;
+    }
+
+    StreamBuilder& StreamBuilder::Value(const Dict& value) {
+        BeginValue();
+        PrintValue(value, PrintContext{ out_, 4, Indent() });
+        EndValue();
+        return *this;
+    }
 
-    DictKeyContext DictItemContext::Key(std::string key) {
-        return builder_.Key(key);
+    StreamDictItemContext StreamBuilder::StartDict() {
+        StartContainer(true);
+        return *this;
     }
 
-    Builder& DictItemContext::EndDict() {
-        return builder_.EndDict();
+    StreamBuilder& StreamBuilder::EndDict() {
+        EndContainer(true);
+        return *this;
     }
 
-    ArrayItemContext::ArrayItemContext(Builder& builder)
-        : builder_(builder)
-    {}
+    StreamArrayItemContext StreamBuilder::StartArray() {
+        StartContainer(false);
+        return *this;
+    }
 
-    ArrayItemContext ArrayItemContext::Value(Node::Value value) {
-        return ArrayItemContext(builder_.Value(value));
+    StreamBuilder& StreamBuilder::EndArray() {
+        EndContainer(false);
+        return *this;
     }
 
-    DictItemContext ArrayItemContext::StartDict() {
-        return builder_.StartDict();
+    void StreamBuilder::Build() {
+        Check(is_complete_ && depth_ == 0, "Wrong Build()");
     }
 
-    ArrayItemContext ArrayItemContext::StartArray() {
-        return builder_.StartArray();
+    int StreamBuilder::Indent() const {
+        return indent_ + 4 * static_cast<int>(depth_);
     }
 
-    Builder& ArrayItemContext::EndArray() {
-        return builder_.EndArray();
+    void StreamBuilder::BeginValue() {
+        if (depth_ == 0) {
+            Check(!is_complete_, "Value() called in unknow container");
+            return;
+        }
+        auto& frame = frames_[depth_ - 1];
+        if (frame.is_dict) {
+            Check(frame.has_key, "Could not Value() for dict without key");
+            frame.has_key = false;
+            return;
+        }
+        if (!frame.is_first) {
+            out_.Write(",\n"sv);
+        }
+        frame.is_first = false;
+        out_.WriteIndent(Indent());
     }
 
-    DictKeyContext::DictKeyContext(Builder& builder)
-        : builder_(builder)
-    {}
+    void StreamBuilder::EndValue() {
+        if (depth_ == 0) {
+            is_complete_ = true;
+        }
+    }
 
-    DictItemContext DictKeyContext::Value(Node::Value value) {
-        return DictItemContext(builder_.Value(value));
+    void StreamBuilder::StartContainer(bool is_dict) {
+        // выход за пределы стека проверяется и в итоговой сборке
+        if (depth_ == MAX_DEPTH) {
+            throw std::logic_error("Too deep nesting");
+        }
+        BeginValue();
+        out_.Write(is_dict ? "{\n"sv : "[\n"sv);
+        auto& frame = frames_[depth_++];
+        frame.is_dict = is_dict;
+        frame.is_first = true;
+        frame.has_key = false;
     }
 
-    ArrayItemContext DictKeyContext::StartArray() {
-        return builder_.StartArray();
+    void StreamBuilder::EndContainer(bool is_dict) {
+        // выход за пределы стека проверяется и в итоговой сборке
+        if (depth_ == 0) {
+            throw std::logic_error(is_dict ? "Prev node is not a Dict" : "Prev node is not an Array");
+        }
+        Check(frames_[depth_ - 1].is_dict == is_dict && !frames_[depth_ - 1].has_key,
+            is_dict ? "Prev node is not a Dict" : "Prev node is not an Array");
+        --depth_;
+        out_.Write('\n');
+        out_.WriteIndent(Indent());
+        out_.Write(is_dict ? '}' : ']');
+        EndValue();
     }
 
-    DictItemContext DictKeyContext::StartDict() {
-        return builder_.StartDict();
+#ifdef NDEBUG
+    void StreamBuilder::Check(bool, const char*) const {
+    }
+#else
+    void StreamBuilder::Check(bool condition, const char* message) const {
+        if (!condition) {
+            throw std::logic_error(message);
+        }
     }
+#endif
 
 } // namespace json
\ No newline at end of file
@@ -2,18 +2,28 @@
 
 #include "json.h"
 
+#include <array>
 #include <optional>
+#include <utility>
 
 namespace json {
 
-    class DictItemContext;
-    class DictKeyContext;
-    class ArrayItemContext;
+    template <typename BuilderType>
+    class BasicDictItemContext;
+    template <typename BuilderType>
+    class BasicDictKeyContext;
+    template <typename BuilderType>
+    class BasicArrayItemContext;
+
+    class Builder;
+    using DictItemContext = BasicDictItemContext<Builder>;
+    using DictKeyContext = BasicDictKeyContext<Builder>;
+    using ArrayItemContext = BasicArrayItemContext<Builder>;
 
     class Builder {
     public:
         Builder();
-        DictKeyContext Key(std::string key);
+        DictKeyContext Key(std::string_view key);
         Builder& Value(Node::Value value);
         DictItemContext StartDict();
         Builder& EndDict();
@@ -28,40 +38,143 @@ namespace json {
         std::optional<std::string> key_{ std::nullopt };
     };
 
-    class DictItemContext {
+    class StreamBuilder;
+    using StreamDictItemContext = BasicDictItemContext<StreamBuilder>;
+    using StreamDictKeyContext = BasicDictKeyContext<StreamBuilder>;
+    using StreamArrayItemContext = BasicArrayItemContext<StreamBuilder>;
+
+    // Построитель с тем же интерфейсом, что и Builder, но без промежуточного дерева Node:
+    // лексемы сразу записываются в буфер вывода в том же виде, в каком их вывел бы Print.
+    // Словарь выводится в порядке вызовов Key, поэтому ключи нужно передавать по возрастанию,
+    // как их упорядочивает Dict. В отладочной сборке порядок ключей и структура документа
+    // проверяются во время выполнения (std::logic_error, как у Builder)
+    class StreamBuilder {
     public:
-        DictItemContext(Builder& builder);
+        // indent - отступ, с которым значение выводится в объемлющем документе
+        explicit StreamBuilder(Writer& out, int indent = 0);
+        StreamBuilder(const StreamBuilder&) = delete;
+        StreamBuilder& operator=(const StreamBuilder&) = delete;
+
+        StreamDictKeyContext Key(std::string_view key);
+        StreamBuilder& Value(std::nullptr_t);
+        StreamBuilder& Value(bool value);
+        StreamBuilder& Value(int value);
+        StreamBuilder& Value(double value);
+        StreamBuilder& Value(std::string_view value);
+        StreamBuilder& Value(const std::string& value);
+        StreamBuilder& Value(const char* value);
+        // фрагмент выводится без изменений
+        StreamBuilder& Value(RawJson value);
+        // строка, содержимое которой выводит сам value
+        StreamBuilder& Value(const StringProducer& value);
+        // готовые узлы выводятся целиком
+        StreamBuilder& Value(const Node& value);
+        StreamBuilder& Value(const Array& value);
+        StreamBuilder& Value(const Dict& value);
+        StreamDictItemContext StartDict();
+        StreamBuilder& EndDict();
+        StreamArrayItemContext StartArray();
+        StreamBuilder& EndArray();
+        // проверяет, что значение записано полностью
+        void Build();
 
-        DictKeyContext Key(std::string key);
-        Builder& EndDict();
+    private:
+        // наибольшая вложенность контейнеров
+        static constexpr size_t MAX_DEPTH = 32;
+
+        struct Frame {
+            bool is_dict = false;
+            bool is_first = true;
+            bool has_key = false;
+#ifndef NDEBUG
+            std::string last_key;
+#endif
+        };
+
+        Writer& out_;
+        int indent_;
+        std::array<Frame, MAX_DEPTH> frames_;
+        size_t depth_ = 0;
+        bool is_complete_ = false;
+
+        // отступ элементов текущего контейнера
+        int Indent() const;
+        void BeginValue();
+        void EndValue();
+        void StartContainer(bool is_dict);
+        void EndContainer(bool is_dict);
+        void Check(bool condition, const char* message) const;
+    };
+
+    template <typename BuilderType>
+    class BasicDictItemContext {
+    public:
+        BasicDictItemContext(BuilderType& builder)
+            : builder_(builder) {
+        }
+
+        BasicDictKeyContext<BuilderType> Key(std::string_view key) {
+            return builder_.Key(key);
+        }
+
+        BuilderType& EndDict() {
+            return builder_.EndDict();
+        }
 
     private:
-        Builder& builder_;
+        BuilderType& builder_;
     };
 
-    class ArrayItemContext {
+    template <typename BuilderType>
+    class BasicArrayItemContext {
     public:
-        ArrayItemContext(Builder& builder);
+        BasicArrayItemContext(BuilderType& builder)
+            : builder_(builder) {
+        }
 
-        ArrayItemContext Value(Node::Value value);
-        DictItemContext StartDict();
-        Builder& EndArray();
-        ArrayItemContext StartArray();
+        template <typename T>
+        BasicArrayItemContext Value(T&& value) {
+            return builder_.Value(std::forward<T>(value));
+        }
+
+        BasicDictItemContext<BuilderType> StartDict() {
+            return builder_.StartDict();
+        }
+
+        BuilderType& EndArray() {
+            return builder_.EndArray();
+        }
+
+        BasicArrayItemContext StartArray() {
+            return builder_.StartArray();
+        }
 
     private:
-        Builder& builder_;
+        BuilderType& builder_;
     };
 
-    class DictKeyContext {
+    template <typename BuilderType>
+    class BasicDictKeyContext {
     public:
-        DictKeyContext(Builder& builder);
+        BasicDictKeyContext(BuilderType& builder)
+            : builder_(builder) {
+        }
 
-        DictItemContext Value(Node::Value value);
-        ArrayItemContext StartArray();
-        DictItemContext StartDict();
+        template <typename T>
+        BasicDictItemContext<BuilderType> Value(T&& value) {
+            return builder_.Value(std::forward<T>(value));
+        }
+
+        BasicArrayItemContext<BuilderType> StartArray() {
+            return builder_.StartArray();
+        }
+
+        BasicDictItemContext<BuilderType> StartDict() {
+            return builder_.StartDict();
+        }
 
     private:
-        Builder& builder_;
+        BuilderType& builder_;
     };
 
 } // namespace json
\ No newline at end of file
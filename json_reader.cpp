@@ -15,11 +15,322 @@ JsonReader::JsonReader(std::istream& input)
 	: queries_(Load(input)) {
 }
 
+namespace {
+
+// раздел, которого нет во входном документе
+const Node EMPTY_NODE = nullptr;
+
+// остановка, на которую ссылается маршрут или таблица расстояний, должна быть в справочнике:
+// иначе в маршрут попал бы нулевой указатель
+template <typename StopFinder>
+const transport_ctg::Stop* FindExistingStop(const StopFinder& catalogue, std::string_view name) {
+	const transport_ctg::Stop* stop = catalogue.FindStop(name);
+	if (!stop) {
+		throw std::invalid_argument("stop "s + std::string(name) + " not found"s);
+	}
+	return stop;
+}
+
+// поле запроса изменения заданного типа; запрос без поля или с полем другого типа
+// отклоняется до того, как справочник начнет меняться
+const Node& GetUpdateField(const Dict& request, std::string_view key, bool (Node::*is_type)() const, std::string_view type_name) {
+	const auto it = request.find(key);
+	if (it == request.end() || !(it->second.*is_type)()) {
+		throw std::invalid_argument("field "s + std::string(key) + " must be "s + std::string(type_name));
+	}
+	return it->second;
+}
+
+// Потоковая загрузка base_requests. Остановка добавляется в справочник, как только
+// прочитан ее запрос; расстояния и маршруты ссылаются на остановки по именам, которые могут
+// встретиться позже, поэтому они накапливаются и разрешаются в Finish().
+// Названия копирует построитель справочника, так как документ не сохраняется.
+class BaseRequestsHandler final : public Handler {
+public:
+	explicit BaseRequestsHandler(transport_ctg::Catalogue& catalogue)
+		: builder_(catalogue, 0, 0) {
+	}
+
+	// разрешает ссылки на остановки и строит индексы справочника
+	void Finish() {
+		for (const auto& [from, to, distance] : distances_) {
+			builder_.AddDistanceBetweenStops({ from, FindExistingStop(builder_, to) }, distance);
+		}
+		for (const auto& request : buses_) {
+			transport_ctg::Bus bus;
+			bus.name = request.name;
+			bus.is_roundtrip = request.is_roundtrip;
+			bus.stops_ptr.reserve(bus.is_roundtrip ? request.stops.size() : request.stops.size() * 2);
+			for (const auto& stop_name : request.stops) {
+				bus.stops_ptr.push_back(FindExistingStop(builder_, stop_name));
+			}
+			// для некольцевого маршрута добавляются остановки в обратном направлении
+			if (!bus.is_roundtrip && !bus.stops_ptr.empty()) {
+				for (size_t i = bus.stops_ptr.size() - 1; i > 0; --i) {
+					bus.stops_ptr.push_back(bus.stops_ptr[i - 1]);
+				}
+			}
+			builder_.AddBus(std::move(bus));
+		}
+		distances_.clear();
+		buses_.clear();
+		builder_.Build();
+	}
+
+	// уровни вложенности: 1 - массив base_requests, 2 - запрос, 3 - road_distances или stops
+	void StartDict() override {
+		++depth_;
+	}
+
+	void EndDict() override {
+		if (depth_ == 2) {
+			FinishRequest();
+		}
+		--depth_;
+	}
+
+	void StartArray() override {
+		++depth_;
+	}
+
+	void EndArray() override {
+		--depth_;
+	}
+
+	void Key(std::string_view key) override {
+		if (depth_ == 2) {
+			key_.assign(key);
+		} else if (depth_ == 3 && key_ == "road_distances"sv) {
+			distance_to_.assign(key);
+		}
+	}
+
+	void Null() override {
+	}
+
+	void Bool(bool value) override {
+		if (depth_ == 2 && key_ == "is_roundtrip"sv) {
+			request_.is_roundtrip = value;
+		}
+	}
+
+	void Int(int value) override {
+		if (depth_ == 3 && key_ == "road_distances"sv) {
+			request_.distances.emplace_back(std::move(distance_to_), static_cast<uint32_t>(value));
+		} else {
+			Double(value);
+		}
+	}
+
+	void Double(double value) override {
+		// дробное расстояние - ошибка загрузки, как у разбора в DOM (Node::AsInt)
+		if (depth_ == 3 && key_ == "road_distances"sv) {
+			throw std::invalid_argument("Type is not int"s);
+		}
+		if (depth_ != 2) {
+			return;
+		}
+		if (key_ == "latitude"sv) {
+			request_.coordinates.lat = value;
+		} else if (key_ == "longitude"sv) {
+			request_.coordinates.lng = value;
+		}
+	}
+
+	void String(std::string_view value) override {
+		if (depth_ == 2) {
+			if (key_ == "type"sv) {
+				request_.type.assign(value);
+			} else if (key_ == "name"sv) {
+				request_.name.assign(value);
+			}
+		} else if (depth_ == 3 && key_ == "stops"sv) {
+			request_.stops.emplace_back(value);
+		}
+	}
+
+private:
+	// поля запроса, прочитанные до закрывающей скобки
+	struct Request {
+		std::string type;
+		std::string name;
+		geo::Coordinates coordinates{ 0., 0. };
+		std::vector<std::pair<std::string, uint32_t>> distances;
+		std::vector<std::string> stops;
+		bool is_roundtrip = false;
+	};
+
+	struct PendingDistance {
+		const transport_ctg::Stop* from = nullptr;
+		std::string to;
+		uint32_t distance = 0;
+	};
+
+	transport_ctg::CatalogueBuilder builder_;
+	int depth_ = 0;
+	std::string key_;
+	std::string distance_to_;
+	Request request_;
+	std::vector<PendingDistance> distances_;
+	// запросы маршрутов, остановки которых разрешаются в Finish()
+	std::vector<Request> buses_;
+
+	void FinishRequest() {
+		if (request_.type == "Stop"sv) {
+			transport_ctg::Stop stop;
+			stop.name = request_.name;
+			stop.coordinates = request_.coordinates;
+			const transport_ctg::Stop* stop_ptr = builder_.AddStop(stop);
+			for (auto& [to, distance] : request_.distances) {
+				distances_.push_back({ stop_ptr, std::move(to), distance });
+			}
+		} else if (request_.type == "Bus"sv) {
+			buses_.push_back(std::move(request_));
+		}
+		request_ = Request{};
+	}
+};
+
+// Строит документ из всех разделов, кроме base_requests, которые передаются в BaseRequestsHandler
+class RootHandler final : public Handler {
+public:
+	explicit RootHandler(BaseRequestsHandler& base_requests)
+		: base_requests_(base_requests) {
+	}
+
+	Node Build() {
+		return builder_.Build();
+	}
+
+	void StartDict() override {
+		if (Forward()) {
+			++base_depth_;
+			base_requests_.StartDict();
+			return;
+		}
+		++depth_;
+		is_base_key_ = false;
+		builder_.StartDict();
+	}
+
+	void EndDict() override {
+		if (Forward()) {
+			--base_depth_;
+			base_requests_.EndDict();
+			return;
+		}
+		--depth_;
+		builder_.EndDict();
+	}
+
+	void StartArray() override {
+		if (is_base_key_ && base_depth_ == 0) {
+			// начало массива base_requests
+			++base_depth_;
+			base_requests_.StartArray();
+			return;
+		}
+		if (Forward()) {
+			++base_depth_;
+			base_requests_.StartArray();
+			return;
+		}
+		++depth_;
+		builder_.StartArray();
+	}
+
+	void EndArray() override {
+		if (Forward()) {
+			base_requests_.EndArray();
+			if (--base_depth_ == 0) {
+				is_base_key_ = false;
+				builder_.Value(Array{});
+			}
+			return;
+		}
+		--depth_;
+		builder_.EndArray();
+	}
+
+	void Key(std::string_view key) override {
+		if (Forward()) {
+			base_requests_.Key(key);
+			return;
+		}
+		if (depth_ == 1 && key == "base_requests"sv) {
+			is_base_key_ = true;
+		}
+		builder_.Key(key);
+	}
+
+	void Null() override {
+		OnValue(nullptr, [this] { base_requests_.Null(); });
+	}
+
+	void Bool(bool value) override {
+		OnValue(value, [this, value] { base_requests_.Bool(value); });
+	}
+
+	void Int(int value) override {
+		OnValue(value, [this, value] { base_requests_.Int(value); });
+	}
+
+	void Double(double value) override {
+		OnValue(value, [this, value] { base_requests_.Double(value); });
+	}
+
+	void String(std::string_view value) override {
+		if (Forward()) {
+			base_requests_.String(value);
+			return;
+		}
+		OnValue(std::string(value), [] {});
+	}
+
+private:
+	BaseRequestsHandler& base_requests_;
+	Builder builder_;
+	// вложенность в строящемся документе
+	int depth_ = 0;
+	// вложенность внутри base_requests (0 - вне массива)
+	int base_depth_ = 0;
+	// последний ключ корневого словаря - base_requests
+	bool is_base_key_ = false;
+
+	bool Forward() const {
+		return base_depth_ > 0;
+	}
+
+	template <typename Forwarder>
+	void OnValue(Node::Value value, Forwarder forward) {
+		if (Forward()) {
+			forward();
+			return;
+		}
+		// base_requests не массив: сохраняется в документе как есть
+		is_base_key_ = false;
+		builder_.Value(std::move(value));
+	}
+};
+
+Document LoadWithCatalogue(std::istream& input, transport_ctg::Catalogue& catalogue) {
+	BaseRequestsHandler base_requests(catalogue);
+	RootHandler root(base_requests);
+	Parse(input, root);
+	base_requests.Finish();
+	return Document(root.Build());
+}
+
+} // namespace
+
+JsonReader::JsonReader(std::istream& input, transport_ctg::Catalogue& catalogue)
+	: queries_(LoadWithCatalogue(input, catalogue)) {
+}
+
 	// Описание базы маршрутов и остановок
 const Node& JsonReader::GetBaseRequest() const {
 	if (!queries_.GetRoot().AsMap().count("base_requests"s)) {
-		static Node empty_node = nullptr;
-		return empty_node;
+		return EMPTY_NODE;
 	}
 	return queries_.GetRoot().AsMap().at("base_requests"s);
 }
@@ -27,52 +338,67 @@ const Node& JsonReader::GetBaseRequest() const {
 // ответы на запросы к транаспортному справочнику
 const Node& JsonReader::GetStatRequest() const {
 	if (!queries_.GetRoot().AsMap().count("stat_requests"s)) {
-		static Node empty_node = nullptr;
-		return empty_node;
+		return EMPTY_NODE;
 	}
 	return queries_.GetRoot().AsMap().at("stat_requests"s);
 }
 
 const Node& JsonReader::GetRenderSettings() const {
 	if (!queries_.GetRoot().AsMap().count("render_settings"s)) {
-		static Node empty_node = nullptr;
-		return empty_node;
+		return EMPTY_NODE;
 	}
 	return queries_.GetRoot().AsMap().at("render_settings"s);
 }
 
 const Node& JsonReader::GetRoutingSettings() const {
 	if (!queries_.GetRoot().AsMap().count("routing_settings"s)) {
-		static Node empty_node = nullptr;
-		return empty_node;
+		return EMPTY_NODE;
 	}
 	return queries_.GetRoot().AsMap().at("routing_settings"s);
 }
 
 void JsonReader::AddToCatalogue(transport_ctg::Catalogue& catalogue) {
 	const Array& queries = GetBaseRequest().AsArray();
+	// подсчитываем объем данных, чтобы зарезервировать таблицы справочника
+	size_t stop_count = 0;
+	size_t bus_count = 0;
+	size_t distance_count = 0;
+	for (const auto& query : queries) {
+		const auto& query_map = query.AsMap();
+		const auto& type = query_map.at("type"s).AsString();
+		if (type == "Stop"s) {
+			++stop_count;
+			distance_count += query_map.at("road_distances"s).AsMap().size();
+		} else if (type == "Bus"s) {
+			++bus_count;
+		}
+	}
+	transport_ctg::CatalogueBuilder builder(catalogue, stop_count, bus_count, distance_count);
+
 	//сначала добавляем все остановки в базу
 	for (const auto& query : queries) {
 		const auto& query_stop = query.AsMap();
 		const auto& type = query_stop.at("type"s).AsString();
 		if (type == "Stop"s) {
-			CreateStopBase(query_stop, catalogue);
+			CreateStopBase(query_stop, builder);
 		}
 	}
 	// формируем таблицу расстояний между остановками
-	AddDistance(catalogue);
+	AddDistance(builder);
 	
 	// добавляем все маршруты в базу
 	for (const auto& query : queries) {
 		const auto& query_bus = query.AsMap();
 		const auto& type = query_bus.at("type"s).AsString();
 		if (type == "Bus"s) {
-			CreateBusBase(query_bus, catalogue);
+			CreateBusBase(query_bus, builder);
 		}
 	}
+	// строим индексы справочника по всем добавленным данным
+	builder.Build();
 }
 
-transport_ctg::Stop JsonReader::CreateStopBase(const Dict& stop_map, transport_ctg::Catalogue& catalogue) const {
+transport_ctg::Stop JsonReader::CreateStopBase(const Dict& stop_map, transport_ctg::CatalogueBuilder& catalogue) const {
 	transport_ctg::Stop stop;
 	stop.name = stop_map.at("name"s).AsString();
 	stop.coordinates.lat = stop_map.at("latitude"s).AsDouble();
@@ -82,19 +408,18 @@ transport_ctg::Stop JsonReader::CreateStopBase(const Dict& stop_map, transport_c
 	return stop;
 }
 
-void JsonReader::AddDistance(transport_ctg::Catalogue& catalogue) const {
-	const Array queries = GetBaseRequest().AsArray();
+void JsonReader::AddDistance(transport_ctg::CatalogueBuilder& catalogue) const {
+	const Array& queries = GetBaseRequest().AsArray();
 	for (const auto& query : queries) {
 		const auto& stop_map = query.AsMap();
 		const auto& type = stop_map.at("type"s).AsString();
 		if (type == "Stop"s) {
 			// основная остановка
-			const auto from = stop_map.at("name"s).AsString();
+			auto stopFromPtr = catalogue.FindStop(stop_map.at("name"s).AsString());
 			// список остановок и расстояний от основной остановки
 			const auto& distance = stop_map.at("road_distances"s).AsMap();
 			for (const auto& [to, dist] : distance) {
-				auto stopFromPtr = catalogue.FindStop(from);
-				auto stopToPtr = catalogue.FindStop(to);
+				auto stopToPtr = FindExistingStop(catalogue, to);
 
 				catalogue.AddDistanceBetweenStops({ stopFromPtr, stopToPtr }, dist.AsInt());
 			}
@@ -102,7 +427,7 @@ void JsonReader::AddDistance(transport_ctg::Catalogue& catalogue) const {
 	}
 }
 
-transport_ctg::Bus JsonReader::CreateBusBase(const Dict& bus_map, transport_ctg::Catalogue& catalogue) const {
+transport_ctg::Bus JsonReader::CreateBusBase(const Dict& bus_map, transport_ctg::CatalogueBuilder& catalogue) const {
 	
 	transport_ctg::Bus bus;
 	const auto& stops_arr = bus_map.at("stops"s).AsArray();
@@ -117,19 +442,16 @@ transport_ctg::Bus JsonReader::CreateBusBase(const Dict& bus_map, transport_ctg:
 	}
 	// добавляем указатели на остановки из базы остановок
 	for (const auto& stopname : stops_arr) {
-		transport_ctg::Stop* stop_ptr = catalogue.FindStop(stopname.AsString());
-		bus.stops_ptr.push_back(std::move(stop_ptr));
+		bus.stops_ptr.push_back(FindExistingStop(catalogue, stopname.AsString()));
 	}
 
 	// добавляем остановки к маршруту, если он некольцевой
-	if (!bus_map.at("is_roundtrip"s).AsBool()) {
-		std::vector<transport_ctg::Stop*> temp = bus.stops_ptr;
-		for (auto it = std::rbegin(temp) + 1; it != std::rend(temp); ++it) {
-			bus.stops_ptr.push_back(*it);
+	if (!bus.is_roundtrip && !bus.stops_ptr.empty()) {
+		for (size_t i = bus.stops_ptr.size() - 1; i > 0; --i) {
+			bus.stops_ptr.push_back(bus.stops_ptr[i - 1]);
 		}
 	}
-	catalogue.AddBus(bus);
-	return bus;
+	return *catalogue.AddBus(bus);
 }
 
 renderer::RenderSettings JsonReader::SetRenderSettings(const Dict& request_settings) const {
@@ -175,6 +497,12 @@ renderer::RenderSettings JsonReader::SetRenderSettings(const Dict& request_setti
 		throw std::logic_error("wrong type of underlayer color"s);
 	}
 	settings.underlayer_width = request_settings.at("underlayer_width"s).AsDouble();
+	if (const auto it = request_settings.find("simplify_tolerance"s); it != request_settings.end()) {
+		settings.simplify_tolerance = it->second.AsDouble();
+	}
+	if (const auto it = request_settings.find("stop_details_min_zoom"s); it != request_settings.end()) {
+		settings.stop_details_min_zoom = it->second.AsInt();
+	}
 
 	const auto& color_palette = request_settings.at("color_palette"s).AsArray();
 	for (const auto& clr : color_palette) {
@@ -207,13 +535,75 @@ renderer::MapRenderer JsonReader::SetMapRenderer(const Dict& settings) const {
 	return { render_settings };
 }
 
-transport_ctg::BusRouter JsonReader::SetRouter(const Dict& settings, const transport_ctg::Catalogue& catalogue) const {
+transport_ctg::BusRouter JsonReader::SetRouter(const Dict& settings, transport_ctg::CatalogueHandle::Version catalogue) const {
 	if (&GetRoutingSettings() == nullptr) {
 		throw std::invalid_argument("Routing_settings is doesn't exist"s);
 	}
 	return transport_ctg::BusRouter({
 	settings.at("bus_wait_time"s).AsInt(),
-	settings.at("bus_velocity"s).AsDouble()}, catalogue);
+	settings.at("bus_velocity"s).AsDouble()}, std::move(catalogue));
+}
+
+// Поля запроса проверяются до изменения справочника. Названия новых и замененных остановок
+// и маршрутов справочник копирует сам: версия может пережить документ
+void JsonReader::ApplyUpdateRequest(const Dict& request, transport_ctg::Catalogue& catalogue) const {
+	const auto& type = GetUpdateField(request, "type"sv, &Node::IsString, "string"sv).AsString();
+	const auto& name = GetUpdateField(request, "name"sv, &Node::IsString, "string"sv).AsString();
+	if (type == "UpdateStop"s) {
+		transport_ctg::Stop stop;
+		stop.coordinates.lat = GetUpdateField(request, "latitude"sv, &Node::IsDouble, "number"sv).AsDouble();
+		stop.coordinates.lng = GetUpdateField(request, "longitude"sv, &Node::IsDouble, "number"sv).AsDouble();
+		const Dict* distances = nullptr;
+		if (request.count("road_distances"sv)) {
+			distances = &GetUpdateField(request, "road_distances"sv, &Node::IsMap, "map"sv).AsMap();
+			for (const auto& [to, distance] : *distances) {
+				if (!distance.IsInt()) {
+					throw std::invalid_argument("road distance to "s + std::string(to) + " must be int"s);
+				}
+			}
+		}
+		stop.name = name;
+		if (catalogue.FindStop(name)) {
+			catalogue.ReplaceStop(stop);
+		} else {
+			catalogue.AddStop(stop);
+		}
+		if (distances) {
+			const transport_ctg::Stop* from = catalogue.FindStop(name);
+			for (const auto& [to, distance] : *distances) {
+				catalogue.AddDistanceBetweenStops({ from, FindExistingStop(catalogue, to) }, distance.AsInt());
+			}
+		}
+	} else if (type == "UpdateBus"s) {
+		transport_ctg::Bus bus;
+		bus.is_roundtrip = GetUpdateField(request, "is_roundtrip"sv, &Node::IsBool, "bool"sv).AsBool();
+		const auto& stops = GetUpdateField(request, "stops"sv, &Node::IsArray, "array"sv).AsArray();
+		bus.stops_ptr.reserve(bus.is_roundtrip ? stops.size() : stops.size() * 2);
+		for (const auto& stopname : stops) {
+			if (!stopname.IsString()) {
+				throw std::invalid_argument("bus stops must be strings"s);
+			}
+			bus.stops_ptr.push_back(FindExistingStop(catalogue, stopname.AsString()));
+		}
+		// для некольцевого маршрута добавляются остановки в обратном направлении
+		if (!bus.is_roundtrip && !bus.stops_ptr.empty()) {
+			for (size_t i = bus.stops_ptr.size() - 1; i > 0; --i) {
+				bus.stops_ptr.push_back(bus.stops_ptr[i - 1]);
+			}
+		}
+		bus.name = name;
+		if (catalogue.FindBus(name)) {
+			catalogue.ReplaceBus(std::move(bus));
+		} else {
+			catalogue.AddBus(std::move(bus));
+		}
+	} else if (type == "RemoveStop"s) {
+		catalogue.RemoveStop(name);
+	} else if (type == "RemoveBus"s) {
+		catalogue.RemoveBus(name);
+	} else {
+		throw std::invalid_argument("unknown update request "s + type);
+	}
 }
 
 } // namespace json
\ No newline at end of file
@@ -16,6 +16,9 @@ namespace json {
 	class JsonReader {
 	public:
 		JsonReader(std::istream& input);
+		// потоковый разбор: base_requests добавляются в справочник по мере чтения,
+		// не попадая в документ (в нем остается пустой массив base_requests)
+		JsonReader(std::istream& input, transport_ctg::Catalogue& catalogue);
 
 		const Node& GetBaseRequest() const;
 		const Node& GetStatRequest() const;
@@ -24,20 +27,26 @@ namespace json {
 
 		void AddToCatalogue(transport_ctg::Catalogue& catalogue);
 		renderer::MapRenderer SetMapRenderer(const Dict& settings) const;
-		// задает маршрутизатор
-		transport_ctg::BusRouter SetRouter(const Dict& settings, const transport_ctg::Catalogue& catalogue) const;
+		// задает маршрутизатор, построенный по версии справочника (маршрутизатор удерживает ее)
+		transport_ctg::BusRouter SetRouter(const Dict& settings, transport_ctg::CatalogueHandle::Version catalogue) const;
+		// применяет к справочнику запрос изменения из stat_requests:
+		// UpdateStop (добавляет или заменяет остановку и задает расстояния road_distances, если они есть),
+		// UpdateBus (добавляет или заменяет маршрут), RemoveStop, RemoveBus.
+		// Выбрасывает std::invalid_argument, если в запросе нет нужного поля или у поля другой тип,
+		// или запрос ссылается на отсутствующие остановки или маршрут
+		void ApplyUpdateRequest(const Dict& request, transport_ctg::Catalogue& catalogue) const;
 
 	private:
 		json::Document queries_;
 
 		// добавляет остановки в базу
-		transport_ctg::Stop CreateStopBase(const Dict& map, transport_ctg::Catalogue& catalogue) const;
+		transport_ctg::Stop CreateStopBase(const Dict& map, transport_ctg::CatalogueBuilder& catalogue) const;
 
 		// добавляет маршруты в базу
-		transport_ctg::Bus CreateBusBase(const Dict& map, transport_ctg::Catalogue& catalogue) const;
+		transport_ctg::Bus CreateBusBase(const Dict& map, transport_ctg::CatalogueBuilder& catalogue) const;
 
 		// таблица расстояний между остановками
-		void AddDistance(transport_ctg::Catalogue& catalogue) const;
+		void AddDistance(transport_ctg::CatalogueBuilder& catalogue) const;
 
 		// задает настройки для визуализации карты
 		renderer::RenderSettings SetRenderSettings(const Dict& settings) const;
@@ -1,28 +1,102 @@
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <vector>
 
+#include "catalogue_snapshot.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "json_reader.h"
 #include "json_builder.h"
 #include "request_handler.h"
 #include "map_renderer.h"
+#include "memory_report.h"
+#include "vector_tile.h"
 
 using namespace transport_ctg;
 
-int main() {
+void PrintUsage(std::ostream& stream = std::cerr) {
 	using namespace std::literals;
-	
-	Catalogue catalogue;
-	json::JsonReader requests(std::cin);
+	stream << "Usage: transport_catalogue [make_snapshot <file> | process_requests <file> | decode_tile] [--mem-report]\n"sv;
+}
+
+int main(int argc, char* argv[]) {
+	using namespace std::literals;
+
+	// --mem-report - после обработки запросов вывести в stderr оценку занятой памяти
+	bool mem_report = false;
+	std::vector<std::string_view> args;
+	for (int i = 1; i < argc; ++i) {
+		if (argv[i] == "--mem-report"sv) {
+			mem_report = true;
+		} else {
+			args.emplace_back(argv[i]);
+		}
+	}
 
-	requests.AddToCatalogue(catalogue);
+	// make_snapshot - справочник строится по base_requests и записывается в файл снимка,
+	// process_requests - справочник загружается из снимка, base_requests не обрабатываются
+	// decode_tile - векторный тайл из ответа VectorTile (base64) выводится в виде JSON
+	const std::string_view mode = args.empty() ? std::string_view() : args[0];
+	if (mode == "decode_tile"sv) {
+		if (args.size() != 1) {
+			PrintUsage();
+			return 1;
+		}
+		try {
+			const std::string text{ std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>() };
+			vector_tile::Print(vector_tile::Decode(vector_tile::DecodeBase64(text)), std::cout);
+			std::cout << std::endl;
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+	if (!args.empty() && (args.size() != 2 || (mode != "make_snapshot"sv && mode != "process_requests"sv))) {
+		PrintUsage();
+		return 1;
+	}
+	const std::string snapshot_path = args.size() == 2 ? std::string(args[1]) : std::string();
+
+	Catalogue catalogue;
+	std::optional<json::JsonReader> reader;
+	try {
+		// base_requests загружаются в справочник прямо при разборе входного документа,
+		// ссылка на отсутствующую остановку - ошибка входных данных
+		if (mode == "process_requests"sv) {
+			reader.emplace(std::cin);
+			snapshot::LoadCatalogue(snapshot_path, catalogue);
+		} else {
+			reader.emplace(std::cin, catalogue);
+		}
+		if (mode == "make_snapshot"sv) {
+			snapshot::SaveCatalogue(catalogue, snapshot_path);
+			return 0;
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	json::JsonReader& requests = *reader;
     
+	// запросы изменения из stat_requests публикуют новые версии справочника через handle
+	CatalogueHandle handle(std::move(catalogue));
+
     const auto& settings = requests.GetRenderSettings().AsMap();
     const auto& map_renderer = requests.SetMapRenderer(settings);
     const auto& route_settings = requests.GetRoutingSettings().AsMap();
-    const auto& router = requests.SetRouter(route_settings, catalogue);
+    const auto& router = requests.SetRouter(route_settings, handle.Pin());
     
-    json::request_handler::RequestHandler(requests, catalogue, map_renderer, router, std::cout);
-}
+    json::request_handler::RequestHandler(requests, handle, map_renderer, router, std::cout);
+
+	if (mem_report) {
+		memory::PrintReport("catalogue"sv, handle.Pin()->GetMemoryReport(), std::cerr);
+		memory::PrintReport("router"sv, router.GetMemoryReport(), std::cerr);
+		memory::PrintReport("renderer"sv, map_renderer.GetMemoryReport(), std::cerr);
+	}
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "map_renderer.h"
+#include "parallel.h"
 
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
@@ -7,9 +8,16 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <optional>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 using namespace std::literals;
@@ -28,78 +36,687 @@ svg::Point SphereProjector::operator()(geo::Coordinates cords) const {
 	};
 }
 
-// ------ MapRender ------
-MapRenderer::MapRenderer(const RenderSettings& settings)
-	: render_settings_(settings) {
+namespace {
+// наибольший уровень масштаба фрагментов карты
+constexpr int MAX_ZOOM = 30;
+
+// настройки выводятся в строку: вещественные числа - точно, в шестнадцатеричном виде,
+// цвета - так же, как в SVG-документе
+uint64_t ComputeFingerprint(const RenderSettings& settings) {
+	std::ostringstream strm;
+	strm << std::hexfloat
+		<< settings.width << ' ' << settings.height << ' ' << settings.padding << ' '
+		<< settings.line_width << ' ' << settings.stop_radius << ' '
+		<< settings.bus_label_font_size << ' ' << settings.bus_label_offset.x << ' ' << settings.bus_label_offset.y << ' '
+		<< settings.stop_label_font_size << ' ' << settings.stop_label_offset.x << ' ' << settings.stop_label_offset.y << ' '
+		<< settings.underlayer_color << ' ' << settings.underlayer_width;
+	for (const auto& color : settings.color_palette) {
+		strm << ' ' << color;
+	}
+	strm << ' ' << settings.simplify_tolerance << ' ' << settings.stop_details_min_zoom;
+	return std::hash<std::string>{}(strm.str());
 }
 
-std::vector<svg::Polyline> MapRenderer::GetRoute(const std::map<std::string_view, transport_ctg::Bus*>& buses, const SphereProjector& sp) const{
-	std::vector<svg::Polyline> result;
-	size_t color_num = 0;
-	for (const auto& [busname, bus_ptr] : buses) {
-		if (bus_ptr->stops_ptr.empty()) {
+// стиль подложки под названиями остановок и маршрутов
+svg::PathStyle MakeUnderlayerStyle(const RenderSettings& settings) {
+	svg::PathStyle style;
+	style.fill_color = settings.underlayer_color;
+	style.stroke_color = settings.underlayer_color;
+	style.stroke_width = settings.underlayer_width;
+	style.line_cap = svg::StrokeLineCap::ROUND;
+	style.line_join = svg::StrokeLineJoin::ROUND;
+	return style;
+}
+
+// стили линий маршрутов, по одному на цвет палитры
+std::vector<svg::FlatDocument::StyleId> AddRouteStyles(const RenderSettings& settings, svg::FlatDocument& document) {
+	std::vector<svg::FlatDocument::StyleId> result;
+	for (const auto& color : settings.color_palette) {
+		svg::PathStyle style;
+		style.fill_color = "none"s;
+		style.stroke_color = color;
+		style.stroke_width = settings.line_width;
+		style.line_cap = svg::StrokeLineCap::ROUND;
+		style.line_join = svg::StrokeLineJoin::ROUND;
+		result.push_back(document.AddPathStyle(style));
+	}
+	return result;
+}
+
+// стили надписей: шрифт и подложка общие, заливка самой надписи - по номеру цвета
+struct LabelStyles {
+	svg::FlatDocument::StyleId font = 0;
+	svg::FlatDocument::StyleId underlayer = 0;
+	std::vector<svg::FlatDocument::StyleId> fills;
+};
+
+// цвет заливки названия маршрута должен соответствовать цвету маршрута
+LabelStyles AddBusLabelStyles(const RenderSettings& settings, svg::FlatDocument& document) {
+	svg::TextStyle font;
+	font.offset = settings.bus_label_offset;
+	font.font_size = settings.bus_label_font_size;
+	font.font_family = "Verdana"s;
+	font.font_weight = "bold"s;
+
+	LabelStyles result;
+	result.font = document.AddTextStyle(font);
+	result.underlayer = document.AddPathStyle(MakeUnderlayerStyle(settings));
+	for (const auto& color : settings.color_palette) {
+		svg::PathStyle style;
+		style.fill_color = color;
+		result.fills.push_back(document.AddPathStyle(style));
+	}
+	return result;
+}
+
+// названия остановок черные, единственный стиль заливки
+LabelStyles AddStopLabelStyles(const RenderSettings& settings, svg::FlatDocument& document) {
+	svg::TextStyle font;
+	font.offset = settings.stop_label_offset;
+	font.font_size = settings.stop_label_font_size;
+	font.font_family = "Verdana"s;
+
+	LabelStyles result;
+	result.font = document.AddTextStyle(font);
+	result.underlayer = document.AddPathStyle(MakeUnderlayerStyle(settings));
+	svg::PathStyle label;
+	label.fill_color = "black"s;
+	result.fills.push_back(document.AddPathStyle(label));
+	return result;
+}
+
+svg::FlatDocument::StyleId AddStopSymbolStyle(svg::FlatDocument& document) {
+	svg::PathStyle symbol;
+	symbol.fill_color = "white"s;
+	return document.AddPathStyle(symbol);
+}
+
+// надпись и подложка под ней
+void AddLabel(svg::FlatDocument& document, svg::Point position, std::string_view text, const LabelStyles& styles, size_t fill) {
+	document.AddText(position, text, styles.underlayer, styles.font);
+	document.AddText(position, text, styles.fills[fill], styles.font);
+}
+
+// Грубая оценка прямоугольника надписи: ширина символа не больше размера шрифта,
+// каждый байт названия считается отдельным символом
+Viewport GetLabelBounds(svg::Point anchor, svg::Point offset, uint32_t font_size, size_t text_size, double stroke_width) {
+	const double x = anchor.x + offset.x;
+	const double y = anchor.y + offset.y;
+	const double size = static_cast<double>(font_size);
+	return Viewport{ { x, y - size }, { x + size * static_cast<double>(text_size), y + size / 2. } }.Inflated(stroke_width / 2.);
+}
+
+// область опорных точек, надписи которых (не длиннее max_text_size) могут пересечь viewport
+Viewport GetLabelAnchorArea(const Viewport& viewport, svg::Point offset, uint32_t font_size, size_t max_text_size, double stroke_width) {
+	const Viewport bounds = GetLabelBounds({ 0., 0. }, offset, font_size, max_text_size, stroke_width);
+	return { { viewport.min.x - bounds.max.x, viewport.min.y - bounds.max.y },
+		{ viewport.max.x - bounds.min.x, viewport.max.y - bounds.min.y } };
+}
+
+// часть отрезка внутри области и признаки того, что концы были обрезаны
+struct ClippedSegment {
+	svg::Point from;
+	svg::Point to;
+	bool is_from_clipped = false;
+	bool is_to_clipped = false;
+};
+
+// отсечение отрезка прямоугольником (алгоритм Лианга-Барски)
+std::optional<ClippedSegment> ClipSegment(svg::Point from, svg::Point to, const Viewport& area) {
+	const double dx = to.x - from.x;
+	const double dy = to.y - from.y;
+	double t_from = 0.;
+	double t_to = 1.;
+	// для каждой границы: p * t <= q
+	const double p[] = { -dx, dx, -dy, dy };
+	const double q[] = { from.x - area.min.x, area.max.x - from.x, from.y - area.min.y, area.max.y - from.y };
+	for (int i = 0; i < 4; ++i) {
+		if (p[i] == 0.) {
+			if (q[i] < 0.) {
+				return std::nullopt;
+			}
 			continue;
 		}
-		svg::Polyline route;
-		for (const auto& stop : bus_ptr->stops_ptr) {
-			route.AddPoint(sp(stop->coordinates));
-		}
-		route.SetStrokeColor(render_settings_.color_palette[color_num]);
-		route.SetStrokeWidth(render_settings_.line_width);
-		route.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-		route.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-		route.SetFillColor("none"s);
-
-		if (color_num + 1 < render_settings_.color_palette.size()) {
-			++color_num;
+		const double t = q[i] / p[i];
+		if (p[i] < 0.) {
+			t_from = std::max(t_from, t);
 		} else {
-			color_num = 0;
+			t_to = std::min(t_to, t);
 		}
-		result.push_back(route);
+	}
+	if (t_from > t_to) {
+		return std::nullopt;
+	}
+	ClippedSegment result{ from, to, t_from > 0., t_to < 1. };
+	if (result.is_from_clipped) {
+		result.from = { from.x + t_from * dx, from.y + t_from * dy };
+	}
+	if (result.is_to_clipped) {
+		result.to = { from.x + t_to * dx, from.y + t_to * dy };
 	}
 	return result;
 }
 
-// названия маршрутов должны быть нарисованы в алфавитном порядке.
-// сначала выводится название для его первой конечной остановки, а затем, 
-// если маршрут некольцевой и конечные не совпадают - для второй конечной
-// Название маршрутов должно выводиться в двух текстовых объектах: подложке и самой надписи
-std::vector<svg::Text> MapRenderer::GetBusLabel(const std::map<std::string_view, transport_ctg::Bus*>& buses, const SphereProjector& projector) const {
-	std::vector<svg::Text> result;
-	svg::Text text;
-	svg::Text underlayer;
-	size_t color_num = 0;
+// квадрат расстояния от точки до отрезка
+double SquaredDistance(svg::Point point, svg::Point from, svg::Point to) {
+	const double dx = to.x - from.x;
+	const double dy = to.y - from.y;
+	const double length = dx * dx + dy * dy;
+	double t = 0.;
+	if (length > 0.) {
+		t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0., 1.);
+	}
+	const double x = from.x + t * dx - point.x;
+	const double y = from.y + t * dy - point.y;
+	return x * x + y * y;
+}
+
+// Упрощение ломаной points[first..last] по Дугласу-Пекеру: отмечает в keep вершины,
+// без которых линия отклонится больше чем на tolerance. Концы остаются всегда
+void Simplify(const std::vector<svg::Point>& points, size_t first, size_t last, double tolerance, std::vector<bool>& keep) {
+	keep[first] = true;
+	keep[last] = true;
+	const double squared_tolerance = tolerance * tolerance;
+	std::vector<std::pair<size_t, size_t>> ranges{ { first, last } };
+	while (!ranges.empty()) {
+		const auto [from, to] = ranges.back();
+		ranges.pop_back();
+		double max_distance = squared_tolerance;
+		size_t farthest = from;
+		for (size_t i = from + 1; i < to; ++i) {
+			const double distance = SquaredDistance(points[i], points[from], points[to]);
+			if (distance > max_distance) {
+				max_distance = distance;
+				farthest = i;
+			}
+		}
+		if (farthest != from) {
+			keep[farthest] = true;
+			ranges.push_back({ from, farthest });
+			ranges.push_back({ farthest, to });
+		}
+	}
+}
+} // namespace
+
+// ------ Viewport ------
+Viewport Viewport::Inflated(double margin) const {
+	return { { min.x - margin, min.y - margin }, { max.x + margin, max.y + margin } };
+}
+
+bool Viewport::Contains(svg::Point point) const {
+	return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
+
+bool Viewport::Intersects(const Viewport& other) const {
+	return other.min.x <= max.x && other.max.x >= min.x && other.min.y <= max.y && other.max.y >= min.y;
+}
+
+// ------ ProjectedStops ------
+ProjectedStops::ProjectedStops(const std::map<std::string_view, const transport_ctg::Bus*>& buses, const RenderSettings& settings) {
+	constexpr uint32_t NO_NUMBER = std::numeric_limits<uint32_t>::max();
+
+	// остановка попадает в список при первой встрече на маршрутах
+	for (const auto& [busname, bus] : buses) {
+		for (const auto* stop : bus->stops_ptr) {
+			if (stop->id >= numbers_.size()) {
+				numbers_.resize(stop->id + 1, NO_NUMBER);
+			}
+			if (numbers_[stop->id] == NO_NUMBER) {
+				numbers_[stop->id] = 0;
+				stops_.push_back(stop);
+			}
+		}
+	}
+	std::sort(stops_.begin(), stops_.end(), [](const transport_ctg::Stop* lhs, const transport_ctg::Stop* rhs) {
+		return lhs->name < rhs->name;
+	});
+
+	std::vector<geo::Coordinates> coordinates;
+	coordinates.reserve(stops_.size());
+	for (uint32_t number = 0; number < stops_.size(); ++number) {
+		numbers_[stops_[number]->id] = number;
+		coordinates.push_back(stops_[number]->coordinates);
+	}
+	projector_ = SphereProjector(coordinates.begin(), coordinates.end(), settings.width, settings.height, settings.padding);
+	points_.reserve(coordinates.size());
+	for (const auto& point : coordinates) {
+		points_.push_back(projector_(point));
+	}
+}
+
+const SphereProjector& ProjectedStops::GetProjector() const {
+	return projector_;
+}
+
+const std::vector<const transport_ctg::Stop*>& ProjectedStops::GetStops() const {
+	return stops_;
+}
+
+uint32_t ProjectedStops::GetNumber(const transport_ctg::Stop* stop) const {
+	return numbers_[stop->id];
+}
+
+svg::Point ProjectedStops::GetPoint(uint32_t number) const {
+	return points_[number];
+}
+
+svg::Point ProjectedStops::GetPoint(const transport_ctg::Stop* stop) const {
+	return points_[numbers_[stop->id]];
+}
+
+// ------ MapScene ------
+bool MapScene::SegmentRef::operator<(const SegmentRef& other) const {
+	return route != other.route ? route < other.route : segment < other.segment;
+}
 
+bool MapScene::SegmentRef::operator==(const SegmentRef& other) const {
+	return route == other.route && segment == other.segment;
+}
+
+MapScene::MapScene(const std::map<std::string_view, const transport_ctg::Bus*>& buses, const RenderSettings& settings) {
+	// остановки нумеруются в порядке возрастания названий и проецируются по одному разу
+	const ProjectedStops projected(buses, settings);
+	projector_ = projected.GetProjector();
+	stops_.reserve(projected.GetStops().size());
+	for (uint32_t number = 0; number < projected.GetStops().size(); ++number) {
+		const std::string_view stopname = projected.GetStops()[number]->name;
+		stops_.push_back({ stopname, projected.GetPoint(number) });
+		max_stop_name_size_ = std::max(max_stop_name_size_, stopname.size());
+	}
+
+	// цвета палитры назначаются маршрутам по кругу
+	size_t color = 0;
 	for (const auto& [busname, bus] : buses) {
 		if (bus->stops_ptr.empty()) {
 			continue;
 		}
-		// задаем общие настройки для самой надписи и подложки
-		text.SetPosition(projector(bus->stops_ptr[0]->coordinates));
-		text.SetOffset(render_settings_.bus_label_offset);
-		text.SetFontSize(render_settings_.bus_label_font_size);
-		text.SetFontFamily("Verdana"s);
-		text.SetFontWeight("bold"s);
-		text.SetData(static_cast<std::string>(bus->name));
-		underlayer = text;
-		
-		// доп свойства надписи - цвет заливки должен соответствовать цвету маршрута
-		text.SetFillColor(render_settings_.color_palette[color_num]);
-		if (color_num + 1 < render_settings_.color_palette.size()) {
-			++color_num;
-		} else {
-			color_num = 0;
+		RouteShape route{ busname, color, {}, bus->is_roundtrip };
+		route.stops.reserve(bus->stops_ptr.size());
+		for (const auto* stop : bus->stops_ptr) {
+			route.stops.push_back(projected.GetNumber(stop));
+		}
+		routes_.push_back(std::move(route));
+		max_route_name_size_ = std::max(max_route_name_size_, busname.size());
+		color = color + 1 < settings.color_palette.size() ? color + 1 : 0;
+	}
+
+	BuildGrid();
+	BuildStopRoutes();
+	simplify_tolerance_ = settings.simplify_tolerance;
+	BuildLevels(simplify_tolerance_);
+}
+
+const SphereProjector& MapScene::GetProjector() const {
+	return projector_;
+}
+
+const std::vector<MapScene::RouteShape>& MapScene::GetRoutes() const {
+	return routes_;
+}
+
+const std::vector<MapScene::StopPoint>& MapScene::GetStops() const {
+	return stops_;
+}
+
+size_t MapScene::GetMaxRouteNameSize() const {
+	return max_route_name_size_;
+}
+
+size_t MapScene::GetMaxStopNameSize() const {
+	return max_stop_name_size_;
+}
+
+void MapScene::BuildGrid() {
+	// сторона сетки не больше MAX_GRID_SIZE ячеек
+	constexpr int32_t MAX_GRID_SIZE = 4096;
+
+	size_t segment_count = 0;
+	for (const auto& route : routes_) {
+		segment_count += std::max<size_t>(route.stops.size(), 2) - 1;
+	}
+	if (stops_.empty()) {
+		segment_offsets_.assign(2, 0);
+		stop_offsets_.assign(2, 0);
+		return;
+	}
+
+	bounds_ = { stops_.front().point, stops_.front().point };
+	for (const auto& stop : stops_) {
+		bounds_.min = { std::min(bounds_.min.x, stop.point.x), std::min(bounds_.min.y, stop.point.y) };
+		bounds_.max = { std::max(bounds_.max.x, stop.point.x), std::max(bounds_.max.y, stop.point.y) };
+	}
+
+	// размер ячейки подбирается так, чтобы на ячейку в среднем приходилось около одного отрезка
+	const double width = bounds_.max.x - bounds_.min.x;
+	const double height = bounds_.max.y - bounds_.min.y;
+	const double count = static_cast<double>(std::max<size_t>(segment_count, stops_.size()));
+	cell_size_ = std::sqrt(width * height / count);
+	cell_size_ = std::max(cell_size_, std::max(width, height) / MAX_GRID_SIZE);
+	if (!(cell_size_ > 0.)) {
+		cell_size_ = 1.;
+	}
+	columns_ = std::min(static_cast<int32_t>(width / cell_size_) + 1, MAX_GRID_SIZE);
+	rows_ = std::min(static_cast<int32_t>(height / cell_size_) + 1, MAX_GRID_SIZE);
+	const size_t cell_count = static_cast<size_t>(columns_) * static_cast<size_t>(rows_);
+
+	// Отрезок обходит только ячейки, через которые проходит: в каждой строке сетки берется часть
+	// отрезка внутри полосы строки, и ее концы дают диапазон столбцов. Длинный отрезок через
+	// всю карту занимает порядка rows + columns ячеек, а не все ячейки своего прямоугольника.
+	// Границы расширяются на малую долю ячейки, чтобы точка на границе ячеек попала в обе
+	const double epsilon = cell_size_ * 1e-9;
+	const auto for_each_cell = [this, epsilon](svg::Point from, svg::Point to, auto action) {
+		const double min_y = std::min(from.y, to.y);
+		const double max_y = std::max(from.y, to.y);
+		const int32_t first_row = GetCell({ bounds_.min.x, min_y - epsilon }).row;
+		const int32_t last_row = GetCell({ bounds_.min.x, max_y + epsilon }).row;
+		const double dy = to.y - from.y;
+		for (int32_t row = first_row; row <= last_row; ++row) {
+			const double band_min = std::max(min_y, bounds_.min.y + row * cell_size_ - epsilon);
+			const double band_max = std::min(max_y, bounds_.min.y + (row + 1) * cell_size_ + epsilon);
+			double x1 = std::min(from.x, to.x);
+			double x2 = std::max(from.x, to.x);
+			if (dy != 0.) {
+				x1 = from.x + (std::clamp(band_min, min_y, max_y) - from.y) / dy * (to.x - from.x);
+				x2 = from.x + (std::clamp(band_max, min_y, max_y) - from.y) / dy * (to.x - from.x);
+			}
+			const int32_t first_column = GetCell({ std::min(x1, x2) - epsilon, bounds_.min.y }).column;
+			const int32_t last_column = GetCell({ std::max(x1, x2) + epsilon, bounds_.min.y }).column;
+			for (int32_t column = first_column; column <= last_column; ++column) {
+				action(GetIndex({ column, row }));
+			}
+		}
+	};
+	// сначала считаются размеры ячеек, затем элементы раскладываются по местам
+	const auto for_each_segment = [this, &for_each_cell](auto action) {
+		for (uint32_t route = 0; route < routes_.size(); ++route) {
+			const auto& stops = routes_[route].stops;
+			const uint32_t segment_count = static_cast<uint32_t>(std::max<size_t>(stops.size(), 2) - 1);
+			for (uint32_t segment = 0; segment < segment_count; ++segment) {
+				const svg::Point from = stops_[stops[segment]].point;
+				const svg::Point to = stops_[stops[std::min<size_t>(segment + 1, stops.size() - 1)]].point;
+				for_each_cell(from, to, [&action, route, segment](size_t cell) {
+					action(cell, SegmentRef{ route, segment });
+				});
+			}
+		}
+	};
+
+	segment_offsets_.assign(cell_count + 1, 0);
+	for_each_segment([this](size_t cell, SegmentRef) {
+		++segment_offsets_[cell + 1];
+	});
+	for (size_t i = 0; i < cell_count; ++i) {
+		segment_offsets_[i + 1] += segment_offsets_[i];
+	}
+	segments_.resize(segment_offsets_.back());
+	std::vector<uint32_t> positions(segment_offsets_.begin(), segment_offsets_.end() - 1);
+	for_each_segment([this, &positions](size_t cell, SegmentRef ref) {
+		segments_[positions[cell]++] = ref;
+	});
+
+	stop_offsets_.assign(cell_count + 1, 0);
+	for (const auto& stop : stops_) {
+		++stop_offsets_[GetIndex(GetCell(stop.point)) + 1];
+	}
+	for (size_t i = 0; i < cell_count; ++i) {
+		stop_offsets_[i + 1] += stop_offsets_[i];
+	}
+	stop_cells_.resize(stops_.size());
+	positions.assign(stop_offsets_.begin(), stop_offsets_.end() - 1);
+	for (uint32_t stop = 0; stop < stops_.size(); ++stop) {
+		stop_cells_[positions[GetIndex(GetCell(stops_[stop].point))]++] = stop;
+	}
+}
+
+std::optional<uint32_t> MapScene::FindRoute(std::string_view name) const {
+	const auto it = std::lower_bound(routes_.begin(), routes_.end(), name, [](const RouteShape& route, std::string_view name) {
+		return route.name < name;
+	});
+	if (it == routes_.end() || it->name != name) {
+		return std::nullopt;
+	}
+	return static_cast<uint32_t>(it - routes_.begin());
+}
+
+std::optional<uint32_t> MapScene::FindStop(std::string_view name) const {
+	const auto it = std::lower_bound(stops_.begin(), stops_.end(), name, [](const StopPoint& stop, std::string_view name) {
+		return stop.name < name;
+	});
+	if (it == stops_.end() || it->name != name) {
+		return std::nullopt;
+	}
+	return static_cast<uint32_t>(it - stops_.begin());
+}
+
+ranges::Range<std::vector<uint32_t>::const_iterator> MapScene::GetStopRoutes(uint32_t stop) const {
+	return { stop_routes_.begin() + stop_route_offsets_[stop], stop_routes_.begin() + stop_route_offsets_[stop + 1] };
+}
+
+// Маршрут учитывается у остановки один раз, сколько бы раз он через нее ни проходил.
+// Маршруты перебираются по возрастанию, поэтому списки остановок получаются упорядоченными
+void MapScene::BuildStopRoutes() {
+	constexpr uint32_t NO_ROUTE = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> last_route(stops_.size(), NO_ROUTE);
+	stop_route_offsets_.assign(stops_.size() + 1, 0);
+	for (uint32_t route = 0; route < routes_.size(); ++route) {
+		for (const uint32_t stop : routes_[route].stops) {
+			if (last_route[stop] != route) {
+				last_route[stop] = route;
+				++stop_route_offsets_[stop + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < stop_route_offsets_.size(); ++i) {
+		stop_route_offsets_[i] += stop_route_offsets_[i - 1];
+	}
+
+	stop_routes_.resize(stop_route_offsets_.back());
+	std::vector<uint32_t> next(stop_route_offsets_.begin(), stop_route_offsets_.end() - 1);
+	std::fill(last_route.begin(), last_route.end(), NO_ROUTE);
+	for (uint32_t route = 0; route < routes_.size(); ++route) {
+		for (const uint32_t stop : routes_[route].stops) {
+			if (last_route[stop] != route) {
+				last_route[stop] = route;
+				stop_routes_[next[stop]++] = route;
+			}
+		}
+	}
+}
+
+// Упрощение выполняется в координатах изображения карты: на уровне zoom допустимое отклонение
+// в 2^zoom раз меньше. У некольцевого маршрута вторая конечная остается вершиной линии
+void MapScene::BuildLevels(double tolerance) {
+	if (!(tolerance > 0.)) {
+		return;
+	}
+	std::vector<svg::Point> points;
+	std::vector<bool> keep;
+	for (int zoom = 0; zoom <= MAX_ZOOM; ++zoom) {
+		const double level_tolerance = std::ldexp(tolerance, -zoom);
+		std::vector<std::vector<uint32_t>> level;
+		level.reserve(routes_.size());
+		bool is_simplified = false;
+		for (const auto& route : routes_) {
+			points.clear();
+			for (const uint32_t stop : route.stops) {
+				points.push_back(stops_[stop].point);
+			}
+			keep.assign(points.size(), false);
+			const size_t last = points.size() - 1;
+			if (route.is_roundtrip) {
+				Simplify(points, 0, last, level_tolerance, keep);
+			} else {
+				Simplify(points, 0, points.size() / 2, level_tolerance, keep);
+				Simplify(points, points.size() / 2, last, level_tolerance, keep);
+			}
+
+			std::vector<uint32_t> vertices;
+			for (uint32_t i = 0; i < keep.size(); ++i) {
+				if (keep[i]) {
+					vertices.push_back(i);
+				}
+			}
+			is_simplified = is_simplified || vertices.size() < points.size();
+			level.push_back(std::move(vertices));
+		}
+		if (!is_simplified) {
+			break;
+		}
+		levels_.push_back(std::move(level));
+	}
+}
+
+const std::vector<uint32_t>* MapScene::GetSimplifiedRoute(int zoom, uint32_t route) const {
+	const size_t level = static_cast<size_t>(std::max(zoom, 0));
+	return level < levels_.size() ? &levels_[level][route] : nullptr;
+}
+
+// На мелких масштабах выводятся упрощенные линии: отрезок упрощенной линии заменяет
+// несколько исходных и отклоняется от них не больше чем на допустимое отклонение уровня,
+// поэтому исходные отрезки ищутся в области, расширенной на это отклонение
+void MapScene::ClipRoutes(const Viewport& area, int zoom, const std::function<void(uint32_t)>& start, const std::function<void(svg::Point)>& add) const {
+	const double tolerance = std::max(std::ldexp(simplify_tolerance_, -std::max(zoom, 0)), 0.);
+	const auto segments = FindSegments(area.Inflated(tolerance));
+	for (size_t i = 0; i < segments.size();) {
+		const uint32_t current = segments[i].route;
+		const auto& route = routes_[current];
+		// ломаная из одной точки
+		if (route.stops.size() == 1) {
+			start(current);
+			add(stops_[route.stops[0]].point);
+			++i;
+			continue;
+		}
+		const auto* vertices = GetSimplifiedRoute(zoom, current);
+		bool is_open = false;
+		std::optional<uint32_t> last_segment;
+		for (; i < segments.size() && segments[i].route == current; ++i) {
+			uint32_t segment = segments[i].segment;
+			uint32_t from = segment;
+			uint32_t to = segment + 1;
+			if (vertices) {
+				const auto next = std::upper_bound(vertices->begin(), vertices->end(), segment);
+				segment = static_cast<uint32_t>(next - vertices->begin()) - 1;
+				from = *std::prev(next);
+				to = *next;
+			}
+			if (last_segment == segment) {
+				continue;
+			}
+			const bool is_next = last_segment && *last_segment + 1 == segment;
+			last_segment = segment;
+
+			// видимые части отрезков, идущие подряд, объединяются в одну ломаную
+			const auto clipped = ClipSegment(stops_[route.stops[from]].point, stops_[route.stops[to]].point, area);
+			if (!clipped) {
+				is_open = false;
+				continue;
+			}
+			if (!is_open || !is_next || clipped->is_from_clipped) {
+				start(current);
+				add(clipped->from);
+			}
+			add(clipped->to);
+			is_open = !clipped->is_to_clipped;
+		}
+	}
+}
+
+MapScene::Cell MapScene::GetCell(svg::Point point) const {
+	const auto clamp = [](double value, int32_t size) {
+		return static_cast<int32_t>(std::clamp(std::floor(value), 0., static_cast<double>(size - 1)));
+	};
+	return {
+		clamp((point.x - bounds_.min.x) / cell_size_, columns_),
+		clamp((point.y - bounds_.min.y) / cell_size_, rows_)
+	};
+}
+
+size_t MapScene::GetIndex(Cell cell) const {
+	return static_cast<size_t>(cell.row) * static_cast<size_t>(columns_) + static_cast<size_t>(cell.column);
+}
+
+std::vector<MapScene::SegmentRef> MapScene::FindSegments(const Viewport& viewport) const {
+	std::vector<SegmentRef> result;
+	if (segments_.empty() || !bounds_.Intersects(viewport)) {
+		return result;
+	}
+	const Cell first = GetCell(viewport.min);
+	const Cell last = GetCell(viewport.max);
+	for (int32_t row = first.row; row <= last.row; ++row) {
+		for (int32_t column = first.column; column <= last.column; ++column) {
+			const size_t cell = GetIndex({ column, row });
+			for (uint32_t i = segment_offsets_[cell]; i < segment_offsets_[cell + 1]; ++i) {
+				const SegmentRef ref = segments_[i];
+				const auto& stops = routes_[ref.route].stops;
+				const svg::Point from = stops_[stops[ref.segment]].point;
+				const svg::Point to = stops_[stops[std::min<size_t>(ref.segment + 1, stops.size() - 1)]].point;
+				if (ClipSegment(from, to, viewport)) {
+					result.push_back(ref);
+				}
+			}
 		}
+	}
+	// отрезок, занимающий несколько ячеек, мог попасть в результат несколько раз
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+std::vector<uint32_t> MapScene::FindStops(const Viewport& viewport) const {
+	std::vector<uint32_t> result;
+	if (stop_cells_.empty() || !bounds_.Intersects(viewport)) {
+		return result;
+	}
+	const Cell first = GetCell(viewport.min);
+	const Cell last = GetCell(viewport.max);
+	for (int32_t row = first.row; row <= last.row; ++row) {
+		for (int32_t column = first.column; column <= last.column; ++column) {
+			const size_t cell = GetIndex({ column, row });
+			for (uint32_t i = stop_offsets_[cell]; i < stop_offsets_[cell + 1]; ++i) {
+				if (viewport.Contains(stops_[stop_cells_[i]].point)) {
+					result.push_back(stop_cells_[i]);
+				}
+			}
+		}
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+// ------ MapRender ------
+MapRenderer::MapRenderer(const RenderSettings& settings, size_t min_part_size)
+	: render_settings_(settings)
+	, settings_fingerprint_(ComputeFingerprint(settings))
+	, min_part_size_(std::max<size_t>(min_part_size, 1)) {
+}
+
+uint64_t MapRenderer::GetSettingsFingerprint() const {
+	return settings_fingerprint_;
+}
 
-		// доп свойства подложки
-		underlayer.SetFillColor(render_settings_.underlayer_color);
-		underlayer.SetStrokeColor(render_settings_.underlayer_color);
-		underlayer.SetStrokeWidth(render_settings_.underlayer_width);
-		underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-		underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+const RenderSettings& MapRenderer::GetRenderSettings() const {
+	return render_settings_;
+}
 
-		result.push_back(underlayer);
-		result.push_back(text);
+void MapRenderer::DrawRoutes(RouteRange routes, const ProjectedStops& points, svg::FlatDocument& document) const {
+	const auto route_styles = AddRouteStyles(render_settings_, document);
+	for (const auto& [bus, color] : routes) {
+		document.StartPolyline(route_styles[color]);
+		for (const auto* stop : bus->stops_ptr) {
+			document.AddPoint(points.GetPoint(stop));
+		}
+	}
+}
+
+// сначала выводится название для первой конечной остановки маршрута, а затем, 
+// если маршрут некольцевой и конечные не совпадают - для второй конечной
+// Название маршрутов должно выводиться в двух текстовых объектах: подложке и самой надписи
+void MapRenderer::DrawBusLabels(RouteRange routes, const ProjectedStops& points, svg::FlatDocument& document) const {
+	const auto styles = AddBusLabelStyles(render_settings_, document);
+	for (const auto& [bus, color] : routes) {
+		AddLabel(document, points.GetPoint(bus->stops_ptr[0]), bus->name, styles, color);
 
 		// добавляем надпись для второй конечной остановки, если маршрут некольцевой и конечные различны
 		if (!(bus->is_roundtrip)) {
@@ -107,98 +724,216 @@ std::vector<svg::Text> MapRenderer::GetBusLabel(const std::map<std::string_view,
 			const auto& second_last_stop = bus->stops_ptr[bus->stops_ptr.size() / 2];
 
 			if (bus->stops_ptr[0] != second_last_stop) {
-				svg::Text text2 = text;
-				svg::Text underlayer2 = underlayer;
-				text2.SetPosition(projector(second_last_stop->coordinates));
-				underlayer2.SetPosition(projector(second_last_stop->coordinates));
-
-				result.push_back(underlayer2);
-				result.push_back(text2);
+				AddLabel(document, points.GetPoint(second_last_stop), bus->name, styles, color);
 			}
 		}
 	}
-	return result;
 }
 
-// выводит изображение в виде кружочков для каждой остановки в порядке возрастания
-std::vector<svg::Circle> MapRenderer::GetStopsSymbols(const std::map<std::string_view, transport_ctg::Stop*>& sorted_stops, const SphereProjector& projector) const{
-	std::vector<svg::Circle> result;
-	svg::Circle symbol;
-	for (const auto& [stopname, stop] : sorted_stops) {
-		symbol.SetCenter(projector(stop->coordinates));
-		symbol.SetRadius(render_settings_.stop_radius);
-		symbol.SetFillColor("white"s);
-		result.push_back(symbol);
+// выводит изображение в виде кружочков для каждой остановки
+void MapRenderer::DrawStopsSymbols(StopRange stops, const ProjectedStops& points, svg::FlatDocument& document) const {
+	const auto symbol_style = AddStopSymbolStyle(document);
+	for (const auto* stop : stops) {
+		document.AddCircle(points.GetPoint(stop), render_settings_.stop_radius, symbol_style);
 	}
-	return result;
 }
 
-// sorted_stops список остановок в порядке возрастания, через которые проезжает хотя бы один маршрут
-std::vector<svg::Text> MapRenderer::GetStopLabel(const std::map<std::string_view, transport_ctg::Stop*>& sorted_stops, const SphereProjector& projector) const {
-	std::vector<svg::Text> result;
-	svg::Text text;
-	svg::Text underlayer;
-
-	for (const auto& [stopname, stop] : sorted_stops) {
-		text.SetPosition(projector(stop->coordinates));
-		text.SetOffset(render_settings_.stop_label_offset);
-		text.SetFontSize(render_settings_.stop_label_font_size);
-		text.SetFontFamily("Verdana"s);
-		text.SetData(static_cast<std::string>(stopname));
-		underlayer = text;
-		
-		// дополнительные свойства для подложки
-		underlayer.SetFillColor(render_settings_.underlayer_color);
-		underlayer.SetStrokeColor(render_settings_.underlayer_color);
-		underlayer.SetStrokeWidth(render_settings_.underlayer_width);
-		underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-		underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-		// дополнительные свойства для надписи
-		text.SetFillColor("black"s);
-		
-		result.push_back(underlayer);
-		result.push_back(text);
+void MapRenderer::DrawStopLabels(StopRange stops, const ProjectedStops& points, svg::FlatDocument& document) const {
+	const auto styles = AddStopLabelStyles(render_settings_, document);
+	for (const auto* stop : stops) {
+		AddLabel(document, points.GetPoint(stop), stop->name, styles, 0);
 	}
-	return result;
 }
 
-svg::Document MapRenderer::GetRenderedMap(const std::map<std::string_view, transport_ctg::Bus*>& buses) const {
-	svg::Document document;
-	std::vector<geo::Coordinates> stops_coords;
-	std::map<std::string_view, transport_ctg::Stop*> sorted_stops;
-
+// Маршруты выводятся в алфавитном порядке, цвета палитры назначаются им по кругу.
+// Остановки - только те, через которые проезжает хотя бы один маршрут, в порядке возрастания названий
+svg::LayeredDocument MapRenderer::GetRenderedMap(const std::map<std::string_view, const transport_ctg::Bus*>& buses) const {
+	std::vector<RouteItem> routes;
+	size_t color_num = 0;
 	for (const auto& [busname, bus] : buses) {
 		if (bus->stops_ptr.empty()) {
 			continue;
 		}
-		for (const auto& stop : bus->stops_ptr) {
-			stops_coords.push_back(stop->coordinates);
-			sorted_stops.emplace( stop->name, stop );
+		routes.push_back({ bus, color_num });
+		color_num = color_num + 1 < render_settings_.color_palette.size() ? color_num + 1 : 0;
+	}
+	// все слои берут точки остановок из одного массива
+	const ProjectedStops points(buses, render_settings_);
+	const auto& stops = points.GetStops();
+
+	// каждый слой делится на части не меньше min_part_size_ элементов, но не больше, чем потоков
+	const auto get_part_count = [this](size_t size) {
+		return std::clamp<size_t>(size / min_part_size_, 1, parallel::GetThreadCount());
+	};
+	const size_t route_parts = get_part_count(routes.size());
+	const size_t stop_parts = get_part_count(stops.size());
+	// границы части part из count частей списка
+	const auto get_part = [](const auto& items, size_t part, size_t count) {
+		return ranges::Range{ items.begin() + items.size() * part / count, items.begin() + items.size() * (part + 1) / count };
+	};
+
+	// части документа: линии маршрутов, названия маршрутов, значки остановок, названия остановок
+	svg::LayeredDocument document(2 * route_parts + 2 * stop_parts);
+	parallel::ForEachIndex(document.GetPartCount(), [&](size_t part) {
+		auto& layer = document.GetPart(part);
+		if (part < route_parts) {
+			DrawRoutes(get_part(routes, part, route_parts), points, layer);
+		} else if (part < 2 * route_parts) {
+			DrawBusLabels(get_part(routes, part - route_parts, route_parts), points, layer);
+		} else if (part < 2 * route_parts + stop_parts) {
+			DrawStopsSymbols(get_part(stops, part - 2 * route_parts, stop_parts), points, layer);
+		} else {
+			DrawStopLabels(get_part(stops, part - 2 * route_parts - stop_parts, stop_parts), points, layer);
+		}
+	});
+
+	return document;
+}
+
+MapScene MapRenderer::MakeScene(const std::map<std::string_view, const transport_ctg::Bus*>& buses) const {
+	return MapScene(buses, render_settings_);
+}
+
+svg::FlatDocument MapRenderer::GetRenderedMap(const MapScene& scene, const Viewport& viewport) const {
+	svg::FlatDocument document;
+	document.SetViewBox(viewport.min, viewport.max);
+	const auto& routes = scene.GetRoutes();
+	const auto& stops = scene.GetStops();
+
+	// линии маршрутов: видимые части отрезков, идущие подряд, объединяются в одну ломаную.
+	// Линии обрезаются с запасом на половину толщины, чтобы край не был виден
+	const int zoom = GetZoom(viewport);
+	const auto route_styles = AddRouteStyles(render_settings_, document);
+	scene.ClipRoutes(viewport.Inflated(render_settings_.line_width / 2.), zoom,
+		[&](uint32_t route) {
+			document.StartPolyline(route_styles[routes[route].color]);
+		},
+		[&document](svg::Point point) {
+			document.AddPoint(point);
+		});
+
+	// названия маршрутов у конечных остановок, до которых может дотянуться надпись
+	const auto bus_styles = AddBusLabelStyles(render_settings_, document);
+	const auto bus_label_visible = [&](svg::Point anchor, std::string_view name) {
+		return GetLabelBounds(anchor, render_settings_.bus_label_offset, render_settings_.bus_label_font_size,
+			name.size(), render_settings_.underlayer_width).Intersects(viewport);
+	};
+	const auto bus_label_segments = scene.FindSegments(GetLabelAnchorArea(viewport, render_settings_.bus_label_offset,
+		render_settings_.bus_label_font_size, scene.GetMaxRouteNameSize(), render_settings_.underlayer_width));
+	for (size_t i = 0; i < bus_label_segments.size(); ++i) {
+		if (i > 0 && bus_label_segments[i].route == bus_label_segments[i - 1].route) {
+			continue;
+		}
+		const auto& route = routes[bus_label_segments[i].route];
+		const svg::Point first = stops[route.stops[0]].point;
+		if (bus_label_visible(first, route.name)) {
+			AddLabel(document, first, route.name, bus_styles, route.color);
 		}
+		const uint32_t second_stop = route.stops[route.stops.size() / 2];
+		if (!route.is_roundtrip && route.stops[0] != second_stop && bus_label_visible(stops[second_stop].point, route.name)) {
+			AddLabel(document, stops[second_stop].point, route.name, bus_styles, route.color);
+		}
+	}
+
+	// на мелких масштабах значки и названия остановок не выводятся
+	if (zoom < render_settings_.stop_details_min_zoom) {
+		return document;
 	}
 
-	SphereProjector projector(
-		stops_coords.begin(), stops_coords.end(),
-		render_settings_.width, render_settings_.height,
-		render_settings_.padding
-	);
+	// значки остановок
+	const auto symbol_style = AddStopSymbolStyle(document);
+	for (const uint32_t stop : scene.FindStops(viewport.Inflated(render_settings_.stop_radius))) {
+		document.AddCircle(stops[stop].point, render_settings_.stop_radius, symbol_style);
+	}
+
+	// названия остановок
+	const auto stop_styles = AddStopLabelStyles(render_settings_, document);
+	const auto stop_label_area = GetLabelAnchorArea(viewport, render_settings_.stop_label_offset,
+		render_settings_.stop_label_font_size, scene.GetMaxStopNameSize(), render_settings_.underlayer_width);
+	for (const uint32_t stop : scene.FindStops(stop_label_area)) {
+		const auto& [name, point] = stops[stop];
+		if (GetLabelBounds(point, render_settings_.stop_label_offset, render_settings_.stop_label_font_size,
+			name.size(), render_settings_.underlayer_width).Intersects(viewport)) {
+			AddLabel(document, point, name, stop_styles, 0);
+		}
+	}
+
+	return document;
+}
+
+// Слои и их порядок те же, что у всей карты, линии маршрутов выводятся целиком
+svg::FlatDocument MapRenderer::GetRenderedMap(const MapScene& scene, const std::vector<uint32_t>& route_numbers, const std::vector<uint32_t>& stop_numbers) const {
+	svg::FlatDocument document;
+	const auto& routes = scene.GetRoutes();
+	const auto& stops = scene.GetStops();
 
-	for (const auto& line : GetRoute(buses, projector)) {
-		document.Add(line);
+	const auto route_styles = AddRouteStyles(render_settings_, document);
+	for (const uint32_t number : route_numbers) {
+		const auto& route = routes[number];
+		document.StartPolyline(route_styles[route.color]);
+		for (const uint32_t stop : route.stops) {
+			document.AddPoint(stops[stop].point);
+		}
 	}
-	for (const auto& bus_label : GetBusLabel(buses, projector)) {
-		document.Add(bus_label);
+
+	const auto bus_styles = AddBusLabelStyles(render_settings_, document);
+	for (const uint32_t number : route_numbers) {
+		const auto& route = routes[number];
+		AddLabel(document, stops[route.stops[0]].point, route.name, bus_styles, route.color);
+		const uint32_t second_stop = route.stops[route.stops.size() / 2];
+		if (!route.is_roundtrip && route.stops[0] != second_stop) {
+			AddLabel(document, stops[second_stop].point, route.name, bus_styles, route.color);
+		}
 	}
-	for (const auto& stop_symbols : GetStopsSymbols(sorted_stops, projector)) {
-		document.Add(stop_symbols);
+
+	const auto symbol_style = AddStopSymbolStyle(document);
+	for (const uint32_t stop : stop_numbers) {
+		document.AddCircle(stops[stop].point, render_settings_.stop_radius, symbol_style);
 	}
-	for (const auto& stop_label : GetStopLabel(sorted_stops, projector)) {
-		document.Add(stop_label);
+
+	const auto stop_styles = AddStopLabelStyles(render_settings_, document);
+	for (const uint32_t stop : stop_numbers) {
+		AddLabel(document, stops[stop].point, stops[stop].name, stop_styles, 0);
 	}
 
 	return document;
 }
 
+std::optional<Viewport> MapRenderer::GetTileViewport(int zoom, int x, int y) const {
+	if (zoom < 0 || zoom > MAX_ZOOM) {
+		return std::nullopt;
+	}
+	const int64_t tile_count = int64_t{ 1 } << zoom;
+	if (x < 0 || y < 0 || x >= tile_count || y >= tile_count) {
+		return std::nullopt;
+	}
+	const double tile_width = render_settings_.width / static_cast<double>(tile_count);
+	const double tile_height = render_settings_.height / static_cast<double>(tile_count);
+	return Viewport{ { x * tile_width, y * tile_height }, { (x + 1) * tile_width, (y + 1) * tile_height } };
+}
+
+// допуск в 1e-9 нужен, чтобы уровень тайла не терялся из-за округления его размеров
+int MapRenderer::GetZoom(const Viewport& viewport) const {
+	const double scale = std::min(render_settings_.width / (viewport.max.x - viewport.min.x),
+		render_settings_.height / (viewport.max.y - viewport.min.y));
+	if (!(scale >= 1.)) {
+		return 0;
+	}
+	return std::min(static_cast<int>(std::floor(std::log2(scale) + 1e-9)), MAX_ZOOM);
+}
+
+memory::MemoryReport MapRenderer::GetMemoryReport() const {
+	const auto color_bytes = [](const svg::Color& color) {
+		const auto* str = std::get_if<std::string>(&color);
+		return str ? memory::Bytes(*str) : 0;
+	};
+	std::size_t bytes = color_bytes(render_settings_.underlayer_color) + memory::Bytes(render_settings_.color_palette);
+	for (const auto& color : render_settings_.color_palette) {
+		bytes += color_bytes(color);
+	}
+	memory::MemoryReport report;
+	report.Add("render_settings"s, bytes);
+	return report;
+}
 
 } // namespace renderer
\ No newline at end of file
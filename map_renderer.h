@@ -8,10 +8,13 @@
 
 #include "domain.h"
 #include "geo.h"
+#include "memory_report.h"
+#include "ranges.h"
 #include "svg.h"
 
 #include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <optional>
@@ -37,11 +40,16 @@ struct RenderSettings {
     svg::Color underlayer_color = { svg::NoneColor }; //цвет подложки под названиями остановок и маршрутов
     double underlayer_width = 0.0;
     std::vector<svg::Color> color_palette{}; // цветовая палитра
+    // необязательные настройки отрисовки фрагментов карты
+    double simplify_tolerance = 0.5; // допустимое отклонение упрощенных линий маршрутов в пикселях
+    int stop_details_min_zoom = 0; // уровень масштаба, начиная с которого выводятся значки и названия остановок
 };
 
 // проецирует координаты остановок на карту
 class SphereProjector {
 public:
+    SphereProjector() = default;
+
     // points_begin и points_end задают начало и конец интервала элементов geo::Coordinates
     template <typename PointInputIt>
     SphereProjector(PointInputIt points_begin, PointInputIt points_end,
@@ -51,7 +59,7 @@ public:
     svg::Point operator()(geo::Coordinates coords) const;
 
 private:
-    double padding_;
+    double padding_ = 0;
     double min_lon_ = 0;
     double max_lat_ = 0;
     double zoom_coeff_ = 0;
@@ -106,18 +114,193 @@ SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_
     }
 }
 
+// Прямоугольная область изображения карты
+struct Viewport {
+    svg::Point min; // левый верхний угол
+    svg::Point max; // правый нижний угол
+
+    // область, расширенная на margin во все стороны
+    Viewport Inflated(double margin) const;
+    bool Contains(svg::Point point) const;
+    bool Intersects(const Viewport& other) const;
+};
+
+// Остановки, через которые проходит хотя бы один маршрут, и их точки на изображении.
+// Каждая остановка учитывается один раз: ограничивающий прямоугольник строится по различным
+// остановкам, и каждая проецируется один раз, слои карты берут точки по номеру остановки
+class ProjectedStops {
+public:
+    ProjectedStops(const std::map<std::string_view, const transport_ctg::Bus*>& buses, const RenderSettings& settings);
+
+    const SphereProjector& GetProjector() const;
+    // в порядке возрастания названий
+    const std::vector<const transport_ctg::Stop*>& GetStops() const;
+    // номер остановки маршрута в GetStops()
+    uint32_t GetNumber(const transport_ctg::Stop* stop) const;
+    svg::Point GetPoint(uint32_t number) const;
+    svg::Point GetPoint(const transport_ctg::Stop* stop) const;
+
+private:
+    SphereProjector projector_;
+    std::vector<const transport_ctg::Stop*> stops_;
+    // номера остановок по их идентификаторам в справочнике
+    std::vector<uint32_t> numbers_;
+    std::vector<svg::Point> points_;
+};
+
+// Сеть маршрутов, спроецированная на изображение карты, с равномерной сеткой по отрезкам
+// маршрутов и остановкам. Строится один раз для набора маршрутов и позволяет отрисовывать
+// часть карты за время, зависящее от количества видимых объектов, а не от размера сети.
+// Сетка хранится так же, как в StopsSpatialIndex: элементы упорядочены по ячейкам построчно,
+// отрезок попадает только в ячейки, через которые проходит.
+class MapScene {
+public:
+    // остановка, через которую проходит хотя бы один маршрут, и ее точка на изображении
+    struct StopPoint {
+        std::string_view name;
+        svg::Point point;
+    };
+
+    // маршрут: вершины ломаной - номера остановок в GetStops()
+    struct RouteShape {
+        std::string_view name;
+        // номер цвета в палитре
+        size_t color = 0;
+        std::vector<uint32_t> stops;
+        bool is_roundtrip = false;
+    };
+
+    // отрезок между вершинами segment и segment + 1 маршрута route
+    // (у маршрута из одной остановки единственный отрезок нулевой длины)
+    struct SegmentRef {
+        uint32_t route = 0;
+        uint32_t segment = 0;
+
+        bool operator<(const SegmentRef& other) const;
+        bool operator==(const SegmentRef& other) const;
+    };
+
+    MapScene(const std::map<std::string_view, const transport_ctg::Bus*>& buses, const RenderSettings& settings);
+
+    const SphereProjector& GetProjector() const;
+    // в порядке возрастания названий
+    const std::vector<RouteShape>& GetRoutes() const;
+    const std::vector<StopPoint>& GetStops() const;
+    // наибольшая длина названия маршрута и остановки в байтах
+    size_t GetMaxRouteNameSize() const;
+    size_t GetMaxStopNameSize() const;
+
+    // номер маршрута или остановки по названию, пусто, если их нет на карте
+    std::optional<uint32_t> FindRoute(std::string_view name) const;
+    std::optional<uint32_t> FindStop(std::string_view name) const;
+    // номера маршрутов, проходящих через остановку, по возрастанию
+    ranges::Range<std::vector<uint32_t>::const_iterator> GetStopRoutes(uint32_t stop) const;
+
+    // отрезки, проходящие через область (хотя бы касающиеся ее), по возрастанию маршрута и отрезка
+    std::vector<SegmentRef> FindSegments(const Viewport& viewport) const;
+    // номера остановок внутри области по возрастанию
+    std::vector<uint32_t> FindStops(const Viewport& viewport) const;
+
+    // Уровни детализации: на уровне zoom одна единица изображения карты занимает 2^zoom пикселей.
+    // Возвращает номера вершин маршрута route (по возрастанию, с первой и последней),
+    // оставленных упрощением ломаной, или nullptr, если на этом уровне линии выводятся целиком
+    const std::vector<uint32_t>* GetSimplifiedRoute(int zoom, uint32_t route) const;
+    // Видимые в области части линий маршрутов на уровне zoom: для каждой ломаной
+    // вызывается start(номер маршрута), затем add для каждой ее вершины по порядку.
+    // Ломаные выводятся по возрастанию номеров маршрутов, как их рисует карта
+    void ClipRoutes(const Viewport& area, int zoom, const std::function<void(uint32_t)>& start, const std::function<void(svg::Point)>& add) const;
+
+private:
+    struct Cell {
+        int32_t column = 0;
+        int32_t row = 0;
+    };
+
+    SphereProjector projector_;
+    std::vector<RouteShape> routes_;
+    std::vector<StopPoint> stops_;
+    size_t max_route_name_size_ = 0;
+    size_t max_stop_name_size_ = 0;
+
+    // сетка покрывает прямоугольник bounds_ ячейками со стороной cell_size_
+    Viewport bounds_;
+    double cell_size_ = 1.0;
+    int32_t columns_ = 1;
+    int32_t rows_ = 1;
+    // элементы ячейки i - [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> segment_offsets_;
+    std::vector<SegmentRef> segments_;
+    std::vector<uint32_t> stop_offsets_;
+    std::vector<uint32_t> stop_cells_;
+    // маршруты остановки i - [stop_route_offsets_[i], stop_route_offsets_[i + 1])
+    std::vector<uint32_t> stop_route_offsets_;
+    std::vector<uint32_t> stop_routes_;
+
+    // вершины маршрутов, упрощенных по Дугласу-Пекеру: levels_[zoom][route].
+    // Уровни заканчиваются на первом, где упрощение не отбрасывает ни одной вершины
+    std::vector<std::vector<std::vector<uint32_t>>> levels_;
+    double simplify_tolerance_ = 0.0;
+
+    void BuildGrid();
+    void BuildStopRoutes();
+    void BuildLevels(double tolerance);
+    Cell GetCell(svg::Point point) const;
+    size_t GetIndex(Cell cell) const;
+};
+
 class MapRenderer {
 public:
-    MapRenderer(const RenderSettings& render_settings);
+    // меньшие части слоя не окупают запуск потока
+    static constexpr size_t MIN_PART_SIZE = 256;
+
+    // min_part_size - наименьший размер части слоя в GetRenderedMap(buses); меньшее значение
+    // делит слои на большее число частей, например, чтобы проверить их склейку
+    MapRenderer(const RenderSettings& render_settings, size_t min_part_size = MIN_PART_SIZE);
 
-    std::vector<svg::Polyline> GetRoute(const std::map<std::string_view, transport_ctg::Bus*>& buses, const SphereProjector& sp) const;
-    std::vector<svg::Text> GetBusLabel(const std::map<std::string_view, transport_ctg::Bus*>& buses, const SphereProjector& sp) const;
-    std::vector<svg::Circle> GetStopsSymbols(const std::map<std::string_view, transport_ctg::Stop*>& stops, const SphereProjector& sp) const;
-    std::vector<svg::Text> GetStopLabel(const std::map<std::string_view, transport_ctg::Stop*>& stops, const SphereProjector& sp) const;
+    // Отрисовывает всю карту. Слои, а внутри слоя - части списков маршрутов и остановок
+    // (не меньше min_part_size элементов, не больше частей, чем потоков) рисуются параллельно,
+    // каждая часть в свою часть документа в порядке вывода
+    svg::LayeredDocument GetRenderedMap(const std::map<std::string_view, const transport_ctg::Bus*>& buses) const;
 
-    svg::Document GetRenderedMap(const std::map<std::string_view, transport_ctg::Bus*>& buses) const;
+    MapScene MakeScene(const std::map<std::string_view, const transport_ctg::Bus*>& buses) const;
+    // Отрисовывает часть карты: линии маршрутов обрезаются по границе области, надписи
+    // и значки остановок выводятся, если могут оказаться в ней хотя бы частично.
+    // Область задается документу как viewBox, порядок слоев тот же, что у всей карты
+    svg::FlatDocument GetRenderedMap(const MapScene& scene, const Viewport& viewport) const;
+    // Отрисовывает часть сети: маршруты routes и остановки stops (номера в сцене по возрастанию).
+    // Проекция и цвета маршрутов те же, что у всей карты, время зависит только от размера части
+    svg::FlatDocument GetRenderedMap(const MapScene& scene, const std::vector<uint32_t>& routes, const std::vector<uint32_t>& stops) const;
+    // Область тайла x, y уровня zoom: изображение карты делится на 2^zoom x 2^zoom
+    // равных частей, нумерация с левого верхнего угла. Пусто, если номер тайла неверен
+    std::optional<Viewport> GetTileViewport(int zoom, int x, int y) const;
+    // уровень масштаба, при котором область занимает все изображение карты (для тайла - его zoom)
+    int GetZoom(const Viewport& viewport) const;
+
+    // отпечаток настроек визуализации: карты, отрисованные по одному справочнику
+    // с одинаковыми отпечатками, совпадают
+    uint64_t GetSettingsFingerprint() const;
+    const RenderSettings& GetRenderSettings() const;
+
+    // оценка памяти, занятой настройками визуализации
+    memory::MemoryReport GetMemoryReport() const;
 private:
+    // маршрут хотя бы с одной остановкой и номер его цвета в палитре
+    struct RouteItem {
+        const transport_ctg::Bus* bus = nullptr;
+        size_t color = 0;
+    };
+    using RouteRange = ranges::Range<std::vector<RouteItem>::const_iterator>;
+    using StopRange = ranges::Range<std::vector<const transport_ctg::Stop*>::const_iterator>;
+
     const RenderSettings render_settings_;
+    const uint64_t settings_fingerprint_;
+    const size_t min_part_size_;
+
+    // слои карты добавляются в документ, стили слоя заводятся в документе один раз
+    void DrawRoutes(RouteRange routes, const ProjectedStops& points, svg::FlatDocument& document) const;
+    void DrawBusLabels(RouteRange routes, const ProjectedStops& points, svg::FlatDocument& document) const;
+    void DrawStopsSymbols(StopRange stops, const ProjectedStops& points, svg::FlatDocument& document) const;
+    void DrawStopLabels(StopRange stops, const ProjectedStops& points, svg::FlatDocument& document) const;
 };
 
 } // namespace renderer
\ No newline at end of file
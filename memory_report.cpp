@@ -0,0 +1,55 @@
+#include "memory_report.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+
+namespace memory {
+
+using namespace std::literals;
+
+void MemoryReport::Add(std::string name, std::size_t bytes) {
+	entries.push_back({ std::move(name), bytes });
+}
+
+std::size_t MemoryReport::GetTotal() const {
+	std::size_t total = 0;
+	for (const auto& entry : entries) {
+		total += entry.bytes;
+	}
+	return total;
+}
+
+void PrintReport(std::string_view title, const MemoryReport& report, std::ostream& out) {
+	std::size_t width = "total"sv.size();
+	for (const auto& entry : report.entries) {
+		width = std::max(width, entry.name.size());
+	}
+	out << title << ":\n"sv;
+	for (const auto& entry : report.entries) {
+		out << "  "sv << std::left << std::setw(static_cast<int>(width)) << entry.name
+			<< std::right << std::setw(14) << entry.bytes << '\n';
+	}
+	out << "  "sv << std::left << std::setw(static_cast<int>(width)) << "total"sv
+		<< std::right << std::setw(14) << report.GetTotal() << '\n';
+}
+
+std::size_t HeapBlock(std::size_t size) {
+	constexpr std::size_t header = sizeof(std::size_t);
+	constexpr std::size_t alignment = 16;
+	constexpr std::size_t min_block = 32;
+	const std::size_t block = (size + header + alignment - 1) / alignment * alignment;
+	return std::max(block, min_block);
+}
+
+std::size_t Bytes(const std::string& str) {
+	return StringBytes(str.capacity());
+}
+
+std::size_t StringBytes(std::size_t length) {
+	// короткие строки хранятся внутри объекта
+	constexpr std::size_t local_capacity = 15;
+	return length > local_capacity ? HeapBlock(length + 1) : 0;
+}
+
+} // namespace memory
\ No newline at end of file
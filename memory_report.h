@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace memory {
+
+// Оценка памяти, занятой структурами данных в куче. Считается по размеру выделенных блоков
+// с учетом накладных расходов аллокатора (модель malloc из glibc на 64-битной платформе:
+// 8 байт заголовка, выравнивание по 16 байтам, блок не меньше 32 байт) и внутреннего
+// устройства контейнеров libstdc++. Память самого объекта контейнера сюда не входит,
+// ее учитывает владелец.
+struct MemoryReport {
+	struct Entry {
+		std::string name;
+		std::size_t bytes = 0;
+	};
+
+	std::vector<Entry> entries;
+
+	void Add(std::string name, std::size_t bytes);
+	std::size_t GetTotal() const;
+};
+
+// выводит отчет таблицей: структура, байты
+void PrintReport(std::string_view title, const MemoryReport& report, std::ostream& out);
+
+// размер блока, который выделит аллокатор под запрос size байт
+std::size_t HeapBlock(std::size_t size);
+
+std::size_t Bytes(const std::string& str);
+// строка из length символов, скопированная в пустую строку (емкость равна длине)
+std::size_t StringBytes(std::size_t length);
+
+// узел красно-черного дерева: цвет и три указателя перед значением
+inline constexpr std::size_t TREE_NODE_HEADER = 32;
+// узел хеш-таблицы: указатель на следующий узел и сохраненный хеш
+inline constexpr std::size_t HASH_NODE_HEADER = 2 * sizeof(void*);
+
+template <typename T>
+std::size_t Bytes(const std::vector<T>& vec) {
+	return vec.capacity() == 0 ? 0 : HeapBlock(vec.capacity() * sizeof(T));
+}
+
+template <typename T>
+std::size_t Bytes(const std::deque<T>& deq) {
+	// элементы лежат в блоках по 512 байт, плюс массив указателей на блоки (не меньше 8)
+	constexpr std::size_t block_size = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+	const std::size_t blocks = deq.size() / block_size + 1;
+	const std::size_t map_size = blocks + 2 < 8 ? 8 : blocks + 2;
+	return blocks * HeapBlock(block_size * sizeof(T)) + HeapBlock(map_size * sizeof(void*));
+}
+
+template <typename Key, typename Compare, typename Alloc>
+std::size_t Bytes(const std::set<Key, Compare, Alloc>& tree) {
+	return tree.size() * HeapBlock(TREE_NODE_HEADER + sizeof(Key));
+}
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+std::size_t Bytes(const std::map<Key, Value, Compare, Alloc>& tree) {
+	return tree.size() * HeapBlock(TREE_NODE_HEADER + sizeof(typename std::map<Key, Value, Compare, Alloc>::value_type));
+}
+
+namespace detail {
+
+template <typename Table>
+std::size_t HashTableBytes(const Table& table) {
+	// единственная корзина хранится внутри объекта таблицы
+	const std::size_t buckets = table.bucket_count() > 1 ? HeapBlock(table.bucket_count() * sizeof(void*)) : 0;
+	return buckets + table.size() * HeapBlock(HASH_NODE_HEADER + sizeof(typename Table::value_type));
+}
+
+} // namespace detail
+
+template <typename Key, typename Hash, typename Equal, typename Alloc>
+std::size_t Bytes(const std::unordered_set<Key, Hash, Equal, Alloc>& table) {
+	return detail::HashTableBytes(table);
+}
+
+template <typename Key, typename Value, typename Hash, typename Equal, typename Alloc>
+std::size_t Bytes(const std::unordered_map<Key, Value, Hash, Equal, Alloc>& table) {
+	return detail::HashTableBytes(table);
+}
+
+// контейнер и память, которой владеют его элементы
+template <typename Container>
+std::size_t DeepBytes(const Container& container) {
+	std::size_t bytes = Bytes(container);
+	for (const auto& item : container) {
+		bytes += Bytes(item);
+	}
+	return bytes;
+}
+
+template <typename Map>
+std::size_t DeepValueBytes(const Map& table) {
+	std::size_t bytes = Bytes(table);
+	for (const auto& [key, value] : table) {
+		bytes += Bytes(value);
+	}
+	return bytes;
+}
+
+} // namespace memory
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <utility>
+
+namespace parallel {
+
+namespace {
+
+// число потоков, заданное SetThreadCount (0 - не задано)
+std::atomic<size_t> thread_count_override = 0;
+
+} // namespace
+
+size_t GetThreadCount() {
+	if (const size_t count = thread_count_override.load(std::memory_order_relaxed); count != 0) {
+		return count;
+	}
+	const unsigned count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : count;
+}
+
+void SetThreadCount(size_t count) {
+	thread_count_override.store(count, std::memory_order_relaxed);
+}
+
+ThreadPool& ThreadPool::GetInstance() {
+	static ThreadPool pool(GetThreadCount() - 1);
+	return pool;
+}
+
+ThreadPool::ThreadPool(size_t worker_count) {
+	workers_.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; ++i) {
+		workers_.emplace_back([this] {
+			Work();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock(mutex_);
+		is_stopped_ = true;
+	}
+	has_tasks_.notify_all();
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+size_t ThreadPool::GetWorkerCount() const {
+	return workers_.size();
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+	{
+		std::lock_guard lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+	has_tasks_.notify_one();
+}
+
+// очередь дорабатывается и после остановки: оставшиеся задачи помощников ничего не делают,
+// но держат общее состояние своих участков
+void ThreadPool::Work() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock lock(mutex_);
+			has_tasks_.wait(lock, [this] {
+				return is_stopped_ || !tasks_.empty();
+			});
+			if (tasks_.empty()) {
+				return;
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+} // namespace parallel
\ No newline at end of file
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// число потоков, между которыми делится работа: по умолчанию - число ядер процессора
+size_t GetThreadCount();
+// Задает число потоков вместо числа ядер (0 - снова по числу ядер), например, чтобы тест
+// проверил деление работы на части на машине с одним ядром. Пул создается при первом
+// обращении с GetThreadCount() - 1 потоками, поэтому число его потоков задается только до этого
+void SetThreadCount(size_t count);
+
+// Общий для процесса пул из GetThreadCount() - 1 потоков: вместе с вызывающим потоком
+// работу выполняют не больше GetThreadCount() потоков, сколько бы параллельных участков
+// ни было вложено друг в друга. Потоки создаются при первом обращении и живут до конца программы
+class ThreadPool {
+public:
+	static ThreadPool& GetInstance();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	size_t GetWorkerCount() const;
+	// ставит задачу в очередь; задача не должна выбрасывать исключений
+	void Post(std::function<void()> task);
+
+private:
+	explicit ThreadPool(size_t worker_count);
+
+	std::mutex mutex_;
+	std::condition_variable has_tasks_;
+	std::deque<std::function<void()>> tasks_;
+	bool is_stopped_ = false;
+	std::vector<std::thread> workers_;
+
+	void Work();
+};
+
+namespace detail {
+
+// Общее состояние параллельного участка. Задачи помощникам ставятся в очередь пула и могут
+// начаться, когда участок уже завершен, поэтому состояние разделяется через shared_ptr,
+// а к функциям участка помощник обращается, только захватив еще не выполненный индекс
+struct Job {
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t count = 0;
+	// следующий незахваченный индекс
+	size_t next = 0;
+	// захваченные, но еще не выполненные индексы
+	size_t in_flight = 0;
+	// помощники ForEachIndexOrdered, поставленные в очередь пула и еще не завершившиеся
+	size_t helpers = 0;
+	std::exception_ptr error;
+
+	// после ошибки оставшиеся индексы не выполняются
+	void Fail(std::exception_ptr exception) {
+		if (!error) {
+			error = std::move(exception);
+		}
+		next = count;
+	}
+};
+
+} // namespace detail
+
+// Выполняет task(i) для всех i из [0, count) в вызывающем потоке и потоках пула.
+// Задачи разбираются потоками по очереди, поэтому порядок их выполнения не определен.
+// Вызывающий поток не ждет помощников, которые еще не начали работу: он сам выполняет
+// оставшиеся задачи, поэтому вложенные вызовы из задач не блокируют пул.
+// Исключение из задачи передается вызывающему
+template <typename Task>
+void ForEachIndex(size_t count, Task task) {
+	if (count == 0) {
+		return;
+	}
+	auto job = std::make_shared<detail::Job>();
+	job->count = count;
+	// выполняет задачи, пока есть незахваченные индексы; вызывается под блокировкой
+	const auto work = [&task](detail::Job& job, std::unique_lock<std::mutex>& lock) {
+		while (job.next < job.count) {
+			const size_t i = job.next++;
+			++job.in_flight;
+			lock.unlock();
+			std::exception_ptr error;
+			try {
+				task(i);
+			} catch (...) {
+				error = std::current_exception();
+			}
+			lock.lock();
+			if (error) {
+				job.Fail(std::move(error));
+			}
+			--job.in_flight;
+			job.changed.notify_all();
+		}
+	};
+
+	auto& pool = ThreadPool::GetInstance();
+	const size_t helper_count = std::min(pool.GetWorkerCount(), count - 1);
+	std::unique_lock lock(job->mutex);
+	for (size_t i = 0; i < helper_count; ++i) {
+		pool.Post([job, &work] {
+			std::unique_lock lock(job->mutex);
+			// work захвачен по ссылке: пока есть незахваченные индексы, участок не завершен
+			if (job->next < job->count) {
+				work(*job, lock);
+			}
+		});
+	}
+	work(*job, lock);
+	job->changed.wait(lock, [&job] {
+		return job->in_flight == 0;
+	});
+	if (job->error) {
+		std::rethrow_exception(job->error);
+	}
+}
+
+// Выполняет produce(i) для всех i из [0, count) параллельно, как ForEachIndex, а consume(i) -
+// в вызывающем потоке строго по порядку, как только готов очередной результат.
+// Одновременно готовятся не больше window результатов, ожидающих consume: следующий индекс
+// захватывается, только когда освобождается место, поэтому общего барьера между порциями нет.
+// Пока очередной результат не готов, вызывающий поток сам выполняет produce
+template <typename Produce, typename Consume>
+void ForEachIndexOrdered(size_t count, size_t window, Produce produce, Consume consume) {
+	if (count == 0) {
+		return;
+	}
+	window = std::max<size_t>(window, 1);
+	auto job = std::make_shared<detail::Job>();
+	job->count = count;
+	// ready[i % window] == i, когда результат i готов
+	std::vector<size_t> ready(window, count);
+	// следующий индекс для consume
+	size_t consumed = 0;
+
+	// выполняет один produce, если есть свободное место; вызывается под блокировкой
+	const auto produce_one = [&produce, &ready, &consumed, window](detail::Job& job, std::unique_lock<std::mutex>& lock) {
+		if (job.next >= job.count || job.next >= consumed + window) {
+			return false;
+		}
+		const size_t i = job.next++;
+		++job.in_flight;
+		lock.unlock();
+		std::exception_ptr error;
+		try {
+			produce(i);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		lock.lock();
+		if (error) {
+			job.Fail(std::move(error));
+		}
+		ready[i % window] = i;
+		--job.in_flight;
+		job.changed.notify_all();
+		return true;
+	};
+
+	auto& pool = ThreadPool::GetInstance();
+	const size_t max_helpers = std::min(pool.GetWorkerCount(), window);
+	std::unique_lock lock(job->mutex);
+	// помощник работает, пока есть свободное место, и завершается, не занимая поток пула ожиданием;
+	// после очередного consume вызывающий поток ставит в очередь недостающих помощников
+	const auto start_helpers = [&] {
+		for (; job->helpers < max_helpers && job->next < job->count && job->next < consumed + window; ++job->helpers) {
+			pool.Post([job, &produce_one] {
+				std::unique_lock lock(job->mutex);
+				// produce_one захвачен по ссылке: пока есть незахваченные индексы, участок не завершен
+				while (job->next < job->count && produce_one(*job, lock)) {
+				}
+				--job->helpers;
+			});
+		}
+	};
+	for (size_t i = 0; i < count; ++i) {
+		start_helpers();
+		while (ready[i % window] != i && !job->error) {
+			if (!produce_one(*job, lock)) {
+				job->changed.wait(lock);
+			}
+		}
+		if (job->error) {
+			break;
+		}
+		lock.unlock();
+		try {
+			consume(i);
+		} catch (...) {
+			lock.lock();
+			job->Fail(std::current_exception());
+			break;
+		}
+		lock.lock();
+		consumed = i + 1;
+	}
+	job->changed.wait(lock, [&job] {
+		return job->in_flight == 0;
+	});
+	if (job->error) {
+		std::rethrow_exception(job->error);
+	}
+}
+
+} // namespace parallel
\ No newline at end of file
@@ -34,11 +34,16 @@
  };
  */
 #include "request_handler.h"
+#include "parallel.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace json {
 namespace request_handler{
@@ -47,178 +52,523 @@ using namespace std::literals;
 
 RequestHandler::RequestHandler(JsonReader& queries, const transport_ctg::Catalogue& catalogue, const renderer::MapRenderer& renderer, const transport_ctg::BusRouter& router, std::ostream& out)
 	: queries_(queries)
-	, catalogue_(catalogue)
+	, own_catalogue_(std::in_place, transport_ctg::CatalogueHandle::NonOwning(catalogue))
+	, catalogue_(*own_catalogue_)
 	, renderer_(renderer)
+	, vector_tiles_(renderer)
 	, router_(router) {
 	PrintInfo(out);
 	//PrintRenderedMap(out);
 	out << std::endl;
 }
 
+RequestHandler::RequestHandler(JsonReader& queries, transport_ctg::CatalogueHandle& catalogue, const renderer::MapRenderer& renderer, const transport_ctg::BusRouter& router, std::ostream& out)
+	: queries_(queries)
+	, catalogue_(catalogue)
+	, renderer_(renderer)
+	, vector_tiles_(renderer)
+	, router_(router) {
+	PrintInfo(out);
+	out << std::endl;
+}
+
+namespace {
+
+// запросы, изменяющие справочник
+bool IsUpdateRequest(std::string_view type) {
+	return type == "UpdateStop"sv || type == "UpdateBus"sv || type == "RemoveStop"sv || type == "RemoveBus"sv;
+}
+
+} // namespace
+
+// Запросы изменения справочника выполняются по одному в порядке следования, поэтому каждый
+// следующий запрос видит все предшествующие изменения. Запросы между ними выводятся PrintAnswers
 void RequestHandler::PrintInfo(std::ostream& out) const {
-	// список результатов для вывода
-	Array result;
+	// ответы выводятся по мере обработки запросов, в порядке их следования
+	ArrayWriter result(out);
 	// список запросов
 	const Array& queries = queries_.GetStatRequest().AsArray();
-
-	result.reserve(queries.size());
-	for (const auto& query : queries) {
-		// query содержит обязательные ключи type, id
-		// тип запроса
-		const auto& type = query.AsMap().at("type").AsString();
-		// предполагаем, что в запросах обязательно еще содержится ключ name, поэтому не проводим проверку на наличие этого ключа
-		if (type == "Stop") {
-			result.push_back(PrintStop(query.AsMap()));
+	size_t begin = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const Dict& query = queries[i].AsMap();
+		if (IsUpdateRequest(query.at("type"s).AsString())) {
+			PrintAnswers(queries, begin, i, result);
+			PrintUpdate(query, result.NextItem());
+			begin = i + 1;
 		}
-		if (type == "Bus") {
-			result.push_back(PrintRoute(query.AsMap()));
+	}
+	PrintAnswers(queries, begin, queries.size(), result);
+	// закрываем массив ответов
+	result.Close();
+}
+
+// В одном потоке ответы выводятся сразу в массив ответов. Иначе запросы делятся на блоки
+// по BLOCK_SIZE, которые потоки общего пула разбирают по очереди, и каждый блок выводит ответы
+// в свой буфер. Буферы выводятся по порядку, как только готов очередной блок, а новый блок
+// берется в работу, как только освобождается буфер, поэтому ответы идут в порядке запросов,
+// а в памяти хранятся ответы не больше чем BLOCKS_PER_THREAD блоков на поток
+void RequestHandler::PrintAnswers(const Array& queries, size_t begin, size_t end, ArrayWriter& result) const {
+	// меньшие блоки не окупают синхронизацию потоков
+	constexpr size_t BLOCK_SIZE = 64;
+	constexpr size_t BLOCKS_PER_THREAD = 4;
+
+	const size_t thread_count = parallel::GetThreadCount();
+	if (thread_count == 1 || end - begin <= BLOCK_SIZE) {
+		for (size_t i = begin; i < end; ++i) {
+			PrintAnswer(queries[i].AsMap(), result.NextItem());
 		}
-		if (type == "Map") {
-			result.push_back(PrintMap(query.AsMap()));
+		return;
+	}
+
+	// ответы блока подряд и концы каждого из них в тексте
+	struct BlockAnswers {
+		std::string text;
+		std::vector<size_t> ends;
+	};
+	const size_t block_count = (end - begin + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	std::vector<BlockAnswers> buffers(std::min(block_count, thread_count * BLOCKS_PER_THREAD));
+	parallel::ForEachIndexOrdered(block_count, buffers.size(), [&](size_t block) {
+		const size_t block_begin = begin + block * BLOCK_SIZE;
+		const size_t block_end = std::min(block_begin + BLOCK_SIZE, end);
+		auto& answers = buffers[block % buffers.size()];
+		answers.ends.clear();
+		std::ostringstream strm;
+		{
+			Writer writer(strm);
+			for (size_t i = block_begin; i < block_end; ++i) {
+				PrintAnswer(queries[i].AsMap(), writer);
+				writer.Flush();
+				answers.ends.push_back(static_cast<size_t>(strm.tellp()));
+			}
 		}
-		if (type == "Route"s) {
-			result.push_back(PrintShortRoute(query.AsMap()));
+		answers.text = std::move(strm).str();
+	}, [&](size_t block) {
+		const auto& answers = buffers[block % buffers.size()];
+		const std::string_view text = answers.text;
+		size_t text_begin = 0;
+		for (const size_t text_end : answers.ends) {
+			result.NextItem().Write(text.substr(text_begin, text_end - text_begin));
+			text_begin = text_end;
 		}
+	});
+}
+
+// query содержит обязательные ключи type, id
+void RequestHandler::PrintAnswer(const Dict& query, Writer& out) const {
+	// тип запроса
+	const auto& type = query.at("type").AsString();
+	// версия справочника не меняется до конца обработки запроса
+	const auto catalogue = catalogue_.Pin();
+	// предполагаем, что в запросах обязательно еще содержится ключ name, поэтому не проводим проверку на наличие этого ключа
+	if (type == "Stop") {
+		PrintStop(query, *catalogue, out);
+	}
+	if (type == "Bus") {
+		PrintRoute(query, *catalogue, out);
+	}
+	if (type == "Map") {
+		PrintMap(query, catalogue, out);
+	}
+	if (type == "BusMap"s) {
+		PrintBusMap(query, catalogue, out);
+	}
+	if (type == "StopsMap"s) {
+		PrintStopsMap(query, catalogue, out);
+	}
+	if (type == "VectorTile"s) {
+		PrintVectorTile(query, catalogue, out);
+	}
+	if (type == "Route"s) {
+		PrintShortRoute(query, catalogue, out);
+	}
+	if (type == "NearestStops"s) {
+		PrintNearestStops(query, *catalogue, out);
+	}
+	if (type == "StopsInRadius"s) {
+		PrintStopsInRadius(query, *catalogue, out);
+	}
+	if (type == "MemoryReport"s) {
+		PrintMemoryReport(query, catalogue, out);
 	}
-	// выводим результат в выходной поток
-	Print(Document(result), out);
 }
 
-const Node RequestHandler::PrintStop(const Dict& query) const {
-	Node result;
+// Ответы записываются сразу в массив ответов через StreamBuilder, без промежуточного
+// дерева Node. Ключи словарей перечисляются в порядке возрастания, как их выводит Dict
+
+void RequestHandler::PrintStop(const Dict& query, const transport_ctg::Catalogue& catalogue, Writer& out) const {
+	StreamBuilder result(out, ArrayWriter::ITEM_INDENT);
 	const auto& stopname = query.at("name"s).AsString();
 	const int id = query.at("id"s).AsInt();
-	const auto& stop_ptr = catalogue_.FindStop(stopname);
+	const auto& stop_ptr = catalogue.FindStop(stopname);
 
 	// проверяем есть ли наличие маршрутов проходящих через эту остановку
 	if (!stop_ptr) {
-		result = Builder{}
+		result
 			.StartDict()
-			.Key("request_id"s).Value(id)
-			.Key("error_message"s).Value("not found"s)
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(id)
 			.EndDict()
 			.Build();
 	} else {
-		Array buses;
-		for (const auto& bus : catalogue_.GetBusesForStop(stopname)) {
-			buses.push_back(static_cast<std::string>(bus));
+		auto buses = result.StartDict().Key("buses"sv).StartArray();
+		for (const auto& bus : catalogue.GetBusesForStop(stopname)) {
+			buses.Value(bus);
 		}
-		result = Builder{}
-			.StartDict()
-			.Key("buses"s).Value(buses)
-			.Key("request_id"s).Value(id)
+		buses
+			.EndArray()
+			.Key("request_id"sv).Value(id)
 			.EndDict()
 			.Build();
 	}
-	return  result;
 }
 
-const Node RequestHandler::PrintRoute(const Dict& query) const {
-	Node result;
+void RequestHandler::PrintRoute(const Dict& query, const transport_ctg::Catalogue& catalogue, Writer& out) const {
+	StreamBuilder result(out, ArrayWriter::ITEM_INDENT);
 	const int id = query.at("id"s).AsInt();
 	const auto& busname = query.at("name"s).AsString();
-	const auto& bus_ptr = catalogue_.FindBus(busname);
+	const auto& bus_ptr = catalogue.FindBus(busname);
 
 	if (!bus_ptr) {
-		result = Builder{}
+		result
 			.StartDict()
-			.Key("request_id"s).Value(id)
-			.Key("error_message"s).Value("not found"s)
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(id)
 			.EndDict()
 			.Build();
 	} else {
-		const auto& bus_info = catalogue_.GetBusInfo(busname);
-		result = Builder{}
+		const auto& bus_info = catalogue.GetBusInfo(busname);
+		result
 			.StartDict()
-			.Key("request_id"s).Value(id)
-			.Key("curvature"s).Value(bus_info.route_length / bus_info.coordinate_length)
-			.Key("route_length"s).Value(bus_info.route_length)
-			.Key("stop_count"s).Value(bus_info.stops_on_route)
-			.Key("unique_stop_count"s).Value(bus_info.unique_stops)
+			.Key("curvature"sv).Value(bus_info.route_length / bus_info.coordinate_length)
+			.Key("request_id"sv).Value(id)
+			.Key("route_length"sv).Value(bus_info.route_length)
+			.Key("stop_count"sv).Value(bus_info.stops_on_route)
+			.Key("unique_stop_count"sv).Value(bus_info.unique_stops)
 			.EndDict()
 			.Build();
 	}
-	return result;
 }
 
-void RequestHandler::PrintRenderedMap(std::ostream& out) const {
-	const auto& sorted_buses = catalogue_.GetSortedBuses();
-	const svg::Document& document = renderer_.GetRenderedMap(sorted_buses);
+void RequestHandler::PrintRenderedMap(std::ostream& out, const transport_ctg::Catalogue& catalogue) const {
+	const auto& sorted_buses = catalogue.GetSortedBuses();
+	const svg::LayeredDocument document = renderer_.GetRenderedMap(sorted_buses);
 	document.Render(out);
 }
 
-const Node RequestHandler::PrintMap(const Dict& query) const {
-	Node result;
-	std::ostringstream strm(""s);
-	PrintRenderedMap(strm);
+std::shared_ptr<const std::string> RequestHandler::GetRenderedMap(const CatalogueVersion& catalogue) const {
+	const uint64_t fingerprint = renderer_.GetSettingsFingerprint();
+	// карта отрисовывается под мьютексом: одновременные запросы Map дождутся одной отрисовки
+	std::lock_guard guard(rendered_map_mutex_);
+	if (!rendered_map_ || rendered_map_->catalogue != catalogue || rendered_map_->settings_fingerprint != fingerprint) {
+		// изображение экранируется по частям по мере вывода, сразу в итоговую строку
+		std::string json = "\""s;
+		renderer_.GetRenderedMap(catalogue->GetSortedBuses()).Render([&json](std::string_view chunk) {
+			AppendEscapedChars(json, chunk);
+		});
+		json.push_back('"');
+		rendered_map_ = std::make_shared<const RenderedMap>(RenderedMap{ catalogue, fingerprint, std::move(json) });
+	}
+	return { rendered_map_, &rendered_map_->json };
+}
+
+std::shared_ptr<const renderer::MapScene> RequestHandler::GetMapScene(const CatalogueVersion& catalogue) const {
+	const uint64_t fingerprint = renderer_.GetSettingsFingerprint();
+	std::lock_guard guard(map_scene_mutex_);
+	if (!map_scene_ || map_scene_->catalogue != catalogue || map_scene_->settings_fingerprint != fingerprint) {
+		map_scene_.reset();
+		map_scene_ = std::make_shared<const CachedScene>(CachedScene{ catalogue, fingerprint, renderer_.MakeScene(catalogue->GetSortedBuses()) });
+	}
+	return { map_scene_, &map_scene_->scene };
+}
+
+// Маршрутизатор строится заново (с вычислением всех кратчайших путей), только когда маршрут
+// запрошен по версии, опубликованной после запуска. Запросы, дождавшиеся построения под мьютексом,
+// получают готовый маршрутизатор
+std::shared_ptr<const transport_ctg::BusRouter> RequestHandler::GetRouter(const CatalogueVersion& catalogue) const {
+	if (router_.IsBuiltFor(*catalogue)) {
+		// router_ принадлежит вызывающему коду, указатель на него ничем не владеет
+		return { std::shared_ptr<const transport_ctg::BusRouter>(), &router_ };
+	}
+	std::lock_guard guard(router_mutex_);
+	if (!version_router_ || !version_router_->IsBuiltFor(*catalogue)) {
+		version_router_.reset();
+		version_router_ = std::make_shared<const transport_ctg::BusRouter>(router_.GetSettings(), catalogue);
+	}
+	return version_router_;
+}
+
+// viewport задается географическими координатами углов, tile - номером фрагмента
+// при делении карты на 2^z x 2^z равных частей
+std::optional<renderer::Viewport> RequestHandler::GetQueryViewport(const Dict& query, const renderer::MapScene& scene) const {
+	if (const auto it = query.find("tile"s); it != query.end()) {
+		const auto& tile = it->second.AsMap();
+		return renderer_.GetTileViewport(tile.at("z"s).AsInt(), tile.at("x"s).AsInt(), tile.at("y"s).AsInt());
+	}
+	const auto& viewport = query.at("viewport"s).AsMap();
+	const svg::Point first = scene.GetProjector()({ viewport.at("min_lat"s).AsDouble(), viewport.at("min_lng"s).AsDouble() });
+	const svg::Point second = scene.GetProjector()({ viewport.at("max_lat"s).AsDouble(), viewport.at("max_lng"s).AsDouble() });
+	// на изображении широта растет вниз, поэтому углы упорядочиваются заново
+	const renderer::Viewport result{ { std::min(first.x, second.x), std::min(first.y, second.y) },
+		{ std::max(first.x, second.x), std::max(first.y, second.y) } };
+	if (!(result.min.x < result.max.x && result.min.y < result.max.y)) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+void RequestHandler::PrintMap(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
 	const int id = query.at("id"s).AsInt();
 
-	result = Builder{}
+	// фрагмент карты отрисовывается заново, без кэширования
+	if (query.count("viewport"s) || query.count("tile"s)) {
+		const auto scene = GetMapScene(catalogue);
+		const auto viewport = GetQueryViewport(query, *scene);
+		if (!viewport) {
+			StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+				.StartDict()
+				.Key("error_message"sv).Value("invalid viewport"sv)
+				.Key("request_id"sv).Value(id)
+				.EndDict()
+				.Build();
+			return;
+		}
+		PrintMapDocument(id, renderer_.GetRenderedMap(*scene, *viewport), out);
+		return;
+	}
+
+	StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
 		.StartDict()
-		.Key("map"s).Value(strm.str())
-		.Key("request_id"s).Value(id)
+		.Key("map"sv).Value(RawJson{ *GetRenderedMap(catalogue) })
+		.Key("request_id"sv).Value(id)
 		.EndDict()
 		.Build();
-	return result;
 }
 
-const Node RequestHandler::PrintShortRoute(const Dict& query) const {
-	Node result;
+// изображение выводится в буфер ответа по частям, экранируясь на лету
+void RequestHandler::PrintMapDocument(int id, const svg::FlatDocument& document, Writer& out) const {
+	const StringProducer map{ [&document](Writer& writer) {
+		document.Render([&writer](std::string_view chunk) {
+			writer.WriteEscapedChars(chunk);
+		});
+	} };
+	StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+		.StartDict()
+		.Key("map"sv).Value(map)
+		.Key("request_id"sv).Value(id)
+		.EndDict()
+		.Build();
+}
+
+// маршрут без остановок на карту не попадает и считается ненайденным
+void RequestHandler::PrintBusMap(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const auto scene = GetMapScene(catalogue);
+	const auto route = scene->FindRoute(query.at("name"s).AsString());
+	if (!route) {
+		StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+			.StartDict()
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(id)
+			.EndDict()
+			.Build();
+		return;
+	}
+	std::vector<uint32_t> stops = scene->GetRoutes()[*route].stops;
+	std::sort(stops.begin(), stops.end());
+	stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+	PrintMapDocument(id, renderer_.GetRenderedMap(*scene, { *route }, stops), out);
+}
+
+// остановки, через которые не проходит ни один маршрут, на карте не выводятся и пропускаются
+void RequestHandler::PrintStopsMap(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const auto scene = GetMapScene(catalogue);
+	std::vector<uint32_t> stops;
+	std::vector<uint32_t> routes;
+	for (const auto& name : query.at("stops"s).AsArray()) {
+		const auto stop = scene->FindStop(name.AsString());
+		if (!stop) {
+			continue;
+		}
+		stops.push_back(*stop);
+		const auto stop_routes = scene->GetStopRoutes(*stop);
+		routes.insert(routes.end(), stop_routes.begin(), stop_routes.end());
+	}
+	std::sort(stops.begin(), stops.end());
+	stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+	std::sort(routes.begin(), routes.end());
+	routes.erase(std::unique(routes.begin(), routes.end()), routes.end());
+	PrintMapDocument(id, renderer_.GetRenderedMap(*scene, routes, stops), out);
+}
+
+void RequestHandler::PrintVectorTile(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const auto tile = vector_tiles_.GetTile(*GetMapScene(catalogue), query.at("z"s).AsInt(), query.at("x"s).AsInt(), query.at("y"s).AsInt());
+	if (!tile) {
+		StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+			.StartDict()
+			.Key("error_message"sv).Value("invalid tile"sv)
+			.Key("request_id"sv).Value(id)
+			.EndDict()
+			.Build();
+		return;
+	}
+	StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+		.StartDict()
+		.Key("request_id"sv).Value(id)
+		.Key("tile"sv).Value(vector_tile::EncodeBase64(*tile))
+		.EndDict()
+		.Build();
+}
+
+void RequestHandler::PrintShortRoute(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
+	StreamBuilder result(out, ArrayWriter::ITEM_INDENT);
 	const int id = query.at("id"s).AsInt();
 	const auto& from = query.at("from"s).AsString();
 	const auto& to = query.at("to"s).AsString();
-	const auto& stop_from = catalogue_.FindStop(from);
-	const auto& stop_to = catalogue_.FindStop(to);
+	const auto& stop_from = catalogue->FindStop(from);
+	const auto& stop_to = catalogue->FindStop(to);
+	const auto bus_router = GetRouter(catalogue);
 
-	const auto& router = router_.FindRoute(stop_from, stop_to);
+	const auto& router = bus_router->FindRoute(stop_from, stop_to);
 	
 	if (!router) {
-		result = json::Builder{}
+		result
 			.StartDict()
-			.Key("request_id"s).Value(id)
-			.Key("error_message"s).Value("not found"s)
+			.Key("error_message"sv).Value("not found"sv)
+			.Key("request_id"sv).Value(id)
 			.EndDict()
 			.Build();
 	} else {
-		json::Array items;
 		double total_time = 0.0;
 
-		items.reserve(router.value().edges.size());
+		auto items = result.StartDict().Key("items"sv).StartArray();
 		for (auto& edge_id : router.value().edges) {
-			const graph::Edge<double> edge = router_.GetGraph().GetEdge(edge_id);
+			const graph::Edge<double>& edge = bus_router->GetGraph().GetEdge(edge_id);
 			if (edge.quality == 0) {
-				items.emplace_back(json::Builder{}
+				items
 					.StartDict()
-					.Key("stop_name"s).Value(edge.name)
-					.Key("time"s).Value(edge.weight)
-					.Key("type"s).Value("Wait"s)
-					.EndDict()
-					.Build());
+					.Key("stop_name"sv).Value(edge.name)
+					.Key("time"sv).Value(edge.weight)
+					.Key("type"sv).Value("Wait"sv)
+					.EndDict();
 
 				total_time += edge.weight;
 			} else {
-				items.emplace_back(json::Builder{}
-				.StartDict()
-					.Key("bus"s).Value(edge.name)
-					.Key("span_count"s).Value(static_cast<int>(edge.quality))
-					.Key("time"s).Value(edge.weight)
-					.Key("type"s).Value("Bus"s)
-					.EndDict()
-					.Build()
-				);
+				items
+					.StartDict()
+					.Key("bus"sv).Value(edge.name)
+					.Key("span_count"sv).Value(static_cast<int>(edge.quality))
+					.Key("time"sv).Value(edge.weight)
+					.Key("type"sv).Value("Bus"sv)
+					.EndDict();
 
 				total_time += edge.weight;
 			}
 		}
-		result = json::Builder{}
+		items
+			.EndArray()
+			.Key("request_id"sv).Value(id)
+			.Key("total_time"sv).Value(total_time)
+			.EndDict()
+			.Build();
+	}
+}
+
+namespace {
+// список остановок с расстояниями до точки запроса
+void PrintStopsDistance(Writer& out, int id, const std::vector<transport_ctg::StopDistance>& stops) {
+	StreamBuilder result(out, ArrayWriter::ITEM_INDENT);
+	auto items = result
+		.StartDict()
+		.Key("request_id"sv).Value(id)
+		.Key("stops"sv).StartArray();
+	for (const auto& [stop_ptr, distance] : stops) {
+		items
 			.StartDict()
-			.Key("request_id"s).Value(id)
-			.Key("total_time"s).Value(total_time)
-			.Key("items"s).Value(items)
+			.Key("distance"sv).Value(distance)
+			.Key("name"sv).Value(stop_ptr->name)
+			.EndDict();
+	}
+	items
+		.EndArray()
+		.EndDict()
+		.Build();
+}
+
+// количество байт не помещается в int на больших справочниках
+Node MakeBytesNode(size_t bytes) {
+	if (bytes <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+		return Node(static_cast<int>(bytes));
+	}
+	return Node(static_cast<double>(bytes));
+}
+
+Dict MakeMemoryReportDict(const memory::MemoryReport& report) {
+	Dict items;
+	for (const auto& [name, bytes] : report.entries) {
+		items.emplace(name, MakeBytesNode(bytes));
+	}
+	items.emplace("total"s, MakeBytesNode(report.GetTotal()));
+	return items;
+}
+} // namespace
+
+void RequestHandler::PrintNearestStops(const Dict& query, const transport_ctg::Catalogue& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const geo::Coordinates point{ query.at("latitude"s).AsDouble(), query.at("longitude"s).AsDouble() };
+	const int count = query.at("count"s).AsInt();
+
+	PrintStopsDistance(out, id, catalogue.GetNearestStops(point, static_cast<size_t>(std::max(count, 0))));
+}
+
+void RequestHandler::PrintStopsInRadius(const Dict& query, const transport_ctg::Catalogue& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const geo::Coordinates point{ query.at("latitude"s).AsDouble(), query.at("longitude"s).AsDouble() };
+	const double radius = query.at("radius"s).AsDouble();
+
+	PrintStopsDistance(out, id, catalogue.GetStopsInRadius(point, radius));
+}
+
+// изменение применяется к копии текущей версии, и при ошибке новая версия не публикуется
+void RequestHandler::PrintUpdate(const Dict& query, Writer& out) const {
+	StreamBuilder result(out, ArrayWriter::ITEM_INDENT);
+	const int id = query.at("id"s).AsInt();
+	try {
+		catalogue_.Update([this, &query](transport_ctg::Catalogue& catalogue) {
+			queries_.ApplyUpdateRequest(query, catalogue);
+		});
+	} catch (const std::invalid_argument& e) {
+		result
+			.StartDict()
+			.Key("error_message"sv).Value(std::string_view(e.what()))
+			.Key("request_id"sv).Value(id)
 			.EndDict()
 			.Build();
+		return;
 	}
-	return result;
+	result
+		.StartDict()
+		.Key("request_id"sv).Value(id)
+		.EndDict()
+		.Build();
+}
+
+void RequestHandler::PrintMemoryReport(const Dict& query, const CatalogueVersion& catalogue, Writer& out) const {
+	const int id = query.at("id"s).AsInt();
+	const auto catalogue_report = catalogue->GetMemoryReport();
+	const auto router_report = GetRouter(catalogue)->GetMemoryReport();
+	const auto renderer_report = renderer_.GetMemoryReport();
+
+	StreamBuilder{ out, ArrayWriter::ITEM_INDENT }
+		.StartDict()
+		.Key("catalogue"sv).Value(MakeMemoryReportDict(catalogue_report))
+		.Key("renderer"sv).Value(MakeMemoryReportDict(renderer_report))
+		.Key("request_id"sv).Value(id)
+		.Key("router"sv).Value(MakeMemoryReportDict(router_report))
+		.Key("total_bytes"sv).Value(MakeBytesNode(catalogue_report.GetTotal() + router_report.GetTotal() + renderer_report.GetTotal()))
+		.EndDict()
+		.Build();
 }
 
 } // namesapce request_handler
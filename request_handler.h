@@ -38,8 +38,14 @@
 #include "json_builder.h"
 #include "json_reader.h"
 #include "transport_catalogue.h"
+#include "vector_tile.h"
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 
 namespace json {
 namespace request_handler {
@@ -49,26 +55,91 @@ public:
 	//explicit RequestHandler(JsonReader& queries, const transport_ctg::Catalogue& catalogue, std::ostream& out);
 	
 	explicit RequestHandler(JsonReader& queries, const transport_ctg::Catalogue& catalogue, const renderer::MapRenderer& renderer, const transport_ctg::BusRouter& router, std::ostream& out);
+	// каждый запрос обрабатывается на версии справочника, закрепленной в момент его начала,
+	// запросы изменения справочника публикуют через catalogue новые версии
+	explicit RequestHandler(JsonReader& queries, transport_ctg::CatalogueHandle& catalogue, const renderer::MapRenderer& renderer, const transport_ctg::BusRouter& router, std::ostream& out);
 
 private:
+	using CatalogueVersion = transport_ctg::CatalogueHandle::Version;
+
 	const JsonReader& queries_;
-	const transport_ctg::Catalogue& catalogue_;
+	// используется, если справочник передан напрямую, без версионного доступа
+	std::optional<transport_ctg::CatalogueHandle> own_catalogue_;
+	transport_ctg::CatalogueHandle& catalogue_;
 	const renderer::MapRenderer& renderer_;
+	const renderer::VectorTileRenderer vector_tiles_;
+	// маршрутизатор, построенный по версии справочника на момент запуска
 	const transport_ctg::BusRouter& router_;
+	// маршрутизатор последней версии, для которой понадобился маршрут, если это не версия router_
+	mutable std::shared_ptr<const transport_ctg::BusRouter> version_router_;
+	mutable std::mutex router_mutex_;
+
+	// отрисованная карта в виде готовой строки JSON и ключ, для которого она построена:
+	// пока не изменились справочник и настройки визуализации, запросы Map выводят ее как есть.
+	// Запись удерживает свою версию справочника, поэтому она не может совпасть с другой версией
+	struct RenderedMap {
+		CatalogueVersion catalogue;
+		uint64_t settings_fingerprint = 0;
+		std::string json;
+	};
+	mutable std::shared_ptr<const RenderedMap> rendered_map_;
+
+	// сцена карты с пространственным индексом для запросов фрагментов, тот же ключ, что у RenderedMap
+	struct CachedScene {
+		CatalogueVersion catalogue;
+		uint64_t settings_fingerprint = 0;
+		renderer::MapScene scene;
+	};
+	mutable std::shared_ptr<const CachedScene> map_scene_;
+	// Запросы выполняются параллельно, поэтому кэши заменяются под мьютексом, а наружу
+	// отдаются указатели на записи: запрос дорабатывает со своей записью, даже если ее уже заменили
+	mutable std::mutex rendered_map_mutex_;
+	mutable std::mutex map_scene_mutex_;
 
 	// хранит ссылку на выходной поток и выводит ответы по запросам
 	void PrintInfo(std::ostream& out) const;
-	// хранит ссылку на словарь и возвращает информацию для вывода остановки
-	const Node PrintStop(const Dict& queryAsMap) const;
-	// хранит ссылку на словарь и возвращает информацию для вывода маршрута
-	const Node PrintRoute(const Dict& queryAsMap) const;
+	// выводит ответы на запросы [begin, end), среди которых нет запросов изменения справочника
+	void PrintAnswers(const Array& queries, size_t begin, size_t end, ArrayWriter& result) const;
+	// выводит ответ на один запрос, начатый как очередной элемент массива ответов
+	void PrintAnswer(const Dict& query, Writer& out) const;
+	// ответы выводятся в буфер out, начатый как очередной элемент массива ответов
+	// хранит ссылку на словарь и выводит информацию об остановке
+	void PrintStop(const Dict& queryAsMap, const transport_ctg::Catalogue& catalogue, Writer& out) const;
+	// хранит ссылку на словарь и выводит информацию о маршруте
+	void PrintRoute(const Dict& queryAsMap, const transport_ctg::Catalogue& catalogue, Writer& out) const;
+
+	void PrintMap(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
+	// карта одного маршрута с его остановками (запрос BusMap)
+	void PrintBusMap(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
+	// карта остановок из списка и проходящих через них маршрутов (запрос StopsMap)
+	void PrintStopsMap(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
+	// векторный тайл карты z/x/y в кодировке base64 (запрос VectorTile)
+	void PrintVectorTile(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
 
-	const Node PrintMap(const Dict& queryAsMap) const;
+	void PrintShortRoute(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
 
-	const Node PrintShortRoute(const Dict& queryAsMap) const;
+	// ближайшие к точке остановки (запрос NearestStops)
+	void PrintNearestStops(const Dict& queryAsMap, const transport_ctg::Catalogue& catalogue, Writer& out) const;
+	// остановки в радиусе от точки (запрос StopsInRadius)
+	void PrintStopsInRadius(const Dict& queryAsMap, const transport_ctg::Catalogue& catalogue, Writer& out) const;
+	// изменение справочника (запросы UpdateStop, UpdateBus, RemoveStop, RemoveBus),
+	// после которого последующие запросы видят новую версию
+	void PrintUpdate(const Dict& queryAsMap, Writer& out) const;
+	// оценка памяти справочника, маршрутизатора и визуализатора (запрос MemoryReport)
+	void PrintMemoryReport(const Dict& queryAsMap, const CatalogueVersion& catalogue, Writer& out) const;
 
 	// выводит SVG-изображение карты
-	void PrintRenderedMap(std::ostream& out) const;
+	void PrintRenderedMap(std::ostream& out, const transport_ctg::Catalogue& catalogue) const;
+	// возвращает карту, экранированную для вывода в JSON, при необходимости отрисовывая ее заново
+	std::shared_ptr<const std::string> GetRenderedMap(const CatalogueVersion& catalogue) const;
+	// выводит ответ с изображением, отрисованным по запросу
+	void PrintMapDocument(int id, const svg::FlatDocument& document, Writer& out) const;
+	// возвращает сцену карты, при необходимости строя ее заново
+	std::shared_ptr<const renderer::MapScene> GetMapScene(const CatalogueVersion& catalogue) const;
+	// маршрутизатор, построенный по этой версии справочника, при необходимости строит его заново
+	std::shared_ptr<const transport_ctg::BusRouter> GetRouter(const CatalogueVersion& catalogue) const;
+	// область фрагмента карты из запроса Map с полем viewport или tile
+	std::optional<renderer::Viewport> GetQueryViewport(const Dict& query, const renderer::MapScene& scene) const;
 
 };
 
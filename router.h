@@ -29,6 +29,9 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // память, занятая таблицей кратчайших маршрутов
+    size_t GetMemoryUsage() const;
+
 private:
     struct RouteInternalData {
         Weight weight;
@@ -94,6 +97,11 @@ Router<Weight>::Router(const Graph& graph)
     }
 }
 
+template <typename Weight>
+size_t Router<Weight>::GetMemoryUsage() const {
+    return memory::DeepBytes(routes_internal_data_);
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
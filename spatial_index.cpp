@@ -0,0 +1,413 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace transport_ctg {
+
+namespace {
+// длина одного градуса дуги большого круга в метрах
+const double METERS_PER_DEGREE = geo::EARTH_RADIUS * M_PI / 180.;
+
+// минимальный размер ячейки в градусах (~1 м)
+const double MIN_CELL_SIZE = 1e-5;
+
+// квадрат хорды единичной сферы, стягивающей дугу длиной distance метров
+double GetChord2(double distance) {
+	const double angle = std::min(distance / geo::EARTH_RADIUS, M_PI);
+	const double half_chord = std::sin(angle / 2.);
+	return 4. * half_chord * half_chord;
+}
+
+// Квадрат хорды между точками с широтами не дальше max_lat от экватора и разностью долгот
+// lng_delta градусов не меньше 4 cos^2(max_lat) sin^2(lng_delta / 2): вклад разности широт неотрицателен
+double GetMinLngChord2(double lng_delta, double max_lat) {
+	const double lat_factor = std::max(0., std::cos(std::min(std::abs(max_lat), 90.) * M_PI / 180.));
+	const double half_sin = std::sin(std::min(lng_delta, 180.) * M_PI / 360.);
+	return 4. * lat_factor * lat_factor * half_sin * half_sin;
+}
+
+// наибольшая разность долгот в градусах у точек не дальше max_lat от экватора на расстоянии
+// не больше distance метров (обращение GetMinLngChord2), 360 - любая
+double GetMaxLngDelta(double distance, double max_lat) {
+	const double lat_factor = std::cos(std::min(std::abs(max_lat), 90.) * M_PI / 180.);
+	const double half_chord = std::sin(std::min(distance / geo::EARTH_RADIUS, M_PI) / 2.);
+	if (lat_factor <= half_chord) {
+		return 360.;
+	}
+	return 2. * std::asin(half_chord / lat_factor) * 180. / M_PI;
+}
+
+// ближайшие остановки идут первыми, при равенстве расстояний - по алфавиту
+bool IsCloser(const StopDistance& lhs, const StopDistance& rhs) {
+	if (lhs.distance != rhs.distance) {
+		return lhs.distance < rhs.distance;
+	}
+	return lhs.stop_ptr->name < rhs.stop_ptr->name;
+}
+
+// Середина наибольшего промежутка между долготами остановок по кругу. Если сеть
+// занимает не больше полукруга, промежуток - дополнение к [min, max] и сортировка не нужна
+double FindLngOrigin(const std::vector<const Stop*>& stops) {
+	const auto [min_lng, max_lng] = std::minmax_element(stops.begin(), stops.end(),
+		[](const Stop* lhs, const Stop* rhs) { return lhs->coordinates.lng < rhs->coordinates.lng; });
+	double gap_start = (*max_lng)->coordinates.lng;
+	double gap = 360. - (gap_start - (*min_lng)->coordinates.lng);
+	if (gap < 180.) {
+		std::vector<double> lngs;
+		lngs.reserve(stops.size());
+		for (const Stop* stop : stops) {
+			lngs.push_back(stop->coordinates.lng);
+		}
+		std::sort(lngs.begin(), lngs.end());
+		for (std::size_t i = 1; i < lngs.size(); ++i) {
+			if (lngs[i] - lngs[i - 1] > gap) {
+				gap_start = lngs[i - 1];
+				gap = lngs[i] - lngs[i - 1];
+			}
+		}
+	}
+	return gap_start + gap / 2.;
+}
+
+// значения values с номерами k и size - 1 - k по возрастанию
+std::pair<double, double> GetCentralRange(std::vector<double>& values, std::size_t k) {
+	std::nth_element(values.begin(), values.begin() + k, values.end());
+	const double low = values[k];
+	std::nth_element(values.begin(), values.end() - 1 - k, values.end());
+	return { low, values[values.size() - 1 - k] };
+}
+} // namespace
+
+double StopsSpatialIndex::NormalizeLng(double lng) const {
+	double result = std::fmod(lng - lng_origin_, 360.);
+	if (result < 0.) {
+		result += 360.;
+	}
+	return result < 360. ? result : 0.;
+}
+
+int32_t StopsSpatialIndex::GetColumn(double normalized_lng) const {
+	return std::clamp(static_cast<int32_t>(std::floor(normalized_lng / lng_cell_size_)), 0, columns_per_turn_ - 1);
+}
+
+StopsSpatialIndex::Cell StopsSpatialIndex::GetCell(geo::Coordinates point) const {
+	return {
+		static_cast<int32_t>(std::floor(point.lat / cell_size_)),
+		GetColumn(NormalizeLng(point.lng))
+	};
+}
+
+bool StopsSpatialIndex::IsInside(Cell cell) const {
+	return !offsets_.empty()
+		&& cell.lat >= min_cell_.lat && cell.lat <= max_cell_.lat
+		&& cell.lng >= min_cell_.lng && cell.lng <= max_cell_.lng;
+}
+
+std::size_t StopsSpatialIndex::GetIndex(Cell cell) const {
+	const std::size_t columns = static_cast<std::size_t>(max_cell_.lng - min_cell_.lng) + 1;
+	return static_cast<std::size_t>(cell.lat - min_cell_.lat) * columns + static_cast<std::size_t>(cell.lng - min_cell_.lng);
+}
+
+StopsSpatialIndex::Entry StopsSpatialIndex::MakeEntry(const Stop* stop_ptr, geo::Coordinates point) {
+	const double lat = point.lat * M_PI / 180.;
+	const double lng = point.lng * M_PI / 180.;
+	return { stop_ptr, std::cos(lat) * std::cos(lng), std::cos(lat) * std::sin(lng), std::sin(lat) };
+}
+
+void StopsSpatialIndex::Reserve(std::size_t stop_count) {
+	stops_.reserve(stop_count);
+}
+
+void StopsSpatialIndex::Add(const Stop* stop) {
+	stops_.push_back(stop);
+	const Cell cell = GetCell(stop->coordinates);
+	const bool is_inside = IsInside(cell);
+	if ((!is_inside && outliers_.empty()) || pending_count_ >= std::max<std::size_t>(64, entries_.size() / 8)) {
+		Build();
+		return;
+	}
+	++pending_count_;
+	if (!is_inside) {
+		outliers_.front().Add(stop);
+		return;
+	}
+	if (pending_.empty()) {
+		pending_.resize(offsets_.size() - 1);
+	}
+	pending_[GetIndex(cell)].push_back(MakeEntry(stop, stop->coordinates));
+}
+
+void StopsSpatialIndex::Add(const std::vector<const Stop*>& stops) {
+	stops_.insert(stops_.end(), stops.begin(), stops.end());
+	Build();
+}
+
+void StopsSpatialIndex::BuildBounds() {
+	lng_origin_ = FindLngOrigin(stops_);
+	std::vector<double> lats;
+	std::vector<double> lngs;
+	lats.reserve(stops_.size());
+	lngs.reserve(stops_.size());
+	for (const Stop* stop : stops_) {
+		lats.push_back(stop->coordinates.lat);
+		lngs.push_back(NormalizeLng(stop->coordinates.lng));
+	}
+	const std::size_t k = stops_.size() / OUTLIER_QUANTILE;
+	const auto [min_lat, max_lat] = GetCentralRange(lats, k);
+	const auto [min_lng, max_lng] = GetCentralRange(lngs, k);
+	const double lat_extent = max_lat - min_lat;
+	const double lng_extent = max_lng - min_lng;
+
+	// градус долготы на широте середины сети короче градуса широты в lng_scale раз;
+	// у полюса ячейка по долготе ограничена полным кругом
+	const double lng_scale = std::cos(std::clamp((min_lat + max_lat) / 2., -90., 90.) * M_PI / 180.);
+	// площадная оценка для остановок, распределенных по области, и линейная - для вытянутых вдоль линии
+	const double cells_count = std::max(static_cast<double>(stops_.size()) / STOPS_PER_CELL, 1.);
+	const double scaled_lng_extent = lng_extent * lng_scale;
+	cell_size_ = std::max({ std::sqrt(lat_extent * scaled_lng_extent / cells_count),
+		std::max(lat_extent, scaled_lng_extent) / cells_count, MIN_CELL_SIZE });
+	columns_per_turn_ = static_cast<int32_t>(std::clamp(std::floor(360. * lng_scale / cell_size_), 1., 360. / MIN_CELL_SIZE));
+	lng_cell_size_ = 360. / columns_per_turn_;
+
+	// запас по краям, чтобы остановки рядом с текущими границами не вызывали перестройку
+	const double lat_margin = lat_extent / 4.;
+	const double lng_margin = lng_extent / 4.;
+	min_cell_ = { static_cast<int32_t>(std::floor((min_lat - lat_margin) / cell_size_)), GetColumn(min_lng - lng_margin) };
+	max_cell_ = { static_cast<int32_t>(std::floor((max_lat + lat_margin) / cell_size_)), GetColumn(max_lng + lng_margin) };
+}
+
+void StopsSpatialIndex::Build() {
+	pending_.clear();
+	pending_count_ = 0;
+	outliers_.clear();
+	if (stops_.empty()) {
+		entries_.clear();
+		offsets_.clear();
+		return;
+	}
+	BuildBounds();
+
+	// сортировка подсчетом по номеру ячейки, остановки за границами сетки откладываются
+	constexpr std::size_t OUTSIDE = std::numeric_limits<std::size_t>::max();
+	std::vector<std::size_t> stop_cells;
+	stop_cells.reserve(stops_.size());
+	std::vector<const Stop*> outliers;
+	offsets_.assign(GetIndex(max_cell_) + 2, 0);
+	for (const Stop* stop : stops_) {
+		const Cell cell = GetCell(stop->coordinates);
+		if (!IsInside(cell)) {
+			stop_cells.push_back(OUTSIDE);
+			outliers.push_back(stop);
+			continue;
+		}
+		stop_cells.push_back(GetIndex(cell));
+		++offsets_[stop_cells.back() + 1];
+	}
+	for (std::size_t i = 1; i < offsets_.size(); ++i) {
+		offsets_[i] += offsets_[i - 1];
+	}
+	entries_.resize(offsets_.back());
+	std::vector<uint32_t> positions(offsets_.begin(), offsets_.end() - 1);
+	for (std::size_t i = 0; i < stops_.size(); ++i) {
+		if (stop_cells[i] != OUTSIDE) {
+			entries_[positions[stop_cells[i]]++] = MakeEntry(stops_[i], stops_[i]->coordinates);
+		}
+	}
+	// центральная часть содержит не меньше (1 - 4 / OUTLIER_QUANTILE) остановок, поэтому вложенные сетки
+	// уменьшаются, а для сети меньше OUTLIER_QUANTILE остановок вложенной сетки нет
+	if (!outliers.empty()) {
+		outliers_.emplace_back().Add(outliers);
+	}
+}
+
+std::size_t StopsSpatialIndex::GetStopCount() const {
+	return stops_.size();
+}
+
+std::size_t StopsSpatialIndex::GetMemoryUsage() const {
+	std::size_t result = memory::Bytes(stops_) + memory::Bytes(entries_) + memory::Bytes(offsets_) + memory::DeepBytes(pending_)
+		+ memory::Bytes(outliers_);
+	for (const auto& outliers : outliers_) {
+		result += outliers.GetMemoryUsage();
+	}
+	return result;
+}
+
+void StopsSpatialIndex::CollectRow(int32_t lat, int32_t lng_from, int32_t lng_to, const Entry& point, double max_chord2, std::vector<Candidate>& result) const {
+	if (offsets_.empty() || lat < min_cell_.lat || lat > max_cell_.lat) {
+		return;
+	}
+	if (static_cast<int64_t>(lng_to) - lng_from + 1 >= columns_per_turn_) {
+		CollectCells(lat, min_cell_.lng, max_cell_.lng, point, max_chord2, result);
+		return;
+	}
+	// окно уже круга, поэтому его сдвиги на круг не пересекаются
+	for (const int32_t shift : { -columns_per_turn_, 0, columns_per_turn_ }) {
+		CollectCells(lat, std::max(lng_from + shift, min_cell_.lng), std::min(lng_to + shift, max_cell_.lng), point, max_chord2, result);
+	}
+}
+
+void StopsSpatialIndex::CollectCells(int32_t lat, int32_t lng_from, int32_t lng_to, const Entry& point, double max_chord2, std::vector<Candidate>& result) const {
+	if (lng_from > lng_to) {
+		return;
+	}
+	const auto collect = [&point, max_chord2, &result](const Entry& entry) {
+		const double dx = entry.x - point.x;
+		const double dy = entry.y - point.y;
+		const double dz = entry.z - point.z;
+		const double chord2 = dx * dx + dy * dy + dz * dz;
+		if (chord2 <= max_chord2) {
+			result.push_back({ entry.stop_ptr, chord2 });
+		}
+	};
+
+	const std::size_t first_cell = GetIndex({ lat, lng_from });
+	const std::size_t last_cell = GetIndex({ lat, lng_to });
+	// ячейки одной строки лежат в entries_ подряд
+	for (uint32_t i = offsets_[first_cell]; i < offsets_[last_cell + 1]; ++i) {
+		collect(entries_[i]);
+	}
+	if (pending_count_ > 0) {
+		for (std::size_t cell = first_cell; cell <= last_cell; ++cell) {
+			for (const Entry& entry : pending_[cell]) {
+				collect(entry);
+			}
+		}
+	}
+}
+
+std::vector<StopDistance> StopsSpatialIndex::MakeResult(geo::Coordinates point, std::vector<Candidate>& candidates, std::size_t count) {
+	count = std::min(count, candidates.size());
+	std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(),
+		[](const Candidate& lhs, const Candidate& rhs) { return lhs.chord2 < rhs.chord2; });
+
+	std::vector<double> lats(count);
+	std::vector<double> lngs(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		lats[i] = candidates[i].stop_ptr->coordinates.lat;
+		lngs[i] = candidates[i].stop_ptr->coordinates.lng;
+	}
+	std::vector<double> distances(count);
+	geo::ComputeDistances(point, lats.data(), lngs.data(), count, distances.data());
+
+	std::vector<StopDistance> result;
+	result.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		result.push_back({ candidates[i].stop_ptr, distances[i] });
+	}
+	std::sort(result.begin(), result.end(), IsCloser);
+	return result;
+}
+
+std::vector<StopDistance> StopsSpatialIndex::FindNearest(geo::Coordinates point, std::size_t count) const {
+	if (stops_.empty() || count == 0) {
+		return {};
+	}
+	count = std::min(count, stops_.size());
+	const Cell center = GetCell(point);
+	const Entry origin = MakeEntry(nullptr, point);
+	const double any_chord2 = std::numeric_limits<double>::infinity();
+	std::vector<Candidate> candidates;
+	candidates.reserve(count * 8);
+
+	// расстояние по кругу столбцов от from вправо до to
+	const auto columns_right = [this](int32_t from, int32_t to) {
+		return (to - from + columns_per_turn_) % columns_per_turn_;
+	};
+	// кольца ближе границ сетки пусты, начинаем сразу с первого непустого
+	int32_t lng_gap = 0;
+	if (center.lng < min_cell_.lng || center.lng > max_cell_.lng) {
+		lng_gap = std::min(columns_right(center.lng, min_cell_.lng), columns_right(max_cell_.lng, center.lng));
+	}
+	const int32_t first_ring = std::max({ 0, min_cell_.lat - center.lat, center.lat - max_cell_.lat, lng_gap });
+
+	// обходим кольца ячеек вокруг центральной, пока следующее кольцо может содержать остановку ближе найденных
+	for (int32_t ring = first_ring;; ++ring) {
+		if (ring == 0) {
+			CollectRow(center.lat, center.lng, center.lng, origin, any_chord2, candidates);
+		} else {
+			CollectRow(center.lat - ring, center.lng - ring, center.lng + ring, origin, any_chord2, candidates);
+			CollectRow(center.lat + ring, center.lng - ring, center.lng + ring, origin, any_chord2, candidates);
+			// боковые столбцы кольца, еще не просмотренные: по кругу они могут совпасть друг с другом и с прежними
+			const int32_t lat_from = std::max(center.lat - ring + 1, min_cell_.lat);
+			const int32_t lat_to = std::min(center.lat + ring - 1, max_cell_.lat);
+			for (int32_t lat = lat_from; lat <= lat_to && 2 * ring <= columns_per_turn_; ++lat) {
+				CollectRow(lat, center.lng + ring, center.lng + ring, origin, any_chord2, candidates);
+				if (2 * ring < columns_per_turn_) {
+					CollectRow(lat, center.lng - ring, center.lng - ring, origin, any_chord2, candidates);
+				}
+			}
+		}
+
+		bool covers_lng = 2 * ring + 1 >= columns_per_turn_;
+		for (const int32_t shift : { -columns_per_turn_, 0, columns_per_turn_ }) {
+			covers_lng = covers_lng || (center.lng + shift - ring <= min_cell_.lng && center.lng + shift + ring >= max_cell_.lng);
+		}
+		if (covers_lng && center.lat - ring <= min_cell_.lat && center.lat + ring >= max_cell_.lat) {
+			break;
+		}
+		if (candidates.size() >= count) {
+			std::nth_element(candidates.begin(), candidates.begin() + (count - 1), candidates.end(),
+				[](const Candidate& lhs, const Candidate& rhs) { return lhs.chord2 < rhs.chord2; });
+			// любая точка дальних колец отделена от центральной ячейки ring целыми ячейками по широте
+			// или ring столбцами по долготе на широтах, уже просмотренных кольцами
+			const double next_ring_chord2 = std::min(GetChord2(ring * cell_size_ * METERS_PER_DEGREE),
+				GetMinLngChord2(ring * lng_cell_size_, std::abs(point.lat) + (ring + 1) * cell_size_));
+			if (candidates[count - 1].chord2 <= next_ring_chord2) {
+				break;
+			}
+		}
+	}
+
+	auto result = MakeResult(point, candidates, count);
+	for (const auto& outliers : outliers_) {
+		const auto outlier_result = outliers.FindNearest(point, count);
+		result.insert(result.end(), outlier_result.begin(), outlier_result.end());
+		std::sort(result.begin(), result.end(), IsCloser);
+		result.resize(std::min(result.size(), count));
+	}
+	return result;
+}
+
+std::vector<StopDistance> StopsSpatialIndex::FindInRadius(geo::Coordinates point, double radius) const {
+	if (stops_.empty() || radius < 0.) {
+		return {};
+	}
+	const Cell center = GetCell(point);
+	const double lat_span = radius / METERS_PER_DEGREE;
+	const double max_lat = std::abs(point.lat) + lat_span + cell_size_;
+
+	// окно поиска ограничено границами сетки, чтобы большой радиус не перебирал пустую сетку;
+	// окно шире круга долготы просматривает строки целиком
+	const double lat_cells = std::ceil(lat_span / cell_size_);
+	const double lng_cells = std::ceil(GetMaxLngDelta(radius, max_lat) / lng_cell_size_);
+
+	const int32_t lat_from = static_cast<int32_t>(std::max<double>(center.lat - lat_cells, min_cell_.lat));
+	const int32_t lat_to = static_cast<int32_t>(std::min<double>(center.lat + lat_cells, max_cell_.lat));
+	const int32_t lng_span = static_cast<int32_t>(std::min<double>(lng_cells, columns_per_turn_));
+
+	// запас на погрешность округления, окончательно радиус проверяется по точному расстоянию
+	const double max_chord2 = GetChord2(radius) * (1. + 1e-9) + 1e-18;
+	const Entry origin = MakeEntry(nullptr, point);
+	std::vector<Candidate> candidates;
+	for (int32_t lat = lat_from; lat <= lat_to; ++lat) {
+		CollectRow(lat, center.lng - lng_span, center.lng + lng_span, origin, max_chord2, candidates);
+	}
+
+	auto result = MakeResult(point, candidates, candidates.size());
+	for (const auto& outliers : outliers_) {
+		const auto outlier_result = outliers.FindInRadius(point, radius);
+		result.insert(result.end(), outlier_result.begin(), outlier_result.end());
+		std::sort(result.begin(), result.end(), IsCloser);
+	}
+	while (!result.empty() && result.back().distance > radius) {
+		result.pop_back();
+	}
+	return result;
+}
+
+} // namespace transport_ctg
\ No newline at end of file
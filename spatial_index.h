@@ -0,0 +1,111 @@
+#pragma once
+#include "domain.h"
+#include "geo.h"
+#include "memory_report.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace transport_ctg {
+
+// Равномерная сетка по широте и долготе для поиска остановок рядом с точкой.
+// Каждая остановка попадает в одну ячейку, запросы просматривают только ячейки
+// в окрестности точки. Кандидаты сравниваются по длине хорды между единичными векторами
+// (она монотонна по расстоянию вдоль дуги и не требует тригонометрии), а точное
+// расстояние через geo::ComputeDistances считается только для попавших в ответ остановок.
+//
+// Остановки хранятся одним массивом, упорядоченным по ячейкам (строка сетки лежит в памяти
+// подряд), размер ячейки подбирается так, чтобы в ней было в среднем STOPS_PER_CELL остановок.
+// Ячейка по долготе шире в 1 / cos(широты середины сети) раз, чтобы в метрах быть близкой
+// к квадрату. Долгота отсчитывается от середины наибольшего промежутка между долготами
+// остановок, а столбцы замыкаются в круг: сеть и окно поиска могут пересекать 180-й меридиан.
+// Сетка строится по центральной части сети без 1/OUTLIER_QUANTILE крайних значений широты
+// и долготы с каждой стороны, поэтому далекие одиночные остановки не растягивают ячейки.
+// Остановки за ее границами хранятся в такой же вложенной сетке outliers_.
+// Добавленные после построения остановки попадают в отдельные списки ячеек, сетка
+// перестраивается, когда их становится больше восьмой части.
+class StopsSpatialIndex {
+public:
+	static constexpr double STOPS_PER_CELL = 2.;
+	static constexpr std::size_t OUTLIER_QUANTILE = 1000;
+
+	void Add(const Stop* stop);
+	// добавляет остановки пачкой и перестраивает сетку один раз
+	void Add(const std::vector<const Stop*>& stops);
+	void Reserve(std::size_t stop_count);
+	// раскладывает все добавленные остановки в основной массив
+	void Build();
+
+	// count ближайших к point остановок в порядке возрастания расстояния
+	std::vector<StopDistance> FindNearest(geo::Coordinates point, std::size_t count) const;
+	// остановки на расстоянии не более radius метров от point в порядке возрастания расстояния
+	std::vector<StopDistance> FindInRadius(geo::Coordinates point, double radius) const;
+
+	std::size_t GetStopCount() const;
+	// память, занятая массивами сетки
+	std::size_t GetMemoryUsage() const;
+
+private:
+	struct Cell {
+		int32_t lat = 0;
+		int32_t lng = 0;
+	};
+
+	// остановка и ее точка на единичной сфере
+	struct Entry {
+		const Stop* stop_ptr = nullptr;
+		double x = 0.;
+		double y = 0.;
+		double z = 0.;
+	};
+
+	// остановка и квадрат хорды до точки запроса
+	struct Candidate {
+		const Stop* stop_ptr = nullptr;
+		double chord2 = 0.;
+	};
+
+	std::vector<const Stop*> stops_;
+	// остановки, упорядоченные по ячейкам построчно: (lat - min_cell_.lat) * columns + (lng - min_cell_.lng)
+	std::vector<Entry> entries_;
+	// начало ячейки i в entries_ - offsets_[i], конец - offsets_[i + 1]
+	std::vector<uint32_t> offsets_;
+	// остановки, добавленные после построения сетки (пусто, если таких нет)
+	std::vector<std::vector<Entry>> pending_;
+	std::size_t pending_count_ = 0;
+	// остановки за границами сетки: пусто или одна вложенная сетка
+	std::vector<StopsSpatialIndex> outliers_;
+	// размер ячейки по широте в градусах
+	double cell_size_ = 0.01;
+	// долгота, от которой отсчитываются столбцы, и ширина столбца в градусах:
+	// столбец долготы lng - floor(((lng - lng_origin_) mod 360) / lng_cell_size_)
+	double lng_origin_ = 0.;
+	double lng_cell_size_ = 0.01;
+	// столбцов на полный круг долготы, lng_cell_size_ * columns_per_turn_ == 360
+	int32_t columns_per_turn_ = 36000;
+	// границы сетки, дальше них остановок нет
+	Cell min_cell_;
+	Cell max_cell_;
+
+	Cell GetCell(geo::Coordinates point) const;
+	// долгота, отсчитанная от lng_origin_, в [0, 360)
+	double NormalizeLng(double lng) const;
+	int32_t GetColumn(double normalized_lng) const;
+	bool IsInside(Cell cell) const;
+	std::size_t GetIndex(Cell cell) const;
+	// подбирает lng_origin_, размеры ячеек и границы сетки по центральной части сети
+	void BuildBounds();
+
+	static Entry MakeEntry(const Stop* stop_ptr, geo::Coordinates point);
+
+	// добавляет в result остановки из ячеек строки lat с lng_from по lng_to,
+	// у которых квадрат хорды не больше max_chord2. Номера столбцов берутся по кругу,
+	// окно шириной в круг и больше просматривает строку целиком один раз
+	void CollectRow(int32_t lat, int32_t lng_from, int32_t lng_to, const Entry& point, double max_chord2, std::vector<Candidate>& result) const;
+	// то же для столбцов сетки с lng_from по lng_to без перехода через круг
+	void CollectCells(int32_t lat, int32_t lng_from, int32_t lng_to, const Entry& point, double max_chord2, std::vector<Candidate>& result) const;
+	// сортирует первые count кандидатов и переводит их в расстояния в метрах
+	static std::vector<StopDistance> MakeResult(geo::Coordinates point, std::vector<Candidate>& candidates, std::size_t count);
+};
+
+} // namespace transport_ctg
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include "svg.h"
+#include "parallel.h"
+
+#include <charconv>
+#include <sstream>
 
 namespace svg {
 
@@ -127,6 +131,283 @@ namespace svg {
 		out << "</svg>"sv;
 	}
 
+	// ------------- FlatDocument -----------
+
+	namespace {
+
+		// наибольшая длина числа в формате потока по умолчанию, например -1.23457e-308
+		constexpr size_t MAX_NUMBER_SIZE = 16;
+		// наибольшая длина элемента без чисел, стилей и текста надписи
+		constexpr size_t MAX_TAG_SIZE = 48;
+
+		// вещественные числа выводятся так же, как потоком с настройками по умолчанию
+		void AppendNumber(std::string& out, double value) {
+			char chars[32];
+			const auto result = std::to_chars(chars, chars + sizeof(chars), value, std::chars_format::general, 6);
+			out.append(chars, result.ptr);
+		}
+
+		void AppendAttribute(std::string& out, std::string_view name, double value) {
+			out.append(name);
+			out.append("=\""sv);
+			AppendNumber(out, value);
+			out.push_back('"');
+		}
+
+	} // namespace
+
+	FlatDocument::StyleId FlatDocument::AddPathStyle(const PathStyle& style) {
+		std::ostringstream attrs;
+		if (style.fill_color) {
+			attrs << " fill=\""sv << *style.fill_color << "\""sv;
+		}
+		if (style.stroke_color) {
+			attrs << " stroke=\""sv << *style.stroke_color << "\""sv;
+		}
+		if (style.stroke_width) {
+			attrs << " stroke-width=\""sv << *style.stroke_width << "\""sv;
+		}
+		if (style.line_cap) {
+			attrs << " stroke-linecap=\""sv << *style.line_cap << "\""sv;
+		}
+		if (style.line_join) {
+			attrs << " stroke-linejoin=\""sv << *style.line_join << "\""sv;
+		}
+		path_styles_.push_back(attrs.str());
+		return static_cast<StyleId>(path_styles_.size() - 1);
+	}
+
+	FlatDocument::StyleId FlatDocument::AddTextStyle(const TextStyle& style) {
+		std::ostringstream attrs;
+		attrs << " dx=\""sv << style.offset.x << "\" dy=\""sv << style.offset.y << "\""sv;
+		attrs << " font-size=\""sv << style.font_size << "\""sv;
+		if (!style.font_family.empty()) {
+			attrs << " font-family=\""sv << style.font_family << "\""sv;
+		}
+		if (!style.font_weight.empty()) {
+			attrs << " font-weight=\""sv << style.font_weight << "\""sv;
+		}
+		text_styles_.push_back(attrs.str());
+		return static_cast<StyleId>(text_styles_.size() - 1);
+	}
+
+	void FlatDocument::AddCircle(Point center, double radius, StyleId path_style) {
+		elements_.push_back({ ElementType::CIRCLE, path_style, static_cast<uint32_t>(circles_.size()) });
+		circles_.push_back({ center, radius });
+	}
+
+	void FlatDocument::StartPolyline(StyleId path_style) {
+		elements_.push_back({ ElementType::POLYLINE, path_style, static_cast<uint32_t>(polylines_.size()) });
+		polylines_.push_back({ points_.size(), 0 });
+	}
+
+	void FlatDocument::AddPoint(Point point) {
+		points_.push_back(point);
+		++polylines_.back().count;
+	}
+
+	void FlatDocument::AddText(Point position, std::string_view data, StyleId path_style, StyleId text_style) {
+		elements_.push_back({ ElementType::TEXT, path_style, static_cast<uint32_t>(texts_.size()) });
+		texts_.push_back({ position, text_style, text_data_.size(), data.size() });
+		text_data_.append(data);
+	}
+
+	void FlatDocument::SetViewBox(Point min, Point max) {
+		view_box_ = { min, max };
+	}
+
+	size_t FlatDocument::EstimateSize() const {
+		size_t size = 128 + elements_.size() * (MAX_TAG_SIZE + 3 * MAX_NUMBER_SIZE)
+			+ points_.size() * (2 * MAX_NUMBER_SIZE + 2) + text_data_.size();
+		for (const auto& element : elements_) {
+			size += path_styles_[element.path_style].size();
+		}
+		for (const auto& text : texts_) {
+			size += text_styles_[text.text_style].size();
+		}
+		return size;
+	}
+
+	void FlatDocument::RenderHeader(std::string& out) const {
+		out.append("<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv);
+		out.append("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv);
+		if (view_box_) {
+			const auto& [min, max] = *view_box_;
+			out.append(" viewBox=\""sv);
+			AppendNumber(out, min.x);
+			out.push_back(' ');
+			AppendNumber(out, min.y);
+			out.push_back(' ');
+			AppendNumber(out, max.x - min.x);
+			out.push_back(' ');
+			AppendNumber(out, max.y - min.y);
+			out.push_back('"');
+		}
+		out.append(">\n"sv);
+	}
+
+	void FlatDocument::Render(std::string& out) const {
+		out.reserve(out.size() + EstimateSize());
+		RenderHeader(out);
+		RenderElements(out);
+		out.append("</svg>"sv);
+	}
+
+	void FlatDocument::RenderElements(std::string& out) const {
+		for (const auto& element : elements_) {
+			RenderElement(out, element);
+		}
+	}
+
+	void FlatDocument::RenderElements(std::string& buffer, const ChunkConsumer& consume) const {
+		for (const auto& element : elements_) {
+			RenderElement(buffer, element);
+			if (buffer.size() >= CHUNK_SIZE) {
+				consume(buffer);
+				buffer.clear();
+			}
+		}
+	}
+
+	void FlatDocument::RenderElement(std::string& out, const Element& element) const {
+		out.append("  "sv);
+		const std::string& path_style = path_styles_[element.path_style];
+		switch (element.type) {
+		case ElementType::CIRCLE: {
+			const auto& circle = circles_[element.index];
+			AppendAttribute(out, "<circle cx"sv, circle.center.x);
+			AppendAttribute(out, " cy"sv, circle.center.y);
+			AppendAttribute(out, " r"sv, circle.radius);
+			out.append(path_style);
+			out.append("/>\n"sv);
+			break;
+		}
+		case ElementType::POLYLINE: {
+			const auto& polyline = polylines_[element.index];
+			out.append("<polyline points=\""sv);
+			for (size_t i = polyline.first; i < polyline.first + polyline.count; ++i) {
+				if (i != polyline.first) {
+					out.push_back(' ');
+				}
+				AppendNumber(out, points_[i].x);
+				out.push_back(',');
+				AppendNumber(out, points_[i].y);
+			}
+			out.push_back('"');
+			out.append(path_style);
+			out.append("/>\n"sv);
+			break;
+		}
+		case ElementType::TEXT: {
+			const auto& text = texts_[element.index];
+			out.append("<text"sv);
+			out.append(path_style);
+			AppendAttribute(out, " x"sv, text.position.x);
+			AppendAttribute(out, " y"sv, text.position.y);
+			out.append(text_styles_[text.text_style]);
+			out.push_back('>');
+			out.append(text_data_, text.first, text.size);
+			out.append("</text>\n"sv);
+			break;
+		}
+		}
+	}
+
+	void FlatDocument::Render(const ChunkConsumer& consume) const {
+		std::string buffer;
+		buffer.reserve(CHUNK_SIZE + CHUNK_SIZE / 4);
+		RenderHeader(buffer);
+		RenderElements(buffer, consume);
+		buffer.append("</svg>"sv);
+		consume(buffer);
+	}
+
+	void FlatDocument::Render(std::ostream& out) const {
+		std::string buffer;
+		Render(buffer);
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	}
+
+	LayeredDocument::LayeredDocument(size_t part_count)
+		: parts_(part_count) {
+	}
+
+	size_t LayeredDocument::GetPartCount() const {
+		return parts_.size();
+	}
+
+	FlatDocument& LayeredDocument::GetPart(size_t index) {
+		return parts_[index];
+	}
+
+	// части выводятся в отдельные буферы и затем склеиваются;
+	// в одном потоке промежуточные буферы не нужны
+	void LayeredDocument::Render(std::string& out) const {
+		if (parallel::GetThreadCount() == 1 || parts_.size() == 1) {
+			size_t size = 0;
+			for (const auto& part : parts_) {
+				size += part.EstimateSize();
+			}
+			out.reserve(out.size() + size);
+			FlatDocument{}.RenderHeader(out);
+			for (const auto& part : parts_) {
+				part.RenderElements(out);
+			}
+			out.append("</svg>"sv);
+			return;
+		}
+
+		std::vector<std::string> buffers(parts_.size());
+		parallel::ForEachIndex(parts_.size(), [this, &buffers](size_t i) {
+			buffers[i].reserve(parts_[i].EstimateSize());
+			parts_[i].RenderElements(buffers[i]);
+		});
+
+		size_t size = 0;
+		for (const auto& buffer : buffers) {
+			size += buffer.size();
+		}
+		out.reserve(out.size() + size + 128);
+		FlatDocument{}.RenderHeader(out);
+		for (const auto& buffer : buffers) {
+			out.append(buffer);
+		}
+		out.append("</svg>"sv);
+	}
+
+	void LayeredDocument::Render(const ChunkConsumer& consume) const {
+		if (parallel::GetThreadCount() == 1 || parts_.size() == 1) {
+			std::string buffer;
+			buffer.reserve(FlatDocument::CHUNK_SIZE + FlatDocument::CHUNK_SIZE / 4);
+			FlatDocument{}.RenderHeader(buffer);
+			for (const auto& part : parts_) {
+				part.RenderElements(buffer, consume);
+			}
+			buffer.append("</svg>"sv);
+			consume(buffer);
+			return;
+		}
+
+		std::vector<std::string> buffers(parts_.size());
+		parallel::ForEachIndex(parts_.size(), [this, &buffers](size_t i) {
+			buffers[i].reserve(parts_[i].EstimateSize());
+			parts_[i].RenderElements(buffers[i]);
+		});
+		std::string header;
+		FlatDocument{}.RenderHeader(header);
+		consume(header);
+		for (const auto& buffer : buffers) {
+			consume(buffer);
+		}
+		consume("</svg>"sv);
+	}
+
+	void LayeredDocument::Render(std::ostream& out) const {
+		std::string buffer;
+		Render(buffer);
+		out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	}
+
 	std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap) {
 		switch (line_cap) {
 		case StrokeLineCap::BUTT: {
@@ -2,9 +2,12 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 #include <optional>
@@ -314,6 +317,137 @@ namespace svg {
 		std::vector<std::unique_ptr<Object>> objects_;
 	};
 
+	// Свойства заливки и контура, общие для многих элементов FlatDocument
+	struct PathStyle {
+		std::optional<Color> fill_color;
+		std::optional<Color> stroke_color;
+		std::optional<double> stroke_width;
+		std::optional<StrokeLineCap> line_cap;
+		std::optional<StrokeLineJoin> line_join;
+	};
+
+	// Свойства шрифта, общие для многих надписей FlatDocument
+	struct TextStyle {
+		Point offset = { 0.0, 0.0 };
+		uint32_t font_size = 1;
+		std::string font_family;
+		std::string font_weight;
+	};
+
+	/*
+	 * SVG-документ с плоским хранением элементов: круги, вершины ломаных и тексты надписей
+	 * лежат подряд в общих массивах, а стили хранятся один раз и задаются элементам номером.
+	 * Атрибуты каждого стиля выводятся в текст один раз при добавлении, весь документ
+	 * выводится в один заранее выделенный буфер. Результат совпадает с выводом Document
+	 * с такими же объектами Circle, Polyline и Text
+	 */
+	// получатель svg-представления документа, выводимого по частям
+	using ChunkConsumer = std::function<void(std::string_view)>;
+
+	class FlatDocument {
+	public:
+		using StyleId = uint32_t;
+
+		StyleId AddPathStyle(const PathStyle& style);
+		StyleId AddTextStyle(const TextStyle& style);
+
+		void AddCircle(Point center, double radius, StyleId path_style);
+		// начинает ломаную; ее вершины добавляются через AddPoint
+		void StartPolyline(StyleId path_style);
+		void AddPoint(Point point);
+		void AddText(Point position, std::string_view data, StyleId path_style, StyleId text_style);
+
+		// задает прямоугольник изображения, который показывает документ (атрибут viewBox)
+		void SetViewBox(Point min, Point max);
+
+		// Выводит svg-представление документа в конец строки out
+		void Render(std::string& out) const;
+		// Выводит в ostream svg-представление документа
+		void Render(std::ostream& out) const;
+		// Выводит svg-представление частями по несколько десятков килобайт,
+		// документ целиком в памяти не собирается
+		void Render(const ChunkConsumer& consume) const;
+		// выводит только элементы документа, без заголовка и закрывающего тега
+		void RenderElements(std::string& out) const;
+
+	private:
+		friend class LayeredDocument;
+
+		// размер части, после которого она передается получателю
+		static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+		enum class ElementType : uint8_t {
+			CIRCLE,
+			POLYLINE,
+			TEXT,
+		};
+
+		// элемент документа: тип, стиль и номер в массиве элементов своего типа
+		struct Element {
+			ElementType type;
+			StyleId path_style;
+			uint32_t index;
+		};
+
+		struct CircleData {
+			Point center;
+			double radius = 1.0;
+		};
+
+		// вершины points_[first, first + count)
+		struct PolylineData {
+			size_t first = 0;
+			size_t count = 0;
+		};
+
+		// текст text_data_[first, first + size)
+		struct TextData {
+			Point position;
+			StyleId text_style = 0;
+			size_t first = 0;
+			size_t size = 0;
+		};
+
+		// левый верхний и правый нижний углы viewBox
+		std::optional<std::pair<Point, Point>> view_box_;
+		// выведенные атрибуты стилей, например ` fill="none" stroke-width="14"`
+		std::vector<std::string> path_styles_;
+		// атрибуты надписи, следующие за координатами: dx, dy и шрифт
+		std::vector<std::string> text_styles_;
+
+		std::vector<Element> elements_;
+		std::vector<CircleData> circles_;
+		std::vector<PolylineData> polylines_;
+		std::vector<Point> points_;
+		std::vector<TextData> texts_;
+		std::string text_data_;
+
+		// верхняя граница длины svg-представления
+		size_t EstimateSize() const;
+		void RenderHeader(std::string& out) const;
+		void RenderElement(std::string& out, const Element& element) const;
+		// выводит элементы в buffer, передавая его получателю по мере заполнения
+		void RenderElements(std::string& buffer, const ChunkConsumer& consume) const;
+	};
+
+	// Документ из независимых частей: элементы частей выводятся подряд в порядке частей,
+	// так же, как если бы они были добавлены в один FlatDocument. Части можно заполнять
+	// из разных потоков, выводятся они параллельно
+	class LayeredDocument {
+	public:
+		explicit LayeredDocument(size_t part_count);
+
+		size_t GetPartCount() const;
+		FlatDocument& GetPart(size_t index);
+
+		void Render(std::string& out) const;
+		void Render(std::ostream& out) const;
+		void Render(const ChunkConsumer& consume) const;
+
+	private:
+		std::vector<FlatDocument> parts_;
+	};
+
 	template <typename T>
 	void ObjectContainer::Add(T obj) {
 		AddPtr(std::make_unique<T>(std::move(obj)));
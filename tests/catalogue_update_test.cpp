@@ -0,0 +1,270 @@
+// Публикация новых версий справочника через CatalogueHandle и ответы на запросы по ним
+#include "testing.h"
+
+#include "../json_reader.h"
+#include "../map_renderer.h"
+#include "../request_handler.h"
+#include "../transport_catalogue.h"
+#include "../transport_router.h"
+
+#include <malloc.h>
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
+using namespace transport_ctg;
+
+namespace {
+
+const RoutingSettings ROUTING_SETTINGS{ 2, 30.0 };
+
+// A - B, маршрут 1 в обе стороны
+Catalogue MakeCatalogue() {
+	Catalogue catalogue;
+	catalogue.AddStop({ "A"sv, { 55.60, 37.60 } });
+	catalogue.AddStop({ "B"sv, { 55.61, 37.61 } });
+	const Stop* a = catalogue.FindStop("A"sv);
+	const Stop* b = catalogue.FindStop("B"sv);
+	catalogue.AddDistanceBetweenStops({ a, b }, 1000);
+	catalogue.AddBus({ "1"sv, { a, b, a }, false });
+	return catalogue;
+}
+
+// новая остановка C и маршрут 2 от B до C
+void AddStopC(Catalogue& catalogue) {
+	catalogue.AddStop({ "C"sv, { 55.62, 37.62 } });
+	const Stop* b = catalogue.FindStop("B"sv);
+	const Stop* c = catalogue.FindStop("C"sv);
+	catalogue.AddDistanceBetweenStops({ b, c }, 2000);
+	catalogue.AddBus({ "2"sv, { b, c, b }, false });
+}
+
+void TestRouteToPublishedStop() {
+	CatalogueHandle handle(MakeCatalogue());
+	const auto old_version = handle.Pin();
+	const BusRouter old_router(ROUTING_SETTINGS, old_version);
+
+	const auto new_version = handle.Update(AddStopC);
+	CHECK(handle.Pin() == new_version);
+	CHECK(old_version->FindStop("C"sv) == nullptr);
+
+	// маршрутизатор старой версии не знает новую остановку и отвечает, что маршрута нет
+	const Stop* c = new_version->FindStop("C"sv);
+	CHECK(c != nullptr);
+	CHECK(!old_router.IsBuiltFor(*new_version));
+	CHECK(!old_router.FindRoute(old_version->FindStop("A"sv), c));
+
+	// A -(ожидание 2)- 1 (1 км, 2 мин) -(ожидание 2)- 2 (2 км, 4 мин)
+	const BusRouter new_router(ROUTING_SETTINGS, new_version);
+	const auto route = new_router.FindRoute(new_version->FindStop("A"sv), c);
+	CHECK(route);
+	CHECK(route->edges.size() == 4);
+	CHECK(std::abs(route->weight - 10.0) < 1e-9);
+}
+
+void TestReplaceCopiesEntities() {
+	CatalogueHandle handle(MakeCatalogue());
+	const auto old_version = handle.Pin();
+	const Stop* old_a = old_version->FindStop("A"sv);
+	const Bus* old_bus = old_version->FindBus("1"sv);
+
+	const auto new_version = handle.Update([](Catalogue& catalogue) {
+		catalogue.ReplaceStop({ "A"sv, { 56.0, 38.0 } });
+	});
+
+	// старая версия видит прежние объекты без изменений
+	CHECK(old_version->FindStop("A"sv) == old_a);
+	CHECK(old_a->coordinates == (geo::Coordinates{ 55.60, 37.60 }));
+	CHECK(old_bus->stops_ptr.front() == old_a);
+
+	// в новой версии остановка и проходящий через нее маршрут заменены копиями
+	const Stop* new_a = new_version->FindStop("A"sv);
+	CHECK(new_a != old_a);
+	CHECK(new_a->id == old_a->id);
+	CHECK(new_a->coordinates == (geo::Coordinates{ 56.0, 38.0 }));
+	const Bus* new_bus = new_version->FindBus("1"sv);
+	CHECK(new_bus != old_bus);
+	CHECK(new_bus->stops_ptr.front() == new_a);
+	CHECK(new_version->GetDistanceBetweenStops({ new_a, new_version->FindStop("B"sv) }) == 1000);
+	CHECK(new_version->GetBusesForStop("A"sv).count("1"sv) == 1);
+}
+
+void TestInvalidUpdates() {
+	CatalogueHandle handle(MakeCatalogue());
+	const auto version = handle.Pin();
+
+	// повторное добавление не создает второй записи с тем же именем
+	CHECK(Throws<std::invalid_argument>([&handle] {
+		handle.Update([](Catalogue& catalogue) {
+			catalogue.AddStop({ "A"sv, { 0.0, 0.0 } });
+		});
+	}));
+	CHECK(Throws<std::invalid_argument>([&handle] {
+		handle.Update([](Catalogue& catalogue) {
+			catalogue.AddBus({ "1"sv, {}, true });
+		});
+	}));
+	// через остановку B проходит маршрут
+	CHECK(Throws<std::invalid_argument>([&handle] {
+		handle.Update([](Catalogue& catalogue) {
+			catalogue.RemoveStop("B"sv);
+		});
+	}));
+	// при ошибке новая версия не публикуется
+	CHECK(handle.Pin() == version);
+	CHECK(version->GetStopCount() == 2);
+
+	const auto removed = handle.Update([](Catalogue& catalogue) {
+		catalogue.RemoveBus("1"sv);
+		catalogue.RemoveStop("A"sv);
+	});
+	CHECK(removed->GetStopCount() == 1);
+	CHECK(removed->GetBusCount() == 0);
+	CHECK(removed->FindStop("B"sv)->id == 0);
+	CHECK(version->GetStopCount() == 2);
+}
+
+// названия принадлежат остановкам и маршрутам: удаленные и не опубликованные после ошибки
+// объекты освобождаются вместе с названиями, поэтому память справочника не растет
+void TestNamesAreReleased() {
+	CatalogueHandle handle(MakeCatalogue());
+	const auto add_and_remove = [&handle](int i) {
+		const std::string stop_name = "Temporary stop with a long name "s + std::to_string(i);
+		const std::string bus_name = "Temporary bus with a long name "s + std::to_string(i);
+		handle.Update([&](Catalogue& catalogue) {
+			catalogue.AddStop({ stop_name, { 55.63, 37.63 } });
+			const Stop* a = catalogue.FindStop("A"sv);
+			catalogue.AddBus({ bus_name, { a, catalogue.FindStop(stop_name), a }, false });
+			catalogue.ReplaceStop({ "A"sv, { 55.60 + i * 1e-6, 37.60 } });
+		});
+		CHECK(handle.Pin()->FindBus(bus_name)->stops_ptr[1]->name == stop_name);
+		handle.Update([&](Catalogue& catalogue) {
+			catalogue.RemoveBus(bus_name);
+			catalogue.RemoveStop(stop_name);
+		});
+		CHECK(Throws<std::invalid_argument>([&] {
+			handle.Update([&](Catalogue& catalogue) {
+				catalogue.AddStop({ stop_name, { 55.63, 37.63 } });
+				catalogue.RemoveStop("B"sv);
+			});
+		}));
+	};
+	// первые изменения заполняют таблицы до рабочего размера
+	for (int i = 0; i < 10; ++i) {
+		add_and_remove(i);
+	}
+	const std::size_t before = mallinfo2().uordblks;
+	for (int i = 10; i < 2000; ++i) {
+		add_and_remove(i);
+	}
+	CHECK(mallinfo2().uordblks < before + 4 * 1024);
+	const auto version = handle.Pin();
+	CHECK(version->GetStopCount() == 2);
+	CHECK(version->FindStop("A"sv)->name == "A"sv);
+	CHECK(version->GetBusesForStop("A"sv).count("1"sv) == 1);
+}
+
+// запросы изменения в stat_requests видны следующим за ними запросам
+void TestUpdateRequests() {
+	std::istringstream input(R"({
+		"base_requests": [
+			{"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60, "road_distances": {"B": 1000}},
+			{"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61, "road_distances": {}},
+			{"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false}
+		],
+		"render_settings": {"width": 200, "height": 200, "padding": 30, "stop_radius": 5, "line_width": 14,
+			"bus_label_font_size": 20, "bus_label_offset": [7, 15], "stop_label_font_size": 20,
+			"stop_label_offset": [7, -3], "underlayer_color": "white", "underlayer_width": 3, "color_palette": ["green"]},
+		"routing_settings": {"bus_wait_time": 2, "bus_velocity": 30},
+		"stat_requests": [
+			{"id": 1, "type": "Route", "from": "A", "to": "C"},
+			{"id": 2, "type": "UpdateStop", "name": "C", "latitude": 55.62, "longitude": 37.62, "road_distances": {"B": 2000}},
+			{"id": 3, "type": "UpdateBus", "name": "2", "stops": ["B", "C"], "is_roundtrip": false},
+			{"id": 4, "type": "Route", "from": "A", "to": "C"},
+			{"id": 5, "type": "UpdateBus", "name": "3", "stops": ["B", "X"], "is_roundtrip": true}
+		]
+	})");
+	Catalogue catalogue;
+	json::JsonReader requests(input, catalogue);
+	CatalogueHandle handle(std::move(catalogue));
+	const auto map_renderer = requests.SetMapRenderer(requests.GetRenderSettings().AsMap());
+	const auto router = requests.SetRouter(requests.GetRoutingSettings().AsMap(), handle.Pin());
+
+	std::ostringstream output;
+	json::request_handler::RequestHandler(requests, handle, map_renderer, router, output);
+	const std::string text = output.str();
+	const json::Document document = json::Load(text);
+	const auto& answers = document.GetRoot().AsArray();
+	CHECK(answers.size() == 5);
+	CHECK(answers[0].AsMap().at("error_message"s).AsString() == "not found"s);
+	CHECK(answers[1].AsMap().count("error_message"s) == 0);
+	CHECK(answers[2].AsMap().count("error_message"s) == 0);
+	CHECK(std::abs(answers[3].AsMap().at("total_time"s).AsDouble() - 10.0) < 1e-9);
+	CHECK(answers[4].AsMap().at("error_message"s).AsString() == "stop X not found"s);
+	CHECK(handle.Pin()->GetStopCount() == 3);
+}
+
+// запрос изменения без нужного поля или с полем другого типа получает error_message,
+// справочник не меняется, ответы на следующие запросы выводятся
+void TestMalformedUpdateRequests() {
+	std::istringstream input(R"({
+		"base_requests": [
+			{"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.60, "road_distances": {"B": 1000}},
+			{"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61, "road_distances": {}},
+			{"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false}
+		],
+		"render_settings": {"width": 200, "height": 200, "padding": 30, "stop_radius": 5, "line_width": 14,
+			"bus_label_font_size": 20, "bus_label_offset": [7, 15], "stop_label_font_size": 20,
+			"stop_label_offset": [7, -3], "underlayer_color": "white", "underlayer_width": 3, "color_palette": ["green"]},
+		"routing_settings": {"bus_wait_time": 2, "bus_velocity": 30},
+		"stat_requests": [
+			{"id": 1, "type": "UpdateStop", "name": "X", "longitude": 37.0},
+			{"id": 2, "type": "UpdateStop", "name": "X", "latitude": 55.62, "longitude": 37.62, "road_distances": {"B": 1.5}},
+			{"id": 3, "type": "UpdateStop", "name": "A", "latitude": "55.62", "longitude": 37.62},
+			{"id": 4, "type": "UpdateBus", "name": "2", "stops": ["A", 1], "is_roundtrip": false},
+			{"id": 5, "type": "UpdateBus", "name": "2", "stops": ["A", "B"], "is_roundtrip": "no"},
+			{"id": 6, "type": "UpdateBus", "stops": ["A", "B"], "is_roundtrip": true},
+			{"id": 7, "type": "Bus", "name": "1"}
+		]
+	})");
+	Catalogue catalogue;
+	json::JsonReader requests(input, catalogue);
+	CatalogueHandle handle(std::move(catalogue));
+	const auto map_renderer = requests.SetMapRenderer(requests.GetRenderSettings().AsMap());
+	const auto router = requests.SetRouter(requests.GetRoutingSettings().AsMap(), handle.Pin());
+	const auto before = handle.Pin();
+
+	std::ostringstream output;
+	json::request_handler::RequestHandler(requests, handle, map_renderer, router, output);
+	const std::string text = output.str();
+	const json::Document document = json::Load(text);
+	const auto& answers = document.GetRoot().AsArray();
+	CHECK(answers.size() == 7);
+	CHECK(answers[0].AsMap().at("error_message"s).AsString() == "field latitude must be number"s);
+	CHECK(answers[1].AsMap().at("error_message"s).AsString() == "road distance to B must be int"s);
+	CHECK(answers[2].AsMap().at("error_message"s).AsString() == "field latitude must be number"s);
+	CHECK(answers[3].AsMap().at("error_message"s).AsString() == "bus stops must be strings"s);
+	CHECK(answers[4].AsMap().at("error_message"s).AsString() == "field is_roundtrip must be bool"s);
+	CHECK(answers[5].AsMap().at("error_message"s).AsString() == "field name must be string"s);
+	for (int i = 0; i < 6; ++i) {
+		CHECK(answers[i].AsMap().at("request_id"s).AsInt() == i + 1);
+	}
+	CHECK(answers[6].AsMap().at("route_length"s).AsInt() == 2000);
+	// ни одна версия не опубликована
+	CHECK(handle.Pin() == before);
+}
+
+} // namespace
+
+int main() {
+	TestRouteToPublishedStop();
+	TestReplaceCopiesEntities();
+	TestInvalidUpdates();
+	TestNamesAreReleased();
+	TestUpdateRequests();
+	TestMalformedUpdateRequests();
+	std::cout << "catalogue_update_test OK" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Ключи json::Dict: хранение в памяти словаря, копии между распределителями, повторы ключей,
+// неизменяемость через итератор и отсутствие роста памяти на ключах-данных при разборе
+// множества документов
+#include "testing.h"
+
+#include "../json.h"
+
+#include <malloc.h>
+
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+
+using namespace std::literals;
+
+namespace {
+
+std::size_t AllocatedBytes() {
+	return mallinfo2().uordblks;
+}
+
+// распределитель памяти, который считает невозвращенные байты
+class CountingResource final : public std::pmr::memory_resource {
+public:
+	std::size_t allocated = 0;
+
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		allocated += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+		allocated -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+// документ с road_distances на count остановок с уникальными названиями
+std::string MakeDocument(int first_stop, int count) {
+	std::string text = R"({"type": "Stop", "name": "A", "road_distances": {)"s;
+	for (int i = 0; i < count; ++i) {
+		text += (i == 0 ? "\""s : ", \""s) + "stop_"s + std::to_string(first_stop + i) + "\": "s + std::to_string(i);
+	}
+	return text + "}}"s;
+}
+
+// словарь, скопированный из дерева документа, не зависит от документа
+void TestCopyOutlivesDocument() {
+	json::Dict copy;
+	{
+		const json::Document document = json::Load(R"({"road_distances": {"Улица Ленина": 1, "x y": 2}})"sv);
+		copy = document.GetRoot().AsMap().at("road_distances"s).AsMap();
+	}
+	CHECK(copy.size() == 2);
+	CHECK(copy.at("Улица Ленина"s).AsInt() == 1);
+	CHECK(copy.at("x y"s).AsInt() == 2);
+
+	json::Dict moved = std::move(copy);
+	CHECK(moved.at("x y"s).AsInt() == 2);
+
+	// словарь в другой памяти получает собственные копии ключей
+	std::pmr::monotonic_buffer_resource resource;
+	json::Dict::Items items(&resource);
+	items.emplace_back("b b"sv, 2);
+	items.emplace_back("a a"sv, 1);
+	json::Dict arena_dict = json::Dict::FromUnsorted(std::move(items));
+	moved = std::move(arena_dict);
+	CHECK(moved.size() == 2);
+	CHECK(moved.begin()->first == "a a"sv);
+}
+
+// перемещение между распределителями освобождает ключи исходного словаря
+void TestMoveBetweenResources() {
+	CountingResource resource;
+	{
+		json::Dict::Items items(&resource);
+		items.emplace_back("b b"sv, 2);
+		items.emplace_back("a a"sv, 1);
+		json::Dict source = json::Dict::FromUnsorted(std::move(items));
+		json::Dict target;
+		target = std::move(source);
+		CHECK(target.size() == 2);
+		CHECK(target.at("a a"s).AsInt() == 1);
+		CHECK(source.size() == 0);
+	}
+	CHECK(resource.allocated == 0);
+}
+
+// через итератор меняются значения, ключи - только для чтения, как у std::map
+void TestIteratorKeysAreReadOnly() {
+	json::Dict dict{ { "b"sv, 2 }, { "a"sv, 1 } };
+	static_assert(!std::is_assignable_v<decltype((dict.begin()->first)), std::string_view>);
+	static_assert(!std::is_assignable_v<decltype(((*dict.begin()).first)), std::string_view>);
+	dict.find("b"sv)->second = 20;
+	for (auto [key, value] : dict) {
+		value = key == "a"sv ? json::Node(10) : value;
+	}
+	CHECK(dict.at("a"s).AsInt() == 10);
+	CHECK(dict.at("b"s).AsInt() == 20);
+	CHECK(std::prev(dict.end())->first == "b"sv);
+	const json::Dict::const_iterator it = dict.find("a"sv);
+	CHECK(it == static_cast<const json::Dict&>(dict).begin());
+}
+
+// из повторяющихся ключей остается первый
+void TestDuplicateKeys() {
+	const json::Document document = json::Load(R"({"k k": 1, "type": 2, "k k": 3, "type": 4})"sv);
+	const auto& dict = document.GetRoot().AsMap();
+	CHECK(dict.size() == 2);
+	CHECK(dict.at("k k"s).AsInt() == 1);
+	CHECK(dict.at("type"s).AsInt() == 2);
+
+	json::Dict::Items items;
+	items.emplace_back("name"sv, 1);
+	items.emplace_back("x x"sv, 2);
+	items.emplace_back("x x"sv, 3);
+	const json::Dict built = json::Dict::FromUnsorted(std::move(items));
+	CHECK(built.size() == 2);
+	CHECK(built.at("x x"s).AsInt() == 2);
+}
+
+// ключи-данные освобождаются вместе с документами, общее хранилище ключей не растет
+void TestDataKeysAreNotRetained() {
+	// первый разбор заполняет хранилище ключей схемы и кеши, дальше память не должна расти
+	json::Load(MakeDocument(0, 1000));
+	const std::size_t before = AllocatedBytes();
+	for (int i = 1; i <= 200; ++i) {
+		const json::Document document = json::Load(MakeDocument(i * 1000, 1000));
+		CHECK(document.GetRoot().AsMap().at("road_distances"s).AsMap().size() == 1000);
+		json::Dict copy = document.GetRoot().AsMap();
+		CHECK(copy.at("name"s).AsString() == "A"s);
+	}
+	CHECK(AllocatedBytes() < before + 64 * 1024);
+}
+
+} // namespace
+
+int main() {
+	TestCopyOutlivesDocument();
+	TestMoveBetweenResources();
+	TestIteratorKeysAreReadOnly();
+	TestDuplicateKeys();
+	TestDataKeysAreNotRetained();
+	std::cout << "json_dict_test OK" << std::endl;
+}
\ No newline at end of file
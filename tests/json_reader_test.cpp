@@ -0,0 +1,107 @@
+// Потоковая загрузка base_requests: строки SAX-разбора во всех режимах индекса кавычек,
+// ссылки на отсутствующие остановки и дробные расстояния
+#include "testing.h"
+
+#include "../json.h"
+#include "../json_reader.h"
+#include "../transport_catalogue.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+// собирает ключи и строки в том виде, в каком их получил обработчик
+class CollectingHandler final : public json::Handler {
+public:
+	std::string events;
+
+	void StartDict() override {}
+	void Key(std::string_view key) override {
+		events += "K:"s + std::string(key) + ";"s;
+	}
+	void EndDict() override {}
+	void StartArray() override {}
+	void EndArray() override {}
+	void Null() override {}
+	void Bool(bool) override {}
+	void Int(int) override {}
+	void Double(double) override {}
+	void String(std::string_view value) override {
+		events += "S:"s + std::string(value) + ";"s;
+	}
+};
+
+void TestHandlerStrings() {
+	CollectingHandler handler;
+	json::Parse(R"({"plain": "value", "esc\"aped": "line\nbreak", "list": ["a", "b\\c"]})"sv, handler);
+	CHECK(handler.events == "K:plain;S:value;K:esc\"aped;S:line\nbreak;K:list;S:a;S:b\\c;"s);
+}
+
+// строки разбираются одинаково с индексом кавычек и без него, в том числе когда индекс
+// выключается посреди документа: длинные строки в начале, короткие и с escape-последовательностями дальше
+void TestQuoteIndexModes() {
+	std::string text = "["s;
+	for (int i = 0; i < 2000; ++i) {
+		text += (i == 0 ? "\""s : ", \""s) + std::string(i < 300 ? 70 : 3, 'a' + i % 26)
+			+ (i % 7 == 0 ? "\\n\\\"x"s : ""s) + std::to_string(i) + "\""s;
+	}
+	text += "]"s;
+	std::string expected;
+	for (const auto mode : { json::QuoteIndexMode::NEVER, json::QuoteIndexMode::ALWAYS, json::QuoteIndexMode::AUTO }) {
+		json::SetQuoteIndexMode(mode);
+		CollectingHandler handler;
+		json::Parse(text, handler);
+		if (expected.empty()) {
+			expected = handler.events;
+		}
+		CHECK(handler.events == expected);
+		CHECK(json::Load(text).GetRoot().AsArray().back().AsString() == "xxx1999"s);
+	}
+	CHECK(expected.find("S:aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\n\"x0;"s) == 0);
+}
+
+std::string MakeInput(std::string_view bus_stops, std::string_view distances) {
+	return R"({"base_requests": [
+		{"type": "Bus", "name": "1", "stops": )"s + std::string(bus_stops) + R"(, "is_roundtrip": false},
+		{"type": "Stop", "name": "A", "latitude": 55.6, "longitude": 37.6, "road_distances": )"s + std::string(distances) + R"(},
+		{"type": "Stop", "name": "B", "latitude": 55.61, "longitude": 37.61, "road_distances": {}}
+	], "stat_requests": []})"s;
+}
+
+// сообщение об ошибке загрузки или пустая строка, если загрузка прошла
+std::string LoadError(const std::string& text) {
+	std::istringstream input(text);
+	transport_ctg::Catalogue catalogue;
+	try {
+		json::JsonReader reader(input, catalogue);
+	} catch (const std::invalid_argument& e) {
+		return e.what();
+	}
+	return {};
+}
+
+void TestUnknownStops() {
+	CHECK(LoadError(MakeInput(R"(["A", "B"])"sv, R"({"B": 100})"sv)).empty());
+	CHECK(LoadError(MakeInput(R"(["A", "C"])"sv, R"({"B": 100})"sv)) == "stop C not found"s);
+	CHECK(LoadError(MakeInput(R"(["A", "B"])"sv, R"({"D": 100})"sv)) == "stop D not found"s);
+}
+
+// дробное расстояние не пропускается молча: загрузка отклоняется
+void TestNonIntegerDistances() {
+	CHECK(LoadError(MakeInput(R"(["A", "B"])"sv, R"({"B": 1000.0})"sv)) == "Type is not int"s);
+	CHECK(LoadError(MakeInput(R"(["A", "B"])"sv, R"({"B": 1.5})"sv)) == "Type is not int"s);
+}
+
+} // namespace
+
+int main() {
+	TestHandlerStrings();
+	TestQuoteIndexModes();
+	TestUnknownStops();
+	TestNonIntegerDistances();
+	std::cout << "json_reader_test OK" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+// Совпадение карт, отрисованных разными путями, на сети с общими для многих маршрутов остановками:
+// - точки ProjectedStops - те же, что у проектора по всем вхождениям остановок в маршруты;
+// - StopsMap по всем остановкам и BusMap единственного маршрута совпадают с картой целиком;
+// - карта, слои которой поделены на несколько частей в нескольких потоках, байт в байт совпадает
+//   с картой из одной части на слой;
+// - тайл z = 0 и область на все изображение совпадают с картой целиком, кроме viewBox;
+// - векторный тайл z = 0 содержит те же линии и остановки в координатах тайла
+#include "testing.h"
+
+#include "../map_renderer.h"
+#include "../parallel.h"
+#include "../transport_catalogue.h"
+#include "../vector_tile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+
+using namespace std::literals;
+using namespace transport_ctg;
+using namespace renderer;
+
+namespace {
+
+constexpr int STOP_COUNT = 300;
+constexpr int BUS_COUNT = 150;
+constexpr int ROUTE_LENGTH = 12;
+// потоков на время теста, чтобы слои делились на части и на машине с одним ядром
+constexpr size_t THREAD_COUNT = 4;
+// при таком размере части каждый слой сети делится на THREAD_COUNT частей
+constexpr size_t PART_SIZE = 16;
+
+RenderSettings MakeSettings() {
+	RenderSettings settings;
+	settings.width = 1200.;
+	settings.height = 800.;
+	settings.padding = 50.;
+	settings.line_width = 14.;
+	settings.stop_radius = 5.;
+	settings.bus_label_font_size = 20;
+	settings.bus_label_offset = { 7., 15. };
+	settings.stop_label_font_size = 18;
+	settings.stop_label_offset = { 7., -3. };
+	settings.underlayer_color = svg::Rgba{ 255, 255, 255, 0.85 };
+	settings.underlayer_width = 3.;
+	settings.color_palette = { "green"s, svg::Rgb{ 255, 160, 0 }, "red"s };
+	// без упрощения фрагменты выводят линии так же, как карта целиком
+	settings.simplify_tolerance = 0.;
+	return settings;
+}
+
+// STOP_COUNT остановок, через каждую в среднем проходит BUS_COUNT * ROUTE_LENGTH / STOP_COUNT маршрутов
+void FillCatalogue(Catalogue& catalogue, int bus_count) {
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<double> lat(55.5, 55.9);
+	std::uniform_real_distribution<double> lng(37.3, 37.9);
+	std::uniform_int_distribution<int> stop_number(0, STOP_COUNT - 1);
+	std::vector<const Stop*> stops;
+	for (int i = 0; i < STOP_COUNT; ++i) {
+		const std::string name = "Stop "s + std::to_string(i);
+		catalogue.AddStop({ name, { lat(generator), lng(generator) } });
+		stops.push_back(catalogue.FindStop(name));
+	}
+	for (int i = 0; i < bus_count; ++i) {
+		const std::string name = "Bus "s + std::to_string(i);
+		Bus bus{ name, {}, i % 3 == 0 };
+		for (int j = 0; j < ROUTE_LENGTH; ++j) {
+			bus.stops_ptr.push_back(stops[stop_number(generator)]);
+		}
+		if (bus.is_roundtrip) {
+			bus.stops_ptr.push_back(bus.stops_ptr.front());
+		} else {
+			bus.stops_ptr.insert(bus.stops_ptr.end(), bus.stops_ptr.rbegin() + 1, bus.stops_ptr.rend());
+		}
+		catalogue.AddBus(std::move(bus));
+	}
+}
+
+// проектор по всем вхождениям остановок в маршруты, как до появления ProjectedStops
+SphereProjector MakeReferenceProjector(const std::map<std::string_view, const Bus*>& buses, const RenderSettings& settings) {
+	std::vector<geo::Coordinates> points;
+	for (const auto& [name, bus] : buses) {
+		for (const Stop* stop : bus->stops_ptr) {
+			points.push_back(stop->coordinates);
+		}
+	}
+	return SphereProjector(points.begin(), points.end(), settings.width, settings.height, settings.padding);
+}
+
+template <typename Document>
+std::string Render(const Document& document) {
+	std::string result;
+	document.Render(result);
+	return result;
+}
+
+// документ без атрибута viewBox
+std::string WithoutViewBox(std::string svg) {
+	const auto begin = svg.find(" viewBox=\""sv);
+	if (begin != std::string::npos) {
+		svg.erase(begin, svg.find('"', begin + 10) + 1 - begin);
+	}
+	return svg;
+}
+
+std::vector<uint32_t> GetNumbers(size_t count) {
+	std::vector<uint32_t> result(count);
+	std::iota(result.begin(), result.end(), 0);
+	return result;
+}
+
+void TestProjectedStops(const Catalogue& catalogue, const RenderSettings& settings) {
+	const auto buses = catalogue.GetSortedBuses();
+	const ProjectedStops projected(buses, settings);
+	const SphereProjector reference = MakeReferenceProjector(buses, settings);
+	std::set<const Stop*> used;
+	for (const auto& [name, bus] : buses) {
+		used.insert(bus->stops_ptr.begin(), bus->stops_ptr.end());
+	}
+	CHECK(projected.GetStops().size() == used.size());
+	CHECK(std::is_sorted(projected.GetStops().begin(), projected.GetStops().end(), [](const Stop* lhs, const Stop* rhs) {
+		return lhs->name < rhs->name;
+	}));
+	for (const auto& [name, bus] : buses) {
+		for (const Stop* stop : bus->stops_ptr) {
+			const svg::Point expected = reference(stop->coordinates);
+			const svg::Point actual = projected.GetPoint(stop);
+			CHECK(actual.x == expected.x && actual.y == expected.y);
+			CHECK(projected.GetStops()[projected.GetNumber(stop)] == stop);
+		}
+	}
+}
+
+void TestFragments(const Catalogue& catalogue, const RenderSettings& settings) {
+	const MapRenderer renderer(settings);
+	const auto buses = catalogue.GetSortedBuses();
+	const std::string full = Render(renderer.GetRenderedMap(buses));
+	const MapScene scene = renderer.MakeScene(buses);
+
+	// StopsMap по всем остановкам
+	CHECK(Render(renderer.GetRenderedMap(scene, GetNumbers(scene.GetRoutes().size()), GetNumbers(scene.GetStops().size()))) == full);
+
+	// тайл z = 0 и область, заданная углами изображения
+	const auto tile = renderer.GetTileViewport(0, 0, 0);
+	CHECK(tile.has_value());
+	const std::string tile_map = Render(renderer.GetRenderedMap(scene, *tile));
+	CHECK(tile_map != full);
+	CHECK(WithoutViewBox(tile_map) == WithoutViewBox(full));
+	const Viewport image{ { 0., 0. }, { settings.width, settings.height } };
+	CHECK(WithoutViewBox(Render(renderer.GetRenderedMap(scene, image))) == WithoutViewBox(full));
+}
+
+void TestLayerParts(const Catalogue& catalogue, const RenderSettings& settings) {
+	const auto buses = catalogue.GetSortedBuses();
+	// сеть меньше MapRenderer::MIN_PART_SIZE: по одной части на слой
+	const svg::LayeredDocument single = MapRenderer(settings).GetRenderedMap(buses);
+	CHECK(single.GetPartCount() == 4);
+	const std::string expected = Render(single);
+
+	// маршруты, их названия, остановки и их названия - по THREAD_COUNT частей
+	const svg::LayeredDocument split = MapRenderer(settings, PART_SIZE).GetRenderedMap(buses);
+	CHECK(split.GetPartCount() == 4 * THREAD_COUNT);
+	CHECK(Render(split) == expected);
+	std::ostringstream out;
+	split.Render(out);
+	CHECK(out.str() == expected);
+
+	// в одном потоке части склеиваются без буферов
+	parallel::SetThreadCount(1);
+	CHECK(Render(split) == expected);
+	CHECK(MapRenderer(settings, PART_SIZE).GetRenderedMap(buses).GetPartCount() == 4);
+	parallel::SetThreadCount(THREAD_COUNT);
+}
+
+// BusMap единственного маршрута сети - вся карта
+void TestBusMap(const RenderSettings& settings) {
+	Catalogue catalogue;
+	FillCatalogue(catalogue, 1);
+	const MapRenderer renderer(settings);
+	const auto buses = catalogue.GetSortedBuses();
+	const MapScene scene = renderer.MakeScene(buses);
+	CHECK(scene.GetRoutes().size() == 1);
+	std::vector<uint32_t> stops = scene.GetRoutes().front().stops;
+	std::sort(stops.begin(), stops.end());
+	stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+	CHECK(Render(renderer.GetRenderedMap(scene, { 0 }, stops)) == Render(renderer.GetRenderedMap(buses)));
+}
+
+void TestVectorTile(const Catalogue& catalogue, const RenderSettings& settings) {
+	const MapRenderer renderer(settings);
+	const auto buses = catalogue.GetSortedBuses();
+	const MapScene scene = renderer.MakeScene(buses);
+	const SphereProjector reference = MakeReferenceProjector(buses, settings);
+	const auto to_tile = [&settings](svg::Point point) {
+		return vector_tile::Point{
+			static_cast<int32_t>(std::lround(point.x / settings.width * VectorTileRenderer::EXTENT)),
+			static_cast<int32_t>(std::lround(point.y / settings.height * VectorTileRenderer::EXTENT))
+		};
+	};
+	const auto is_same = [](vector_tile::Point lhs, vector_tile::Point rhs) {
+		return lhs.x == rhs.x && lhs.y == rhs.y;
+	};
+
+	const auto data = VectorTileRenderer(renderer).GetTile(scene, 0, 0, 0);
+	CHECK(data.has_value());
+	const vector_tile::Tile tile = vector_tile::Decode(*data);
+	CHECK(tile.layers.size() == 2);
+
+	// маршруты по возрастанию названий, каждый - одна линия через все свои остановки
+	const auto& routes = tile.layers[0].features;
+	CHECK(routes.size() == buses.size());
+	auto bus = buses.begin();
+	for (const auto& feature : routes) {
+		CHECK(feature.attributes.front().second == vector_tile::Value{ std::string(bus->first) });
+		CHECK(feature.geometry.size() == 1);
+		// совпавшие после округления соседние точки в тайл не выводятся
+		std::vector<vector_tile::Point> expected;
+		for (const Stop* stop : bus->second->stops_ptr) {
+			const auto point = to_tile(reference(stop->coordinates));
+			if (expected.empty() || !is_same(expected.back(), point)) {
+				expected.push_back(point);
+			}
+		}
+		const auto& line = feature.geometry.front();
+		CHECK(line.size() == expected.size() && std::equal(line.begin(), line.end(), expected.begin(), is_same));
+		++bus;
+	}
+
+	const auto& stops = tile.layers[1].features;
+	CHECK(stops.size() == scene.GetStops().size());
+	for (const auto& feature : stops) {
+		const auto& name = std::get<std::string>(feature.attributes.front().second);
+		CHECK(is_same(feature.geometry.front().front(), to_tile(reference(catalogue.FindStop(name)->coordinates))));
+	}
+}
+
+} // namespace
+
+int main() {
+	// до первого параллельного участка: пул создается по этому числу потоков
+	parallel::SetThreadCount(THREAD_COUNT);
+	Catalogue catalogue;
+	FillCatalogue(catalogue, BUS_COUNT);
+	const RenderSettings settings = MakeSettings();
+	TestProjectedStops(catalogue, settings);
+	TestFragments(catalogue, settings);
+	TestLayerParts(catalogue, settings);
+	TestBusMap(settings);
+	TestVectorTile(catalogue, settings);
+	std::cout << "map_render_test OK" << std::endl;
+}
\ No newline at end of file
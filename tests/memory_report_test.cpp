@@ -0,0 +1,81 @@
+// Оценка памяти справочника сверяется со статистикой malloc из glibc (mallinfo2)
+#include "testing.h"
+
+#include "../transport_catalogue.h"
+
+#include <malloc.h>
+
+#include <cmath>
+#include <string>
+
+using namespace std::literals;
+using namespace transport_ctg;
+
+namespace {
+
+std::size_t AllocatedBytes() {
+	return mallinfo2().uordblks;
+}
+
+// оценка должна совпадать с занятой памятью с точностью до нескольких процентов:
+// модель приближенно считает, например, блоки деков и корзины хеш-таблиц
+void CheckReport(const Catalogue& catalogue, std::size_t allocated) {
+	const std::size_t reported = catalogue.GetMemoryReport().GetTotal();
+	std::cout << "reported " << reported << " allocated " << allocated << std::endl;
+	CHECK(std::abs(static_cast<double>(reported) - static_cast<double>(allocated)) < 0.03 * static_cast<double>(allocated));
+}
+
+// STOP_COUNT остановок, каждая связана с соседней расстоянием; маршрут проходит через ROUTE_LENGTH подряд идущих остановок
+constexpr int STOP_COUNT = 2000;
+constexpr int BUS_COUNT = 300;
+constexpr int ROUTE_LENGTH = 20;
+
+void FillCatalogue(Catalogue& catalogue, bool reserve) {
+	CatalogueBuilder builder(catalogue, reserve ? STOP_COUNT : 0, reserve ? BUS_COUNT : 0, reserve ? STOP_COUNT : 0);
+	std::vector<const Stop*> stops;
+	for (int i = 0; i < STOP_COUNT; ++i) {
+		const std::string name = "Stop number "s + std::to_string(i);
+		stops.push_back(builder.AddStop({ name, { 55.0 + i * 1e-3, 37.0 + (i % 50) * 1e-3 } }));
+	}
+	for (int i = 1; i < STOP_COUNT; ++i) {
+		builder.AddDistanceBetweenStops({ stops[i - 1], stops[i] }, 100 + i);
+	}
+	for (int i = 0; i < BUS_COUNT; ++i) {
+		const std::string name = "Bus "s + std::to_string(i);
+		Bus bus{ name, {}, true };
+		for (int j = 0; j < ROUTE_LENGTH; ++j) {
+			bus.stops_ptr.push_back(stops[(i * 7 + j) % STOP_COUNT]);
+		}
+		builder.AddBus(std::move(bus));
+	}
+	builder.Build();
+}
+
+void TestBuiltCatalogue(bool reserve) {
+	const std::size_t before = AllocatedBytes();
+	Catalogue catalogue;
+	FillCatalogue(catalogue, reserve);
+	CheckReport(catalogue, AllocatedBytes() - before);
+}
+
+// остановки и маршруты, замененные после построения, размещаются по одному, а блоки остаются
+void TestReplacedEntities() {
+	const std::size_t before = AllocatedBytes();
+	Catalogue catalogue;
+	FillCatalogue(catalogue, true);
+	for (int i = 0; i < STOP_COUNT; i += 10) {
+		const Stop* stop = catalogue.FindStop("Stop number "s + std::to_string(i));
+		catalogue.ReplaceStop({ stop->name, { stop->coordinates.lat + 1e-4, stop->coordinates.lng } });
+	}
+	catalogue.RemoveBus("Bus 1"sv);
+	CheckReport(catalogue, AllocatedBytes() - before);
+}
+
+} // namespace
+
+int main() {
+	TestBuiltCatalogue(true);
+	TestBuiltCatalogue(false);
+	TestReplacedEntities();
+	std::cout << "memory_report_test OK" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+// Поиск остановок рядом с точкой сверяется с полным перебором: сеть через 180-й меридиан,
+// далекие одиночные остановки, высокие широты и остановки, добавленные после построения
+#include "testing.h"
+
+#include "../spatial_index.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <string>
+
+using namespace std::literals;
+using namespace transport_ctg;
+
+namespace {
+
+class Network {
+public:
+	const Stop* Add(geo::Coordinates coordinates) {
+		names_.push_back("stop "s + std::to_string(names_.size()));
+		stops_.push_back({ names_.back(), coordinates });
+		pointers_.push_back(&stops_.back());
+		return pointers_.back();
+	}
+
+	const std::vector<const Stop*>& GetStops() const {
+		return pointers_;
+	}
+
+	// ответы полным перебором в том же порядке, что у индекса
+	std::vector<StopDistance> FindAll(geo::Coordinates point) const {
+		std::vector<StopDistance> result;
+		for (const Stop* stop : pointers_) {
+			result.push_back({ stop, geo::ComputeDistance(point, stop->coordinates) });
+		}
+		std::sort(result.begin(), result.end(), [](const StopDistance& lhs, const StopDistance& rhs) {
+			return lhs.distance != rhs.distance ? lhs.distance < rhs.distance : lhs.stop_ptr->name < rhs.stop_ptr->name;
+		});
+		return result;
+	}
+
+private:
+	std::deque<std::string> names_;
+	std::deque<Stop> stops_;
+	std::vector<const Stop*> pointers_;
+};
+
+bool IsSameStops(const std::vector<StopDistance>& lhs, const std::vector<StopDistance>& rhs) {
+	return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const StopDistance& l, const StopDistance& r) {
+		return l.stop_ptr == r.stop_ptr;
+	});
+}
+
+void CheckQueries(const Network& network, const StopsSpatialIndex& index, const std::vector<geo::Coordinates>& points) {
+	CHECK(index.GetStopCount() == network.GetStops().size());
+	for (const geo::Coordinates point : points) {
+		const auto all = network.FindAll(point);
+		for (const std::size_t count : { std::size_t{ 1 }, std::size_t{ 5 }, std::size_t{ 40 } }) {
+			const std::vector<StopDistance> expected(all.begin(), all.begin() + std::min(count, all.size()));
+			CHECK(IsSameStops(index.FindNearest(point, count), expected));
+		}
+		for (const double radius : { 500., 5'000., 50'000. }) {
+			std::vector<StopDistance> expected;
+			for (const auto& stop : all) {
+				if (stop.distance <= radius) {
+					expected.push_back(stop);
+				}
+			}
+			CHECK(IsSameStops(index.FindInRadius(point, radius), expected));
+		}
+	}
+}
+
+// count остановок в прямоугольнике вокруг center со сторонами span градусов
+void AddCluster(Network& network, std::mt19937& generator, geo::Coordinates center, double span, int count) {
+	std::uniform_real_distribution<double> offset(-span / 2., span / 2.);
+	for (int i = 0; i < count; ++i) {
+		double lng = center.lng + offset(generator);
+		lng = lng > 180. ? lng - 360. : (lng < -180. ? lng + 360. : lng);
+		network.Add({ center.lat + offset(generator), lng });
+	}
+}
+
+// остановки по обе стороны от 180-го меридиана ближе друг к другу, чем к остальной сети
+void TestAntimeridian() {
+	std::mt19937 generator(1);
+	Network network;
+	AddCluster(network, generator, { -17.8, 180. }, 0.6, 2000);
+	StopsSpatialIndex index;
+	index.Add(network.GetStops());
+	CheckQueries(network, index, { { -17.8, 179.999 }, { -17.8, -179.999 }, { -17.6, 179.7 }, { -18., -179.75 }, { -17.8, 178. } });
+}
+
+// город и несколько остановок на другом конце света
+void TestOutliers() {
+	std::mt19937 generator(2);
+	Network network;
+	AddCluster(network, generator, { 55.75, 37.6 }, 0.3, 3000);
+	network.Add({ -33.9, 151.2 });
+	network.Add({ -33.91, 151.21 });
+	network.Add({ 40.7, -74. });
+	StopsSpatialIndex index;
+	index.Add(network.GetStops());
+	// ячейки подобраны по городу: память сетки не растет до размеров земного шара
+	CHECK(index.GetMemoryUsage() < 1'000'000);
+	CheckQueries(network, index, { { 55.75, 37.6 }, { 55.7, 37.5 }, { -33.9, 151.2 }, { 40.7, -74.01 }, { 0., 0. } });
+}
+
+// ячейки по долготе расширяются к полюсу, поиск через полюс
+void TestHighLatitude() {
+	std::mt19937 generator(3);
+	Network network;
+	AddCluster(network, generator, { 78.2, 15.6 }, 1., 1500);
+	AddCluster(network, generator, { 89.8, 0. }, 0.3, 300);
+	AddCluster(network, generator, { 89.8, 180. }, 0.3, 300);
+	StopsSpatialIndex index;
+	index.Add(network.GetStops());
+	CheckQueries(network, index, { { 78.2, 15.6 }, { 78.6, 16.1 }, { 89.9, 90. }, { 89.95, -179. }, { 85., 15. } });
+}
+
+// остановки, добавленные по одной после построения, в том числе за границами сетки
+void TestIncrementalAdd() {
+	std::mt19937 generator(4);
+	Network network;
+	AddCluster(network, generator, { -17.8, 180. }, 0.6, 1500);
+	StopsSpatialIndex index;
+	index.Add(network.GetStops());
+	std::uniform_real_distribution<double> offset(-0.3, 0.3);
+	for (int i = 0; i < 100; ++i) {
+		const double lng = 179.9 + offset(generator);
+		index.Add(network.Add({ -17.8 + offset(generator), lng > 180. ? lng - 360. : lng }));
+		if (i % 10 == 0) {
+			index.Add(network.Add({ 10. + i, -170. + i }));
+		}
+	}
+	CheckQueries(network, index, { { -17.8, 179.9 }, { -17.9, -179.8 }, { 20., -160. }, { 50., -130. } });
+}
+
+} // namespace
+
+int main() {
+	TestAntimeridian();
+	TestOutliers();
+	TestHighLatitude();
+	TestIncrementalAdd();
+	std::cout << "spatial_index_test OK" << std::endl;
+}
\ No newline at end of file
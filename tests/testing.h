@@ -0,0 +1,24 @@
+#pragma once
+// Минимальные средства для тестов: каждый тест - отдельная программа со своей функцией main,
+// собирается вместе с исходниками справочника (см. README) и возвращает 1, если проверка не прошла
+#include <cstdlib>
+#include <iostream>
+
+#define CHECK(expr)                                                               \
+	do {                                                                          \
+		if (!(expr)) {                                                            \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": CHECK failed: " #expr "\n"; \
+			std::exit(1);                                                         \
+		}                                                                         \
+	} while (false)
+
+// выбрасывает ли function() исключение типа Exception
+template <typename Exception, typename Function>
+bool Throws(Function function) {
+	try {
+		function();
+	} catch (const Exception&) {
+		return true;
+	}
+	return false;
+}
\ No newline at end of file
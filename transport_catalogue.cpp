@@ -2,10 +2,13 @@
 #include "geo.h"
 #include "domain.h"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <iomanip>
 #include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -13,39 +16,67 @@
 namespace transport_ctg {
 using namespace std::literals;
 
-void Catalogue::AddStop(Stop stop) {
-	stops_.push_back(stop);
-	stopname_to_stop_.insert({ stop.name, &stops_.back() });
+namespace {
+
+// объект, размещенный вне блоков CatalogueBuilder, вместе с собственной копией названия
+template <typename T>
+struct Owned {
+	std::string name;
+	T item;
+};
 
-	static std::set<std::string_view> empty_bus;
-	stop_to_buses_.insert({ stopname_to_stop_[stop.name], empty_bus });
+// копия item, которая владеет своим названием; название, на которое ссылался item, может быть
+// временной строкой или названием объекта, разделяемого с другой версией справочника
+template <typename T>
+std::shared_ptr<const T> MakeOwned(T item) {
+	auto owned = std::make_shared<Owned<T>>();
+	owned->name.assign(item.name);
+	owned->item = std::move(item);
+	owned->item.name = owned->name;
+	return std::shared_ptr<const T>(owned, &owned->item);
 }
 
-Stop* Catalogue::FindStop(const std::string_view stop_name) const {
-	if (stopname_to_stop_.empty() || !stopname_to_stop_.count(stop_name)) {
-		return nullptr;
+} // namespace
+
+void Catalogue::AddStop(Stop stop) {
+	if (stopname_to_stop_.count(stop.name)) {
+		throw std::invalid_argument("stop "s + std::string(stop.name) + " already exists"s);
 	}
-	return stopname_to_stop_.at(stop_name);
+	stop.id = static_cast<StopId>(stops_.size());
+	stop_trig_.push_back(geo::PrecomputeTrig(stop.coordinates));
+	stops_.push_back(MakeOwned(std::move(stop)));
+	const Stop* stop_ptr = stops_.back().get();
+	stopname_to_stop_.insert({ stop_ptr->name, stop_ptr });
+	stops_index_.Add(stop_ptr);
+	stop_to_buses_.emplace(stop_ptr, std::set<std::string_view>{});
 }
 
-void Catalogue::AddBus(const Bus bus) {
-	buses_.push_back(bus);
+const Stop* Catalogue::FindStop(const std::string_view stop_name) const {
+	const auto it = stopname_to_stop_.find(stop_name);
+	return it == stopname_to_stop_.end() ? nullptr : it->second;
+}
+
+void Catalogue::AddBus(Bus bus) {
+	if (busname_to_bus_.count(bus.name)) {
+		throw std::invalid_argument("bus "s + std::string(bus.name) + " already exists"s);
+	}
+	CheckBusStops(bus);
+	buses_.push_back(MakeOwned(std::move(bus)));
+	const Bus* bus_ptr = buses_.back().get();
 
-	for (const auto& stop : bus.stops_ptr) {
+	for (const auto& stop : bus_ptr->stops_ptr) {
 		// создаем список уникальных остановок маршрута
-		unique_stops_[&buses_.back()].insert(stop);
+		unique_stops_[bus_ptr].insert(stop);
 		// вносим маршрут, проезжающий через остановку
-		stop_to_buses_[stop].insert(bus.name);
+		stop_to_buses_[stop].insert(bus_ptr->name);
 	}
 	// хеш-таблица маршрут - адрес структуры
-	busname_to_bus_.insert({ bus.name, &buses_.back() });
+	busname_to_bus_.insert({ bus_ptr->name, bus_ptr });
 }
 
-Bus* Catalogue::FindBus(const std::string_view bus_name) const {
-	if (busname_to_bus_.empty() || !busname_to_bus_.count(bus_name)) {
-		return nullptr;
-	}
-	return busname_to_bus_.at(bus_name);
+const Bus* Catalogue::FindBus(const std::string_view bus_name) const {
+	const auto it = busname_to_bus_.find(bus_name);
+	return it == busname_to_bus_.end() ? nullptr : it->second;
 }
 
 BusInfo Catalogue::GetBusInfo(const std::string_view bus_name) const {
@@ -53,23 +84,17 @@ BusInfo Catalogue::GetBusInfo(const std::string_view bus_name) const {
 
 	// проверка наличия автобуса в базе
 	if (!busname_to_bus_.count(bus_name)) {
-		static BusInfo empty_info;
-		return empty_info;
+		return info;
 	}
 	const auto bus_ptr = busname_to_bus_.at(bus_name);
 	info.bus_ptr = bus_ptr;
 	info.stops_on_route = bus_ptr->stops_ptr.size();
 
 	// Расчитываем расстояние между остановками
-	Stop* prev_stop = nullptr;
-	for (const auto& stop : bus_ptr->stops_ptr) {
-		if (prev_stop) {
-			info.coordinate_length += geo::ComputeDistance(
-				prev_stop->coordinates, stop->coordinates
-			);
-			info.route_length += static_cast<double>(GetDistanceBetweenStops({ prev_stop, stop }));
-		}
-		prev_stop = stop;
+	const auto& stops = bus_ptr->stops_ptr;
+	for (size_t i = 1; i < stops.size(); ++i) {
+		info.coordinate_length += ComputeDistance(stops[i - 1]->id, stops[i]->id);
+		info.route_length += static_cast<double>(GetDistanceBetweenStops({ stops[i - 1], stops[i] }));
 	}
 
 	info.unique_stops = unique_stops_.at(bus_ptr).size();
@@ -77,43 +102,177 @@ BusInfo Catalogue::GetBusInfo(const std::string_view bus_name) const {
 	return info;
 }
 
-std::set<std::string_view> Catalogue::GetBusesForStop(std::string_view stop_name) const {
+const std::set<std::string_view>& Catalogue::GetBusesForStop(std::string_view stop_name) const {
+	static const std::set<std::string_view> no_buses;
 	const auto stop_ptr = stopname_to_stop_.at(stop_name);
-	if (!stop_to_buses_.count(stop_ptr)) {
-		static std::set<std::string_view> empty_buses;
-		return empty_buses;
+	const auto it = stop_to_buses_.find(stop_ptr);
+	return it == stop_to_buses_.end() ? no_buses : it->second;
+}
+
+void Catalogue::ReplaceStop(Stop stop) {
+	const Stop* old_stop = FindStop(stop.name);
+	if (!old_stop) {
+		throw std::invalid_argument("stop "s + std::string(stop.name) + " not found"s);
 	}
-	return stop_to_buses_.at(stop_ptr);
+	stop.id = old_stop->id;
+	stop_trig_[stop.id] = geo::PrecomputeTrig(stop.coordinates);
+	ReplaceStopPointer(old_stop, MakeOwned(std::move(stop)));
+	RebuildIndexes();
 }
 
-std::size_t Catalogue::HasherStops::operator() (const std::pair<Stop*, Stop*>& stops) const {
-	std::hash<const Stop*> stop_hash;
-	return stop_hash(stops.first) + static_cast<std::size_t>(37 * 10000) * stop_hash(stops.second);
+// номера остановок остаются плотными: на место удаленной переносится копия последней
+void Catalogue::RemoveStop(std::string_view stop_name) {
+	const Stop* stop = FindStop(stop_name);
+	if (!stop) {
+		throw std::invalid_argument("stop "s + std::string(stop_name) + " not found"s);
+	}
+	if (!stop_to_buses_.at(stop).empty()) {
+		throw std::invalid_argument("stop "s + std::string(stop_name) + " is used by buses"s);
+	}
+	for (auto it = stop_distance_.begin(); it != stop_distance_.end();) {
+		it = it->first.first == stop || it->first.second == stop ? stop_distance_.erase(it) : std::next(it);
+	}
+	stopname_to_stop_.erase(stop->name);
+
+	const StopId id = stop->id;
+	const Stop* last = stops_.back().get();
+	if (last != stop) {
+		Stop moved = *last;
+		moved.id = id;
+		stop_trig_[id] = stop_trig_.back();
+		ReplaceStopPointer(last, MakeOwned(std::move(moved)));
+	}
+	stops_.pop_back();
+	stop_trig_.pop_back();
+	RebuildIndexes();
 }
 
-void Catalogue::AddDistanceBetweenStops(const std::pair<Stop*, Stop*> stops, const uint32_t distance) {
-	HasherStops hasher;
-	if (!stop_distance_.count(hasher(stops))) {
-		stop_distance_.insert({ hasher(stops), distance });
-	} else {
-		stop_distance_[hasher(stops)] = distance;
+void Catalogue::ReplaceBus(Bus bus) {
+	const Bus* old_bus = FindBus(bus.name);
+	if (!old_bus) {
+		throw std::invalid_argument("bus "s + std::string(bus.name) + " not found"s);
 	}
+	CheckBusStops(bus);
+	auto& slot = *std::find_if(buses_.begin(), buses_.end(), [old_bus](const auto& item) {
+		return item.get() == old_bus;
+	});
+	// ключ индекса ссылается на название старого маршрута, поэтому заменяется вместе со значением
+	busname_to_bus_.erase(old_bus->name);
+	slot = MakeOwned(std::move(bus));
+	busname_to_bus_.emplace(slot->name, slot.get());
+	RebuildIndexes();
 }
 
-uint32_t Catalogue::GetDistanceBetweenStops(const std::pair<Stop*, Stop*> stops) const {
-	HasherStops hasher;
-	// ищем остановки в обратном поярдке B - A
-	if (!stop_distance_.count(hasher(stops))) {
-		// возвращаем 0, если не задано расстояние
-		if (!stop_distance_.count(hasher({ stops.second, stops.first }))) {
-			return 0;
-		} else {
-			return stop_distance_.at(hasher({ stops.second, stops.first }));
+void Catalogue::RemoveBus(std::string_view bus_name) {
+	const Bus* bus = FindBus(bus_name);
+	if (!bus) {
+		throw std::invalid_argument("bus "s + std::string(bus_name) + " not found"s);
+	}
+	busname_to_bus_.erase(bus->name);
+	buses_.erase(std::find_if(buses_.begin(), buses_.end(), [bus](const auto& item) {
+		return item.get() == bus;
+	}));
+	RebuildIndexes();
+}
+
+void Catalogue::CheckBusStops(const Bus& bus) const {
+	for (const Stop* stop : bus.stops_ptr) {
+		if (!stop || stop_to_buses_.count(stop) == 0) {
+			throw std::invalid_argument("bus "s + std::string(bus.name) + " has a stop missing from the catalogue"s);
+		}
+	}
+}
+
+void Catalogue::ReplaceStopPointer(const Stop* old_stop, std::shared_ptr<const Stop> replacement) {
+	const Stop* new_stop = replacement.get();
+	// ключи индексов ссылаются на названия старых объектов, поэтому заменяются вместе со значениями
+	stopname_to_stop_.erase(old_stop->name);
+	stopname_to_stop_.emplace(new_stop->name, new_stop);
+	stops_[new_stop->id] = std::move(replacement);
+
+	for (auto& bus : buses_) {
+		if (std::find(bus->stops_ptr.begin(), bus->stops_ptr.end(), old_stop) == bus->stops_ptr.end()) {
+			continue;
 		}
-	}// Ищем остановки A - B
-	else {
-		return stop_distance_.at(hasher(stops));
+		Bus copy = *bus;
+		std::replace(copy.stops_ptr.begin(), copy.stops_ptr.end(), old_stop, new_stop);
+		busname_to_bus_.erase(bus->name);
+		bus = MakeOwned(std::move(copy));
+		busname_to_bus_.emplace(bus->name, bus.get());
 	}
+
+	std::vector<std::pair<std::pair<const Stop*, const Stop*>, uint32_t>> moved;
+	for (auto it = stop_distance_.begin(); it != stop_distance_.end();) {
+		if (it->first.first != old_stop && it->first.second != old_stop) {
+			++it;
+			continue;
+		}
+		std::pair<const Stop*, const Stop*> stops = it->first;
+		const uint32_t distance = it->second;
+		stops.first = stops.first == old_stop ? new_stop : stops.first;
+		stops.second = stops.second == old_stop ? new_stop : stops.second;
+		moved.push_back({ stops, distance });
+		it = stop_distance_.erase(it);
+	}
+	stop_distance_.insert(moved.begin(), moved.end());
+}
+
+// маршруты обходятся в алфавитном порядке, как в CatalogueBuilder::Build
+void Catalogue::RebuildIndexes() {
+	unique_stops_.clear();
+	stop_to_buses_.clear();
+	std::vector<const Stop*> stops;
+	stops.reserve(stops_.size());
+	for (const auto& stop : stops_) {
+		stop_to_buses_.emplace(stop.get(), std::set<std::string_view>{});
+		stops.push_back(stop.get());
+	}
+	for (const auto& [busname, bus] : GetSortedBuses()) {
+		unique_stops_.emplace(bus, std::unordered_set<const Stop*>(bus->stops_ptr.begin(), bus->stops_ptr.end()));
+		for (const Stop* stop : bus->stops_ptr) {
+			auto& buses = stop_to_buses_[stop];
+			buses.emplace_hint(buses.end(), busname);
+		}
+	}
+	stops_index_ = StopsSpatialIndex();
+	stops_index_.Add(stops);
+}
+
+std::vector<StopDistance> Catalogue::GetNearestStops(geo::Coordinates point, std::size_t count) const {
+	return stops_index_.FindNearest(point, count);
+}
+
+std::vector<StopDistance> Catalogue::GetStopsInRadius(geo::Coordinates point, double radius) const {
+	return stops_index_.FindInRadius(point, radius);
+}
+
+std::size_t Catalogue::HasherStops::operator() (const std::pair<const Stop*, const Stop*>& stops) const {
+	std::hash<const Stop*> stop_hash;
+	return stop_hash(stops.first) + static_cast<std::size_t>(37 * 10000) * stop_hash(stops.second);
+}
+
+void Catalogue::AddDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops, const uint32_t distance) {
+	stop_distance_[stops] = distance;
+}
+
+double Catalogue::ComputeDistance(StopId from, StopId to) const {
+	return geo::ComputeDistance(stop_trig_[from], stop_trig_[to]);
+}
+
+uint32_t Catalogue::GetDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops) const {
+	// Ищем остановки A - B
+	auto it = stop_distance_.find(stops);
+	if (it != stop_distance_.end()) {
+		return it->second;
+	}
+	// ищем остановки в обратном поярдке B - A
+	it = stop_distance_.find({ stops.second, stops.first });
+	// возвращаем 0, если не задано расстояние
+	return it == stop_distance_.end() ? 0 : it->second;
+}
+
+const Catalogue::DistanceTable& Catalogue::GetDistanceTable() const {
+	return stop_distance_;
 }
 
 int Catalogue::GetStopCount() const {
@@ -124,19 +283,243 @@ int Catalogue::GetBusCount() const {
 	return static_cast<int>(buses_.size());
 }
 
-const std::map<std::string_view, Bus*> Catalogue::GetSortedBuses() const {
-	std::map<std::string_view, Bus*> sorted_buses;
+const std::map<std::string_view, const Bus*> Catalogue::GetSortedBuses() const {
+	std::map<std::string_view, const Bus*> sorted_buses;
 	for (const auto& bus : busname_to_bus_) {
 		sorted_buses.emplace(bus);
 	}
 	return sorted_buses;
 }
 
-const std::map<std::string_view, Stop*> Catalogue::GetSortedStops() const {
-	std::map<std::string_view, Stop*> sorted_stops;
+const std::map<std::string_view, const Stop*> Catalogue::GetSortedStops() const {
+	std::map<std::string_view, const Stop*> sorted_stops;
 	for (const auto& stop : stopname_to_stop_) {
 		sorted_stops.emplace(stop);
 	}
 	return sorted_stops;
 }
+
+void Catalogue::Reserve(std::size_t stop_count, std::size_t bus_count, std::size_t distance_count) {
+	stops_.reserve(stops_.size() + stop_count);
+	stop_trig_.reserve(stop_trig_.size() + stop_count);
+	buses_.reserve(buses_.size() + bus_count);
+	stopname_to_stop_.reserve(stopname_to_stop_.size() + stop_count);
+	busname_to_bus_.reserve(busname_to_bus_.size() + bus_count);
+	unique_stops_.reserve(unique_stops_.size() + bus_count);
+	stop_to_buses_.reserve(stop_to_buses_.size() + stop_count);
+	stop_distance_.reserve(stop_distance_.size() + distance_count);
+	stops_index_.Reserve(stops_.size() + stop_count);
+}
+
+namespace {
+
+// лежит ли объект в одном из блоков CatalogueBuilder
+template <typename T, typename Block>
+bool IsInBlocks(const T* item, const std::vector<std::shared_ptr<const Block>>& blocks) {
+	const std::less<const T*> less;
+	return std::any_of(blocks.begin(), blocks.end(), [item, &less](const auto& block) {
+		const auto& items = block->items;
+		return !items.empty() && !less(item, items.data()) && less(item, items.data() + items.size());
+	});
+}
+
+// объекты вне блоков и их названия; названия длиннее буфера строки размещены в куче
+template <typename T, typename Block>
+std::pair<std::size_t, std::size_t> OwnedBytes(const std::vector<std::shared_ptr<const T>>& items, const std::vector<std::shared_ptr<const Block>>& blocks,
+	std::size_t control_block) {
+	std::pair<std::size_t, std::size_t> bytes{ 0, 0 };
+	for (const auto& item : items) {
+		if (!IsInBlocks(item.get(), blocks)) {
+			bytes.first += memory::HeapBlock(control_block + sizeof(Owned<T>));
+			bytes.second += memory::StringBytes(item->name.size());
+		}
+	}
+	return bytes;
+}
+
+} // namespace
+
+memory::MemoryReport Catalogue::GetMemoryReport() const {
+	using namespace memory;
+	// std::make_shared размещает объект одним блоком со счетчиками ссылок
+	// (указатель на таблицу виртуальных функций и два счетчика)
+	constexpr std::size_t control_block = 2 * sizeof(void*);
+
+	MemoryReport report;
+	// блок CatalogueBuilder - объект блока вместе со счетчиками плюс буфер вектора на всю его емкость,
+	// объекты вне блоков размещены по одному вместе со своими названиями (добавлены или заменены после построения);
+	// названия из блоков считаются для всех объектов блока, включая замененные
+	std::size_t names_bytes = 0;
+	std::size_t stops_bytes = Bytes(stops_) + Bytes(stop_blocks_);
+	for (const auto& block : stop_blocks_) {
+		stops_bytes += HeapBlock(control_block + sizeof(*block)) + Bytes(block->items);
+		names_bytes += DeepBytes(block->names);
+	}
+	const auto [owned_stops, owned_stop_names] = OwnedBytes(stops_, stop_blocks_, control_block);
+	report.Add("stops"s, stops_bytes + owned_stops);
+	report.Add("stop_trig"s, Bytes(stop_trig_));
+
+	// списки остановок маршрутов из блоков считаются для всех маршрутов блока, включая замененные
+	std::size_t buses_bytes = Bytes(buses_) + Bytes(bus_blocks_);
+	for (const auto& block : bus_blocks_) {
+		buses_bytes += HeapBlock(control_block + sizeof(*block)) + Bytes(block->items);
+		names_bytes += DeepBytes(block->names);
+		for (const Bus& bus : block->items) {
+			buses_bytes += Bytes(bus.stops_ptr);
+		}
+	}
+	for (const auto& bus : buses_) {
+		if (!IsInBlocks(bus.get(), bus_blocks_)) {
+			buses_bytes += Bytes(bus->stops_ptr);
+		}
+	}
+	const auto [owned_buses, owned_bus_names] = OwnedBytes(buses_, bus_blocks_, control_block);
+	report.Add("buses"s, buses_bytes + owned_buses);
+	report.Add("names"s, names_bytes + owned_stop_names + owned_bus_names);
+	report.Add("stopname_to_stop"s, Bytes(stopname_to_stop_));
+	report.Add("busname_to_bus"s, Bytes(busname_to_bus_));
+	report.Add("unique_stops"s, DeepValueBytes(unique_stops_));
+	report.Add("stop_to_buses"s, DeepValueBytes(stop_to_buses_));
+	report.Add("stop_distance"s, Bytes(stop_distance_));
+	report.Add("stops_index"s, stops_index_.GetMemoryUsage());
+	return report;
+}
+
+uint64_t Catalogue::GetVersion() const {
+	return version_;
+}
+
+// ------ CatalogueBuilder ------
+namespace {
+// размер блока, если количество объектов не было известно заранее
+const std::size_t MIN_BLOCK_SIZE = 64;
+
+// размещает объект с копией его названия в общем блоке, объект разделяет с блоком счетчик ссылок;
+// заполненный блок заменяется новым вдвое большего размера, старый остается в списке блоков справочника
+template <typename T>
+std::shared_ptr<T> PlaceInBlock(std::shared_ptr<EntityBlock<T>>& block, std::vector<std::shared_ptr<const EntityBlock<T>>>& blocks, T value) {
+	if (block->items.size() == block->items.capacity()) {
+		auto next_block = std::make_shared<EntityBlock<T>>();
+		next_block->items.reserve(std::max(MIN_BLOCK_SIZE, block->items.capacity() * 2));
+		block = std::move(next_block);
+	}
+	if (block->items.empty()) {
+		blocks.push_back(block);
+	}
+	value.name = block->names.emplace_back(value.name);
+	block->items.push_back(std::move(value));
+	return std::shared_ptr<T>(block, &block->items.back());
+}
+} // namespace
+
+CatalogueBuilder::CatalogueBuilder(Catalogue& catalogue, std::size_t stop_count, std::size_t bus_count, std::size_t distance_count)
+	: catalogue_(catalogue)
+	, stops_block_(std::make_shared<EntityBlock<Stop>>())
+	, buses_block_(std::make_shared<EntityBlock<Bus>>())
+	, first_stop_(catalogue.stops_.size())
+	, first_bus_(catalogue.buses_.size()) {
+	catalogue_.Reserve(stop_count, bus_count, distance_count);
+	stops_block_->items.reserve(stop_count);
+	buses_block_->items.reserve(bus_count);
+}
+
+const Stop* CatalogueBuilder::AddStop(Stop stop) {
+	if (catalogue_.stopname_to_stop_.count(stop.name)) {
+		throw std::invalid_argument("stop "s + std::string(stop.name) + " already exists"s);
+	}
+	auto& stops = catalogue_.stops_;
+	stop.id = static_cast<StopId>(stops.size());
+	catalogue_.stop_trig_.push_back(geo::PrecomputeTrig(stop.coordinates));
+	stops.push_back(PlaceInBlock(stops_block_, catalogue_.stop_blocks_, stop));
+	const Stop* stop_ptr = stops.back().get();
+	catalogue_.stopname_to_stop_.emplace(stop_ptr->name, stop_ptr);
+	return stop_ptr;
+}
+
+const Stop* CatalogueBuilder::FindStop(std::string_view stop_name) const {
+	return catalogue_.FindStop(stop_name);
+}
+
+void CatalogueBuilder::AddDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops, const uint32_t distance) {
+	catalogue_.AddDistanceBetweenStops(stops, distance);
+}
+
+const Bus* CatalogueBuilder::AddBus(Bus bus) {
+	if (catalogue_.busname_to_bus_.count(bus.name)) {
+		throw std::invalid_argument("bus "s + std::string(bus.name) + " already exists"s);
+	}
+	auto& buses = catalogue_.buses_;
+	buses.push_back(PlaceInBlock(buses_block_, catalogue_.bus_blocks_, std::move(bus)));
+	const Bus* bus_ptr = buses.back().get();
+	catalogue_.busname_to_bus_.emplace(bus_ptr->name, bus_ptr);
+	return bus_ptr;
+}
+
+void CatalogueBuilder::Build() {
+	if (is_built_) {
+		return;
+	}
+	is_built_ = true;
+
+	std::vector<const Stop*> new_stops;
+	new_stops.reserve(catalogue_.stops_.size() - first_stop_);
+	for (std::size_t i = first_stop_; i < catalogue_.stops_.size(); ++i) {
+		const Stop* stop_ptr = catalogue_.stops_[i].get();
+		catalogue_.stop_to_buses_.emplace(stop_ptr, std::set<std::string_view>{});
+		new_stops.push_back(stop_ptr);
+	}
+	catalogue_.stops_index_.Add(new_stops);
+
+	// маршруты обходятся в алфавитном порядке, поэтому имя всегда добавляется в конец списка остановки
+	std::vector<const Bus*> new_buses;
+	new_buses.reserve(catalogue_.buses_.size() - first_bus_);
+	for (std::size_t i = first_bus_; i < catalogue_.buses_.size(); ++i) {
+		new_buses.push_back(catalogue_.buses_[i].get());
+	}
+	std::sort(new_buses.begin(), new_buses.end(), [](const Bus* lhs, const Bus* rhs) {
+		return lhs->name < rhs->name;
+	});
+	for (const Bus* bus_ptr : new_buses) {
+		catalogue_.unique_stops_.emplace(bus_ptr,
+			std::unordered_set<const Stop*>(bus_ptr->stops_ptr.begin(), bus_ptr->stops_ptr.end()));
+		for (const Stop* stop : bus_ptr->stops_ptr) {
+			auto& buses = catalogue_.stop_to_buses_[stop];
+			buses.emplace_hint(buses.end(), bus_ptr->name);
+		}
+	}
+}
+
+// ------ CatalogueHandle ------
+CatalogueHandle::CatalogueHandle()
+	: current_(std::make_shared<const Catalogue>()) {
+}
+
+CatalogueHandle::CatalogueHandle(Catalogue catalogue)
+	: current_(std::make_shared<const Catalogue>(std::move(catalogue))) {
+}
+
+CatalogueHandle::CatalogueHandle(Version version)
+	: current_(std::move(version)) {
+}
+
+CatalogueHandle::Version CatalogueHandle::NonOwning(const Catalogue& catalogue) {
+	// пустой deleter: справочник принадлежит вызывающему коду
+	return Version(&catalogue, [](const Catalogue*) {});
+}
+
+CatalogueHandle::Version CatalogueHandle::Pin() const {
+	return std::atomic_load(&current_);
+}
+
+CatalogueHandle::Version CatalogueHandle::Publish(Catalogue catalogue) {
+	std::lock_guard guard(writer_mutex_);
+	return PublishLocked(std::make_shared<Catalogue>(std::move(catalogue)));
+}
+
+CatalogueHandle::Version CatalogueHandle::PublishLocked(std::shared_ptr<Catalogue> next) {
+	next->version_ = Pin()->version_ + 1;
+	Version published = std::move(next);
+	std::atomic_store(&current_, published);
+	return published;
+}
 } // end of namespace transport_ctg
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 #include "domain.h"
+#include "memory_report.h"
+#include "spatial_index.h"
 
+#include <cstdint>
 #include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
@@ -12,57 +18,199 @@
 
 namespace transport_ctg {
 
+	// блок, в котором CatalogueBuilder размещает остановки или маршруты вместе с их названиями
+	template <typename T>
+	struct EntityBlock {
+		std::vector<T> items;
+		std::deque<std::string> names;
+	};
+
 	class Catalogue {
 	public:
+		struct HasherStops {
+			std::size_t operator() (const std::pair<const Stop*, const Stop*>& StopPtrPair) const;
+		};
+		// расстояния по дорогам между парами остановок (с учетом направления)
+		using DistanceTable = std::unordered_map<std::pair<const Stop*, const Stop*>, uint32_t, HasherStops>;
 
 		int GetStopCount() const;
 		int GetBusCount() const;
-		// добавление остановки в базу
+		// добавление остановки в базу, остановка с таким названием не должна существовать;
+		// справочник хранит собственную копию названия, поэтому stop.name может ссылаться на временную строку
 		// Stop X: latitude, longitude
 		void AddStop(Stop stop);
 		// поиск остановки по имени
-		Stop* FindStop(const std::string_view stop_name) const;
+		const Stop* FindStop(const std::string_view stop_name) const;
 
-		// добавление маршрута в базу
+		// добавление маршрута в базу, все его остановки уже должны быть в справочнике;
+		// название копируется, как в AddStop
 		// Bus X: stop1>stop2>...>stopN>stop1 (кольцевой маршрут)
 		// Bus X: stop1-stop2-...-stopN (обычный маршрут)
-		void AddBus(const Bus bus);
+		void AddBus(Bus bus);
 
 		// поиск маршрута по имени
-		Bus* FindBus(const std::string_view bus_name) const;
+		const Bus* FindBus(const std::string_view bus_name) const;
 
 		// получение информации о маршруте
 		// Bus X: R stops on route, U unique stops, L route length
 		BusInfo GetBusInfo(const std::string_view bus_name) const;
 
-		// метод для получения списка автобусов по остановке
-		std::set<std::string_view> GetBusesForStop(std::string_view stop_name) const;
+		// метод для получения списка автобусов по остановке; список строится при добавлении маршрутов
+		// и живет, пока не изменится справочник
+		const std::set<std::string_view>& GetBusesForStop(std::string_view stop_name) const;
+
+		// Изменение справочника, например версии, которую готовит CatalogueHandle::Update.
+		// Остановки и маршруты, общие с другими версиями, не изменяются: измененный объект
+		// заменяется копией, а маршруты, проходящие через замененную остановку, копируются
+		// с новыми указателями. Вторичные индексы после изменения перестраиваются целиком.
+		// При ошибке выбрасывается std::invalid_argument, справочник не изменяется
+
+		// заменяет координаты существующей остановки, номер и название сохраняются
+		void ReplaceStop(Stop stop);
+		// удаляет остановку, через которую не проходит ни один маршрут, вместе с расстояниями до нее
+		void RemoveStop(std::string_view stop_name);
+		// заменяет остановки существующего маршрута
+		void ReplaceBus(Bus bus);
+		void RemoveBus(std::string_view bus_name);
 
 		// метода задания дистанции между остановками
-		void AddDistanceBetweenStops(const std::pair<Stop*, Stop*> stops, const uint32_t distance);
+		void AddDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops, const uint32_t distance);
+
+		// расстояние по прямой между остановками по заранее посчитанной тригонометрии
+		double ComputeDistance(StopId from, StopId to) const;
 
 		// получение дистанции между остановками
-		uint32_t GetDistanceBetweenStops(const std::pair<Stop*, Stop*> stops) const;
+		uint32_t GetDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops) const;
+		// все заданные расстояния между остановками
+		const DistanceTable& GetDistanceTable() const;
+
+		// count ближайших к точке остановок в порядке возрастания расстояния
+		std::vector<StopDistance> GetNearestStops(geo::Coordinates point, std::size_t count) const;
+		// остановки не дальше radius метров от точки в порядке возрастания расстояния
+		std::vector<StopDistance> GetStopsInRadius(geo::Coordinates point, double radius) const;
+
+		const std::map<std::string_view, const Bus*> GetSortedBuses() const;
+		const std::map<std::string_view, const Stop*> GetSortedStops() const;
 
-		const std::map<std::string_view, Bus*> GetSortedBuses() const;
-		const std::map<std::string_view, Stop*> GetSortedStops() const;
+		// номер версии, опубликованной через CatalogueHandle (0 - справочник не публиковался)
+		uint64_t GetVersion() const;
+
+		// резервирует место под заданное количество остановок, маршрутов и расстояний
+		void Reserve(std::size_t stop_count, std::size_t bus_count, std::size_t distance_count = 0);
+
+		// оценка памяти, занятой каждой внутренней структурой справочника
+		memory::MemoryReport GetMemoryReport() const;
 
 	private:
-		std::deque<Stop> stops_;
-		std::deque<Bus> buses_;
+		friend class CatalogueHandle;
+		friend class CatalogueBuilder;
+
+		// остановки и маршруты хранятся в отдельных блоках памяти вместе со своими названиями,
+		// поэтому копия справочника разделяет с оригиналом все неизмененные объекты, указатели
+		// и названия остаются валидными, а название удаленного объекта освобождается вместе с ним
+		std::vector<std::shared_ptr<const Stop>> stops_;
+		std::vector<std::shared_ptr<const Bus>> buses_;
+		// блоки, в которых CatalogueBuilder разместил остановки и маршруты; блок живет, пока жива
+		// хоть одна версия справочника, построенная от него, даже если его объекты уже заменены.
+		// После построения блоки не изменяются
+		std::vector<std::shared_ptr<const EntityBlock<Stop>>> stop_blocks_;
+		std::vector<std::shared_ptr<const EntityBlock<Bus>>> bus_blocks_;
+		// синус и косинус широты остановок, индекс - Stop::id
+		std::vector<geo::TrigCoordinates> stop_trig_;
+		uint64_t version_ = 0;
 		// хеш-таблица название-указатель остановки
-		std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
+		std::unordered_map<std::string_view, const Stop*> stopname_to_stop_;
 		// хеш-таблица название-указатель маршрута
-		std::unordered_map<std::string_view, Bus*> busname_to_bus_;
+		std::unordered_map<std::string_view, const Bus*> busname_to_bus_;
 		// список уникальных остановок маршрута
-		std::unordered_map<Bus*, std::unordered_set<Stop*>> unique_stops_;
+		std::unordered_map<const Bus*, std::unordered_set<const Stop*>> unique_stops_;
 		// список автобусов для остановки
-		std::unordered_map<Stop*, std::set<std::string_view>> stop_to_buses_;
+		std::unordered_map<const Stop*, std::set<std::string_view>> stop_to_buses_;
 		// таблица расстояний между остановками
-		std::unordered_map<std::size_t, uint32_t> stop_distance_;
+		DistanceTable stop_distance_;
+		// сетка для поиска остановок по координатам
+		StopsSpatialIndex stops_index_;
 
-		struct HasherStops {
-			std::size_t operator() (const std::pair<Stop*, Stop*>& StopPtrPair) const;
-		};
+		// проверяет, что остановки маршрута есть в справочнике
+		void CheckBusStops(const Bus& bus) const;
+		// ставит остановку replacement на место old_stop: в список остановок, индекс названий,
+		// копии маршрутов через old_stop и ключи таблицы расстояний
+		void ReplaceStopPointer(const Stop* old_stop, std::shared_ptr<const Stop> replacement);
+		// перестраивает автобусы по остановкам, уникальные остановки маршрутов и сетку координат
+		void RebuildIndexes();
 	}; // end of class Catalogue
+
+	// Пакетное наполнение справочника. Если количество остановок и маршрутов известно заранее,
+	// все таблицы резервируются сразу (иначе блоки растут по мере добавления), остановки и маршруты
+	// размещаются с копиями названий в общих блоках памяти, а вторичные индексы (автобусы по остановке, уникальные остановки маршрута,
+	// сетка координат) строятся одним проходом в Build(), когда все данные уже добавлены.
+	// До вызова Build() справочником можно пользоваться только через методы построителя.
+	class CatalogueBuilder {
+	public:
+		CatalogueBuilder(Catalogue& catalogue, std::size_t stop_count, std::size_t bus_count, std::size_t distance_count = 0);
+
+		const Stop* AddStop(Stop stop);
+		const Stop* FindStop(std::string_view stop_name) const;
+		void AddDistanceBetweenStops(const std::pair<const Stop*, const Stop*> stops, const uint32_t distance);
+		// остановки маршрута уже должны быть добавлены
+		const Bus* AddBus(Bus bus);
+
+		// строит вторичные индексы справочника
+		void Build();
+
+	private:
+		Catalogue& catalogue_;
+		// общие блоки памяти для остановок и маршрутов, их элементы и названия не перемещаются
+		std::shared_ptr<EntityBlock<Stop>> stops_block_;
+		std::shared_ptr<EntityBlock<Bus>> buses_block_;
+		// первые индексы остановок и маршрутов, добавленных этим построителем
+		std::size_t first_stop_ = 0;
+		std::size_t first_bus_ = 0;
+		bool is_built_ = false;
+	};
+
+	// Версионный доступ к справочнику для обновления данных без остановки обработки запросов.
+	// Читатель закрепляет (Pin) текущую неизменяемую версию и работает с ней до конца запроса.
+	// Писатель копирует текущую версию (остановки и маршруты при этом разделяются, а не копируются),
+	// изменяет копию и атомарно публикует ее. Старая версия освобождается, когда ее отпустит
+	// последний читатель (подсчет ссылок shared_ptr).
+	class CatalogueHandle {
+	public:
+		using Version = std::shared_ptr<const Catalogue>;
+
+		CatalogueHandle();
+		explicit CatalogueHandle(Catalogue catalogue);
+		explicit CatalogueHandle(Version version);
+		// версия-обертка над справочником, временем жизни которого управляет вызывающий код
+		static Version NonOwning(const Catalogue& catalogue);
+
+		CatalogueHandle(const CatalogueHandle&) = delete;
+		CatalogueHandle& operator=(const CatalogueHandle&) = delete;
+
+		// возвращает текущую версию, которая остается валидной, пока жив возвращенный указатель
+		Version Pin() const;
+
+		// применяет изменения updater(Catalogue&) к новой версии и публикует ее
+		// писатели выполняются по очереди, читатели не блокируются
+		template <typename Updater>
+		Version Update(Updater updater);
+
+		// публикует полностью подготовленный справочник как новую версию
+		Version Publish(Catalogue catalogue);
+
+	private:
+		Version PublishLocked(std::shared_ptr<Catalogue> next);
+
+		// доступ только через std::atomic_load / std::atomic_store
+		Version current_;
+		std::mutex writer_mutex_;
+	};
+
+	template <typename Updater>
+	CatalogueHandle::Version CatalogueHandle::Update(Updater updater) {
+		std::lock_guard guard(writer_mutex_);
+		auto next = std::make_shared<Catalogue>(*Pin());
+		updater(*next);
+		return PublishLocked(std::move(next));
+	}
 }// конец пространства имен transport_ctg
\ No newline at end of file
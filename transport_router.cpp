@@ -7,6 +7,8 @@
 #include <string_view>
 
 namespace transport_ctg {
+
+using namespace std::literals;
     
 BusRouter::BusRouter(const RoutingSettings& settings, const Catalogue& catalogue) 
 	: settings_(settings)
@@ -14,12 +16,20 @@ BusRouter::BusRouter(const RoutingSettings& settings, const Catalogue& catalogue
 	graph_ = BuildGraph(catalogue);
 }
 
+BusRouter::BusRouter(const RoutingSettings& settings, CatalogueHandle::Version catalogue)
+	: settings_(settings)
+	, catalogue_version_(std::move(catalogue))
+	{
+	graph_ = BuildGraph(*catalogue_version_);
+}
+
 const BusRouter::Graph& BusRouter::BuildGraph(const Catalogue& catalogue) {
 	const auto& all_stops = catalogue.GetSortedStops();
 	const auto& all_buses = catalogue.GetSortedBuses();
 	// граф с двумя вершинами на каждой остановке
 	Graph stops_graph(all_stops.size() * 2);
 	graph::VertexId vertex_id = 0;
+	catalogue_ = &catalogue;
 
 	for (const auto& [stopname, stop] : all_stops) {
 		stop_to_ids_.insert({ stop, vertex_id });
@@ -42,12 +52,12 @@ const BusRouter::Graph& BusRouter::BuildGraph(const Catalogue& catalogue) {
 
 			for (size_t i = 0; i < stops_count; ++i) {
 				for (size_t j = i + 1; j < stops_count; ++j) {
-					Stop* from = stops[i];
-					Stop* to = stops[j];
+					const Stop* from = stops[i];
+					const Stop* to = stops[j];
 					int distance = 0;
 					int inverse_distance = 0;
-					static const double km_to_meters = 1000.0;
-					static const double hour_to_minutes = 60.0;
+					constexpr double km_to_meters = 1000.0;
+					constexpr double hour_to_minutes = 60.0;
 
 					for (size_t k = i + 1; k <= j; ++k) {
 						distance += catalogue.GetDistanceBetweenStops({ stops[k - 1], stops[k] });
@@ -85,8 +95,30 @@ const BusRouter::Graph& BusRouter::GetGraph() const {
 	return graph_;
 }
 
-std::optional<BusRouter::Router::RouteInfo> BusRouter::FindRoute(Stop* from, Stop* to) const {
-	return router_->BuildRoute(stop_to_ids_.at(from), stop_to_ids_.at(to));
+std::optional<BusRouter::Router::RouteInfo> BusRouter::FindRoute(const Stop* from, const Stop* to) const {
+	const auto from_it = stop_to_ids_.find(from);
+	const auto to_it = stop_to_ids_.find(to);
+	if (from_it == stop_to_ids_.end() || to_it == stop_to_ids_.end()) {
+		return std::nullopt;
+	}
+	return router_->BuildRoute(from_it->second, to_it->second);
+}
+
+const RoutingSettings& BusRouter::GetSettings() const {
+	return settings_;
+}
+
+bool BusRouter::IsBuiltFor(const Catalogue& catalogue) const {
+	return catalogue_ == &catalogue;
+}
+
+memory::MemoryReport BusRouter::GetMemoryReport() const {
+	memory::MemoryReport report;
+	report.Add("stop_to_ids"s, memory::Bytes(stop_to_ids_));
+	report.Add("graph_edges"s, graph_.GetEdgesMemoryUsage());
+	report.Add("graph_incidence_lists"s, graph_.GetIncidenceListsMemoryUsage());
+	report.Add("routes_internal_data"s, router_ ? memory::HeapBlock(sizeof(Router)) + router_->GetMemoryUsage() : 0);
+	return report;
 }
 
 } // namespace transport_ctg
\ No newline at end of file
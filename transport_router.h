@@ -22,14 +22,27 @@ private:
 
 public:
 	explicit BusRouter(const RoutingSettings& settings, const Catalogue& catalogue);
+	// строит граф по версии справочника и удерживает ее, пока жив маршрутизатор
+	explicit BusRouter(const RoutingSettings& settings, CatalogueHandle::Version catalogue);
 	
 	const Graph& BuildGraph(const Catalogue& cataloge);
 	const Graph& GetGraph() const;
-	std::optional<Router::RouteInfo> FindRoute(Stop* from, Stop* to) const;
+	// пусто, если маршрута нет или остановки нет в справочнике, по которому построен граф
+	std::optional<Router::RouteInfo> FindRoute(const Stop* from, const Stop* to) const;
+
+	const RoutingSettings& GetSettings() const;
+	// построен ли граф по этому справочнику (по этой версии)
+	bool IsBuiltFor(const Catalogue& catalogue) const;
+
+	// оценка памяти, занятой графом и таблицей маршрутов
+	memory::MemoryReport GetMemoryReport() const;
 
 private:
 	RoutingSettings settings_;
-	std::unordered_map<Stop*, graph::VertexId> stop_to_ids_;
+	// версия справочника, по которой построен граф (пустая, если справочник передан по ссылке)
+	CatalogueHandle::Version catalogue_version_;
+	const Catalogue* catalogue_ = nullptr;
+	std::unordered_map<const Stop*, graph::VertexId> stop_to_ids_;
 
 	Graph graph_;
 	std::unique_ptr<Router> router_;
@@ -0,0 +1,711 @@
+#include "vector_tile.h"
+#include "json.h"
+#include "json_builder.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std::literals;
+
+namespace {
+
+// типы полей protobuf
+enum class WireType : uint32_t {
+	VARINT = 0,
+	FIXED64 = 1,
+	LENGTH_DELIMITED = 2,
+	FIXED32 = 5,
+};
+
+// номера полей схемы vector_tile.proto
+constexpr uint32_t TILE_LAYERS = 3;
+
+constexpr uint32_t LAYER_NAME = 1;
+constexpr uint32_t LAYER_FEATURES = 2;
+constexpr uint32_t LAYER_KEYS = 3;
+constexpr uint32_t LAYER_VALUES = 4;
+constexpr uint32_t LAYER_EXTENT = 5;
+constexpr uint32_t LAYER_VERSION = 15;
+
+constexpr uint32_t FEATURE_ID = 1;
+constexpr uint32_t FEATURE_TAGS = 2;
+constexpr uint32_t FEATURE_TYPE = 3;
+constexpr uint32_t FEATURE_GEOMETRY = 4;
+
+constexpr uint32_t VALUE_STRING = 1;
+constexpr uint32_t VALUE_FLOAT = 2;
+constexpr uint32_t VALUE_DOUBLE = 3;
+constexpr uint32_t VALUE_INT = 4;
+constexpr uint32_t VALUE_UINT = 5;
+constexpr uint32_t VALUE_SINT = 6;
+constexpr uint32_t VALUE_BOOL = 7;
+
+// команды геометрии
+constexpr uint32_t MOVE_TO = 1;
+constexpr uint32_t LINE_TO = 2;
+constexpr uint32_t CLOSE_PATH = 7;
+
+// версия формата, в которой записываются тайлы
+constexpr uint32_t VERSION = 2;
+
+// ------ Запись ------
+
+void AppendVarint(std::string& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+void AppendKey(std::string& out, uint32_t field, WireType type) {
+	AppendVarint(out, (static_cast<uint64_t>(field) << 3) | static_cast<uint32_t>(type));
+}
+
+void AppendVarintField(std::string& out, uint32_t field, uint64_t value) {
+	AppendKey(out, field, WireType::VARINT);
+	AppendVarint(out, value);
+}
+
+void AppendBytesField(std::string& out, uint32_t field, std::string_view bytes) {
+	AppendKey(out, field, WireType::LENGTH_DELIMITED);
+	AppendVarint(out, bytes.size());
+	out.append(bytes);
+}
+
+void AppendPackedField(std::string& out, uint32_t field, const std::vector<uint32_t>& values) {
+	std::string packed;
+	for (const uint32_t value : values) {
+		AppendVarint(packed, value);
+	}
+	AppendBytesField(out, field, packed);
+}
+
+uint32_t ZigZag(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+uint32_t Command(uint32_t id, uint32_t count) {
+	return (id & 0x7) | (count << 3);
+}
+
+// Слой тайла: объекты кодируются по мере добавления, ключи и значения атрибутов
+// собираются в словари слоя без повторов
+class LayerBuilder {
+public:
+	explicit LayerBuilder(std::string_view name)
+		: name_(name) {
+	}
+
+	void BeginFeature(uint64_t id, vector_tile::GeometryType type) {
+		id_ = id;
+		type_ = type;
+		tags_.clear();
+		geometry_.clear();
+		cursor_ = {};
+	}
+
+	void AddAttribute(std::string_view key, std::string_view value) {
+		std::string encoded;
+		AppendBytesField(encoded, VALUE_STRING, value);
+		AddTag(key, std::move(encoded));
+	}
+
+	void AddAttribute(std::string_view key, bool value) {
+		std::string encoded;
+		AppendVarintField(encoded, VALUE_BOOL, value ? 1 : 0);
+		AddTag(key, std::move(encoded));
+	}
+
+	void AddPoint(vector_tile::Point point) {
+		geometry_.push_back(Command(MOVE_TO, 1));
+		AddDelta(point);
+	}
+
+	// линия из точек без повторов подряд; линия короче двух точек не выводится
+	void AddLine(const std::vector<vector_tile::Point>& points) {
+		const size_t command = geometry_.size();
+		const vector_tile::Point start = cursor_;
+		size_t count = 0;
+		for (const auto& point : points) {
+			if (count > 0 && point.x == cursor_.x && point.y == cursor_.y) {
+				continue;
+			}
+			if (count == 0) {
+				geometry_.push_back(Command(MOVE_TO, 1));
+			} else if (count == 1) {
+				geometry_.push_back(0);
+			}
+			AddDelta(point);
+			++count;
+		}
+		if (count == 1) {
+			cursor_ = start;
+			geometry_.resize(command);
+		} else if (count > 1) {
+			geometry_[command + 3] = Command(LINE_TO, static_cast<uint32_t>(count - 1));
+		}
+	}
+
+	// объект без геометрии не выводится
+	void EndFeature() {
+		if (geometry_.empty()) {
+			return;
+		}
+		std::string feature;
+		AppendVarintField(feature, FEATURE_ID, id_);
+		if (!tags_.empty()) {
+			AppendPackedField(feature, FEATURE_TAGS, tags_);
+		}
+		AppendVarintField(feature, FEATURE_TYPE, static_cast<uint32_t>(type_));
+		AppendPackedField(feature, FEATURE_GEOMETRY, geometry_);
+		AppendBytesField(features_, LAYER_FEATURES, feature);
+		++feature_count_;
+	}
+
+	// дописывает слой к тайлу, если в нем есть объекты
+	void AppendTo(std::string& tile) const {
+		if (feature_count_ == 0) {
+			return;
+		}
+		std::string layer;
+		AppendBytesField(layer, LAYER_NAME, name_);
+		layer.append(features_);
+		for (const auto& key : keys_) {
+			AppendBytesField(layer, LAYER_KEYS, key);
+		}
+		for (const auto& value : values_) {
+			AppendBytesField(layer, LAYER_VALUES, value);
+		}
+		AppendVarintField(layer, LAYER_EXTENT, renderer::VectorTileRenderer::EXTENT);
+		AppendVarintField(layer, LAYER_VERSION, VERSION);
+		AppendBytesField(tile, TILE_LAYERS, layer);
+	}
+
+private:
+	std::string name_;
+	std::string features_;
+	size_t feature_count_ = 0;
+	std::vector<std::string> keys_;
+	std::unordered_map<std::string, uint32_t> key_indices_;
+	// значения хранятся закодированными сообщениями Value
+	std::vector<std::string> values_;
+	std::unordered_map<std::string, uint32_t> value_indices_;
+
+	uint64_t id_ = 0;
+	vector_tile::GeometryType type_ = vector_tile::GeometryType::UNKNOWN;
+	std::vector<uint32_t> tags_;
+	std::vector<uint32_t> geometry_;
+	// точка, от которой отсчитывается следующее смещение геометрии
+	vector_tile::Point cursor_;
+
+	static uint32_t FindOrAdd(std::vector<std::string>& items, std::unordered_map<std::string, uint32_t>& indices, std::string item) {
+		const auto [it, inserted] = indices.emplace(std::move(item), static_cast<uint32_t>(items.size()));
+		if (inserted) {
+			items.push_back(it->first);
+		}
+		return it->second;
+	}
+
+	void AddTag(std::string_view key, std::string value) {
+		tags_.push_back(FindOrAdd(keys_, key_indices_, std::string(key)));
+		tags_.push_back(FindOrAdd(values_, value_indices_, std::move(value)));
+	}
+
+	void AddDelta(vector_tile::Point point) {
+		geometry_.push_back(ZigZag(point.x - cursor_.x));
+		geometry_.push_back(ZigZag(point.y - cursor_.y));
+		cursor_ = point;
+	}
+};
+
+// ------ Чтение ------
+
+[[noreturn]] void ThrowFormatError(std::string_view message) {
+	throw std::invalid_argument("vector tile: "s + std::string(message));
+}
+
+class Reader {
+public:
+	explicit Reader(std::string_view data)
+		: data_(data) {
+	}
+
+	bool AtEnd() const {
+		return pos_ == data_.size();
+	}
+
+	uint64_t ReadVarint() {
+		uint64_t result = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (AtEnd()) {
+				ThrowFormatError("unexpected end of varint"sv);
+			}
+			const auto byte = static_cast<uint8_t>(data_[pos_++]);
+			result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return result;
+			}
+		}
+		ThrowFormatError("varint is too long"sv);
+	}
+
+	// номер и тип следующего поля
+	std::pair<uint32_t, WireType> ReadKey() {
+		const uint64_t key = ReadVarint();
+		return { static_cast<uint32_t>(key >> 3), static_cast<WireType>(key & 0x7) };
+	}
+
+	std::string_view ReadBytes() {
+		const uint64_t size = ReadVarint();
+		if (size > data_.size() - pos_) {
+			ThrowFormatError("field is out of bounds"sv);
+		}
+		const std::string_view result = data_.substr(pos_, static_cast<size_t>(size));
+		pos_ += static_cast<size_t>(size);
+		return result;
+	}
+
+	template <typename T>
+	T ReadFixed() {
+		if (sizeof(T) > data_.size() - pos_) {
+			ThrowFormatError("field is out of bounds"sv);
+		}
+		// числа фиксированной длины записываются в порядке little-endian
+		uint8_t bytes[sizeof(T)];
+		std::memcpy(bytes, data_.data() + pos_, sizeof(T));
+		pos_ += sizeof(T);
+		uint64_t bits = 0;
+		for (size_t i = sizeof(T); i-- > 0;) {
+			bits = (bits << 8) | bytes[i];
+		}
+		T result;
+		if constexpr (sizeof(T) == sizeof(uint32_t)) {
+			const auto value = static_cast<uint32_t>(bits);
+			std::memcpy(&result, &value, sizeof(T));
+		} else {
+			std::memcpy(&result, &bits, sizeof(T));
+		}
+		return result;
+	}
+
+	void Skip(WireType type) {
+		switch (type) {
+		case WireType::VARINT:
+			ReadVarint();
+			break;
+		case WireType::FIXED64:
+			ReadFixed<uint64_t>();
+			break;
+		case WireType::LENGTH_DELIMITED:
+			ReadBytes();
+			break;
+		case WireType::FIXED32:
+			ReadFixed<uint32_t>();
+			break;
+		default:
+			ThrowFormatError("unsupported wire type"sv);
+		}
+	}
+
+	// упакованное (или одиночное) повторяющееся поле из чисел varint
+	void ReadRepeated(WireType type, std::vector<uint32_t>& values) {
+		if (type == WireType::VARINT) {
+			values.push_back(static_cast<uint32_t>(ReadVarint()));
+			return;
+		}
+		if (type != WireType::LENGTH_DELIMITED) {
+			ThrowFormatError("wrong wire type of repeated field"sv);
+		}
+		Reader packed(ReadBytes());
+		while (!packed.AtEnd()) {
+			values.push_back(static_cast<uint32_t>(packed.ReadVarint()));
+		}
+	}
+
+private:
+	std::string_view data_;
+	size_t pos_ = 0;
+};
+
+int32_t UnZigZag(uint32_t value) {
+	return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+vector_tile::Value DecodeValue(std::string_view data) {
+	Reader reader(data);
+	std::optional<vector_tile::Value> result;
+	while (!reader.AtEnd()) {
+		const auto [field, type] = reader.ReadKey();
+		if (field == VALUE_STRING && type == WireType::LENGTH_DELIMITED) {
+			result = std::string(reader.ReadBytes());
+		} else if (field == VALUE_FLOAT && type == WireType::FIXED32) {
+			result = static_cast<double>(reader.ReadFixed<float>());
+		} else if (field == VALUE_DOUBLE && type == WireType::FIXED64) {
+			result = reader.ReadFixed<double>();
+		} else if (field == VALUE_INT && type == WireType::VARINT) {
+			result = static_cast<int64_t>(reader.ReadVarint());
+		} else if (field == VALUE_UINT && type == WireType::VARINT) {
+			result = reader.ReadVarint();
+		} else if (field == VALUE_SINT && type == WireType::VARINT) {
+			const uint64_t value = reader.ReadVarint();
+			result = static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+		} else if (field == VALUE_BOOL && type == WireType::VARINT) {
+			result = reader.ReadVarint() != 0;
+		} else {
+			reader.Skip(type);
+		}
+	}
+	if (!result) {
+		ThrowFormatError("empty value"sv);
+	}
+	return *result;
+}
+
+// команды геометрии переводятся в части с абсолютными координатами
+std::vector<std::vector<vector_tile::Point>> DecodeGeometry(const std::vector<uint32_t>& commands) {
+	std::vector<std::vector<vector_tile::Point>> result;
+	vector_tile::Point cursor;
+	size_t i = 0;
+	const auto read_point = [&commands, &i, &cursor]() {
+		if (commands.size() - i < 2) {
+			ThrowFormatError("missing geometry parameters"sv);
+		}
+		cursor.x += UnZigZag(commands[i++]);
+		cursor.y += UnZigZag(commands[i++]);
+		return cursor;
+	};
+
+	while (i < commands.size()) {
+		const uint32_t id = commands[i] & 0x7;
+		const uint32_t count = commands[i] >> 3;
+		++i;
+		switch (id) {
+		case MOVE_TO:
+			result.emplace_back();
+			for (uint32_t k = 0; k < count; ++k) {
+				result.back().push_back(read_point());
+			}
+			break;
+		case LINE_TO:
+			if (result.empty()) {
+				ThrowFormatError("LineTo without MoveTo"sv);
+			}
+			for (uint32_t k = 0; k < count; ++k) {
+				result.back().push_back(read_point());
+			}
+			break;
+		case CLOSE_PATH:
+			if (result.empty() || result.back().empty()) {
+				ThrowFormatError("ClosePath without MoveTo"sv);
+			}
+			result.back().push_back(result.back().front());
+			break;
+		default:
+			ThrowFormatError("unknown geometry command"sv);
+		}
+	}
+	return result;
+}
+
+vector_tile::Feature DecodeFeature(std::string_view data, const std::vector<std::string>& keys, const std::vector<vector_tile::Value>& values) {
+	vector_tile::Feature result;
+	std::vector<uint32_t> tags;
+	std::vector<uint32_t> geometry;
+	Reader reader(data);
+	while (!reader.AtEnd()) {
+		const auto [field, type] = reader.ReadKey();
+		if (field == FEATURE_ID && type == WireType::VARINT) {
+			result.id = reader.ReadVarint();
+		} else if (field == FEATURE_TAGS) {
+			reader.ReadRepeated(type, tags);
+		} else if (field == FEATURE_TYPE && type == WireType::VARINT) {
+			const uint64_t geometry_type = reader.ReadVarint();
+			result.type = geometry_type <= 3 ? static_cast<vector_tile::GeometryType>(geometry_type) : vector_tile::GeometryType::UNKNOWN;
+		} else if (field == FEATURE_GEOMETRY) {
+			reader.ReadRepeated(type, geometry);
+		} else {
+			reader.Skip(type);
+		}
+	}
+
+	if (tags.size() % 2 != 0) {
+		ThrowFormatError("odd number of feature tags"sv);
+	}
+	for (size_t i = 0; i < tags.size(); i += 2) {
+		if (tags[i] >= keys.size() || tags[i + 1] >= values.size()) {
+			ThrowFormatError("feature tag is out of range"sv);
+		}
+		result.attributes.emplace_back(keys[tags[i]], values[tags[i + 1]]);
+	}
+	result.geometry = DecodeGeometry(geometry);
+	return result;
+}
+
+vector_tile::Layer DecodeLayer(std::string_view data) {
+	vector_tile::Layer result;
+	std::vector<std::string> keys;
+	std::vector<vector_tile::Value> values;
+	// объекты разбираются после словарей, которые могут идти в слое за ними
+	std::vector<std::string_view> features;
+	Reader reader(data);
+	while (!reader.AtEnd()) {
+		const auto [field, type] = reader.ReadKey();
+		if (field == LAYER_NAME && type == WireType::LENGTH_DELIMITED) {
+			result.name = std::string(reader.ReadBytes());
+		} else if (field == LAYER_FEATURES && type == WireType::LENGTH_DELIMITED) {
+			features.push_back(reader.ReadBytes());
+		} else if (field == LAYER_KEYS && type == WireType::LENGTH_DELIMITED) {
+			keys.emplace_back(reader.ReadBytes());
+		} else if (field == LAYER_VALUES && type == WireType::LENGTH_DELIMITED) {
+			values.push_back(DecodeValue(reader.ReadBytes()));
+		} else if (field == LAYER_EXTENT && type == WireType::VARINT) {
+			result.extent = static_cast<uint32_t>(reader.ReadVarint());
+		} else if (field == LAYER_VERSION && type == WireType::VARINT) {
+			result.version = static_cast<uint32_t>(reader.ReadVarint());
+		} else {
+			reader.Skip(type);
+		}
+	}
+	for (const auto feature : features) {
+		result.features.push_back(DecodeFeature(feature, keys, values));
+	}
+	return result;
+}
+
+std::string_view GetTypeName(vector_tile::GeometryType type) {
+	switch (type) {
+	case vector_tile::GeometryType::POINT:
+		return "Point"sv;
+	case vector_tile::GeometryType::LINESTRING:
+		return "LineString"sv;
+	case vector_tile::GeometryType::POLYGON:
+		return "Polygon"sv;
+	default:
+		return "Unknown"sv;
+	}
+}
+
+// целые значения, не помещающиеся в int, выводятся как вещественные
+json::Node::Value ToJsonValue(const vector_tile::Value& value) {
+	if (const auto* text = std::get_if<std::string>(&value)) {
+		return *text;
+	}
+	if (const auto* number = std::get_if<double>(&value)) {
+		return *number;
+	}
+	if (const auto* flag = std::get_if<bool>(&value)) {
+		return *flag;
+	}
+	const auto make_number = [](auto number) -> json::Node::Value {
+		if (number >= 0 && static_cast<uint64_t>(number) <= static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+			return static_cast<int>(number);
+		}
+		if (number < 0 && static_cast<int64_t>(number) >= std::numeric_limits<int>::min()) {
+			return static_cast<int>(number);
+		}
+		return static_cast<double>(number);
+	};
+	if (const auto* number = std::get_if<int64_t>(&value)) {
+		return make_number(*number);
+	}
+	return make_number(std::get<uint64_t>(value));
+}
+
+const std::string BASE64_ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"s;
+
+} // namespace
+
+namespace renderer {
+
+VectorTileRenderer::VectorTileRenderer(const MapRenderer& renderer)
+	: renderer_(renderer) {
+	for (const auto& color : renderer.GetRenderSettings().color_palette) {
+		std::ostringstream strm;
+		strm << color;
+		colors_.push_back(strm.str());
+	}
+}
+
+// Координаты изображения карты переводятся в координаты тайла [0, EXTENT) по каждой оси,
+// геометрия сохраняется с запасом BUFFER вокруг тайла
+std::optional<std::string> VectorTileRenderer::GetTile(const MapScene& scene, int zoom, int x, int y) const {
+	const auto viewport = renderer_.GetTileViewport(zoom, x, y);
+	if (!viewport) {
+		return std::nullopt;
+	}
+	const double width = viewport->max.x - viewport->min.x;
+	const double height = viewport->max.y - viewport->min.y;
+	const double buffer = static_cast<double>(BUFFER) / EXTENT;
+	const Viewport area{ { viewport->min.x - width * buffer, viewport->min.y - height * buffer },
+		{ viewport->max.x + width * buffer, viewport->max.y + height * buffer } };
+	const auto to_tile = [&viewport, width, height](svg::Point point) {
+		return vector_tile::Point{
+			static_cast<int32_t>(std::lround((point.x - viewport->min.x) / width * EXTENT)),
+			static_cast<int32_t>(std::lround((point.y - viewport->min.y) / height * EXTENT))
+		};
+	};
+	const auto& routes = scene.GetRoutes();
+	const auto& stops = scene.GetStops();
+
+	// части линии маршрута, попавшие в тайл, образуют один объект
+	LayerBuilder routes_layer("routes"sv);
+	std::optional<uint32_t> current;
+	std::vector<vector_tile::Point> line;
+	const auto flush_line = [&routes_layer, &line]() {
+		routes_layer.AddLine(line);
+		line.clear();
+	};
+	scene.ClipRoutes(area, zoom,
+		[&](uint32_t route) {
+			flush_line();
+			if (current == route) {
+				return;
+			}
+			if (current) {
+				routes_layer.EndFeature();
+			}
+			current = route;
+			const auto& shape = routes[route];
+			routes_layer.BeginFeature(route, vector_tile::GeometryType::LINESTRING);
+			routes_layer.AddAttribute("name"sv, shape.name);
+			routes_layer.AddAttribute("color"sv, std::string_view(colors_[shape.color]));
+			routes_layer.AddAttribute("is_roundtrip"sv, shape.is_roundtrip);
+		},
+		[&line, &to_tile](svg::Point point) {
+			line.push_back(to_tile(point));
+		});
+	flush_line();
+	if (current) {
+		routes_layer.EndFeature();
+	}
+
+	LayerBuilder stops_layer("stops"sv);
+	if (zoom >= renderer_.GetRenderSettings().stop_details_min_zoom) {
+		for (const uint32_t stop : scene.FindStops(area)) {
+			stops_layer.BeginFeature(stop, vector_tile::GeometryType::POINT);
+			stops_layer.AddAttribute("name"sv, stops[stop].name);
+			stops_layer.AddPoint(to_tile(stops[stop].point));
+			stops_layer.EndFeature();
+		}
+	}
+
+	std::string tile;
+	routes_layer.AppendTo(tile);
+	stops_layer.AppendTo(tile);
+	return tile;
+}
+
+} // namespace renderer
+
+namespace vector_tile {
+
+Tile Decode(std::string_view data) {
+	Tile result;
+	Reader reader(data);
+	while (!reader.AtEnd()) {
+		const auto [field, type] = reader.ReadKey();
+		if (field == TILE_LAYERS && type == WireType::LENGTH_DELIMITED) {
+			result.layers.push_back(DecodeLayer(reader.ReadBytes()));
+		} else {
+			reader.Skip(type);
+		}
+	}
+	return result;
+}
+
+// геометрия выводится массивом частей, часть - массивом точек [x, y]
+void Print(const Tile& tile, std::ostream& out) {
+	json::Builder builder;
+	builder.StartDict().Key("layers"sv).StartArray();
+	for (const auto& layer : tile.layers) {
+		builder.StartDict()
+			.Key("extent"sv).Value(static_cast<int>(layer.extent))
+			.Key("name"sv).Value(layer.name)
+			.Key("version"sv).Value(static_cast<int>(layer.version))
+			.Key("features"sv).StartArray();
+		for (const auto& feature : layer.features) {
+			builder.StartDict();
+			if (feature.id) {
+				builder.Key("id"sv).Value(ToJsonValue(*feature.id));
+			}
+			builder.Key("type"sv).Value(std::string(GetTypeName(feature.type)));
+			builder.Key("properties"sv).StartDict();
+			for (const auto& [key, value] : feature.attributes) {
+				builder.Key(key).Value(ToJsonValue(value));
+			}
+			builder.EndDict();
+			builder.Key("geometry"sv).StartArray();
+			for (const auto& part : feature.geometry) {
+				builder.StartArray();
+				for (const auto& point : part) {
+					builder.StartArray().Value(point.x).Value(point.y).EndArray();
+				}
+				builder.EndArray();
+			}
+			builder.EndArray();
+			builder.EndDict();
+		}
+		builder.EndArray().EndDict();
+	}
+	builder.EndArray().EndDict();
+	json::Print(json::Document(builder.Build()), out);
+}
+
+std::string EncodeBase64(std::string_view data) {
+	std::string result;
+	result.reserve((data.size() + 2) / 3 * 4);
+	size_t i = 0;
+	for (; i + 2 < data.size(); i += 3) {
+		const uint32_t bits = (static_cast<uint8_t>(data[i]) << 16) | (static_cast<uint8_t>(data[i + 1]) << 8) | static_cast<uint8_t>(data[i + 2]);
+		result.push_back(BASE64_ALPHABET[(bits >> 18) & 0x3F]);
+		result.push_back(BASE64_ALPHABET[(bits >> 12) & 0x3F]);
+		result.push_back(BASE64_ALPHABET[(bits >> 6) & 0x3F]);
+		result.push_back(BASE64_ALPHABET[bits & 0x3F]);
+	}
+	if (i < data.size()) {
+		uint32_t bits = static_cast<uint8_t>(data[i]) << 16;
+		if (i + 1 < data.size()) {
+			bits |= static_cast<uint8_t>(data[i + 1]) << 8;
+		}
+		result.push_back(BASE64_ALPHABET[(bits >> 18) & 0x3F]);
+		result.push_back(BASE64_ALPHABET[(bits >> 12) & 0x3F]);
+		result.push_back(i + 1 < data.size() ? BASE64_ALPHABET[(bits >> 6) & 0x3F] : '=');
+		result.push_back('=');
+	}
+	return result;
+}
+
+std::string DecodeBase64(std::string_view text) {
+	std::string result;
+	result.reserve(text.size() / 4 * 3);
+	uint32_t bits = 0;
+	int bit_count = 0;
+	bool is_padding = false;
+	for (const char c : text) {
+		if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+			continue;
+		}
+		if (c == '=') {
+			is_padding = true;
+			continue;
+		}
+		const size_t digit = BASE64_ALPHABET.find(c);
+		if (digit == std::string::npos || is_padding) {
+			throw std::invalid_argument("base64: unexpected character"s);
+		}
+		bits = (bits << 6) | static_cast<uint32_t>(digit);
+		bit_count += 6;
+		if (bit_count >= 8) {
+			bit_count -= 8;
+			result.push_back(static_cast<char>((bits >> bit_count) & 0xFF));
+		}
+	}
+	return result;
+}
+
+} // namespace vector_tile
\ No newline at end of file
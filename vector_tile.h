@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ * Двоичные векторные тайлы карты в формате Mapbox Vector Tile 2.1 (protobuf),
+ * без внешней зависимости от protobuf: кодировщик для ответа на запросы VectorTile
+ * и декодер, которым тайлы можно проверить без клиента карты.
+ */
+
+#include "map_renderer.h"
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace renderer {
+
+// Отрисовка карты в векторные тайлы. Тайл z/x/y покрывает ту же часть изображения карты,
+// что и тайл SVG (MapRenderer::GetTileViewport), и содержит два слоя:
+//  routes - линии маршрутов (MultiLineString) с атрибутами name, color, is_roundtrip;
+//  stops - точки остановок с атрибутом name.
+// Цвет - строка в том виде, в каком ее выводит SVG-документ. Линии упрощаются и обрезаются
+// так же, как во фрагментах SVG, остановки пропускаются ниже stop_details_min_zoom
+class VectorTileRenderer {
+public:
+    // размер тайла в единицах координат и запас вокруг него, в котором сохраняется геометрия
+    static constexpr uint32_t EXTENT = 4096;
+    static constexpr uint32_t BUFFER = 64;
+
+    explicit VectorTileRenderer(const MapRenderer& renderer);
+
+    // закодированный тайл, пусто, если номер тайла неверен
+    std::optional<std::string> GetTile(const MapScene& scene, int zoom, int x, int y) const;
+
+private:
+    const MapRenderer& renderer_;
+    // цвета палитры в виде строк SVG
+    std::vector<std::string> colors_;
+};
+
+} // namespace renderer
+
+namespace vector_tile {
+
+// декодированный тайл: значения атрибутов, геометрия в координатах тайла
+using Value = std::variant<std::string, double, int64_t, uint64_t, bool>;
+
+enum class GeometryType {
+    UNKNOWN = 0,
+    POINT = 1,
+    LINESTRING = 2,
+    POLYGON = 3,
+};
+
+struct Point {
+    int32_t x = 0;
+    int32_t y = 0;
+};
+
+struct Feature {
+    std::optional<uint64_t> id;
+    GeometryType type = GeometryType::UNKNOWN;
+    // атрибуты в порядке тегов объекта
+    std::vector<std::pair<std::string, Value>> attributes;
+    // каждая команда MoveTo начинает новую часть: точку, линию или кольцо
+    std::vector<std::vector<Point>> geometry;
+};
+
+struct Layer {
+    uint32_t version = 1;
+    std::string name;
+    uint32_t extent = 4096;
+    std::vector<Feature> features;
+};
+
+struct Tile {
+    std::vector<Layer> layers;
+};
+
+// Разбирает тайл. Неизвестные поля пропускаются, при ошибке формата
+// выбрасывается std::invalid_argument
+Tile Decode(std::string_view data);
+// выводит тайл в виде документа JSON
+void Print(const Tile& tile, std::ostream& out);
+
+// двоичные тайлы передаются в ответах JSON в кодировке base64
+std::string EncodeBase64(std::string_view data);
+// при ошибке выбрасывается std::invalid_argument, пробельные символы пропускаются
+std::string DecodeBase64(std::string_view text);
+
+} // namespace vector_tile
\ No newline at end of file